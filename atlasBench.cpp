@@ -0,0 +1,253 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shaderLibrary.h"
+#include "cameraBuffer.h"
+#include "instancing.h"
+#include "textureAtlas.h"
+#include "bindlessTextures.h"
+#include "cubeMesh.h"
+#include "benchFrames.h"
+
+// Cubes that each use one of 512 different textures: a glBindTexture + model uniform +
+// glDrawArrays per cube against one instanced draw reading a TextureAtlas through
+// per-instance material indices, and against the same draw with bindless handles
+// (MaterialTextures) where ARB_bindless_texture exists.
+
+const int MATERIAL_COUNT = ATLAS_MAX_MATERIALS;
+
+struct Scene {
+    Shader* perDrawShader;
+    Shader* atlasShader;
+    Shader* bindlessShader;
+    GLint modelLocation;
+    unsigned int VAO;
+    InstanceBuffer* instances;
+    TextureAtlas* atlas;
+    MaterialTextures* bindless;
+    std::vector<unsigned int> textures;
+    std::vector<glm::mat4> models;
+    std::vector<uint32_t> materials;
+};
+
+void drawPerTexture(void* context) {
+    Scene& scene = *(Scene*)context;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.perDrawShader->use();
+    glBindVertexArray(scene.VAO);
+
+    for(size_t i = 0; i < scene.models.size(); ++i) {
+        glBindTexture(GL_TEXTURE_2D, scene.textures[scene.materials[i]]);
+        scene.perDrawShader->setMat4(scene.modelLocation, scene.models[i]);
+        glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+    }
+}
+
+void drawAtlas(void* context) {
+    Scene& scene = *(Scene*)context;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.atlasShader->use();
+    scene.atlas->bind();
+    glBindVertexArray(scene.VAO);
+
+    scene.instances->upload(scene.models, scene.materials);
+    scene.instances->drawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+    scene.instances->endFrame();
+}
+
+void drawBindless(void* context) {
+    Scene& scene = *(Scene*)context;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.bindlessShader->use();
+
+    scene.bindless->use(scene.materials);
+    scene.bindless->update();
+    scene.bindless->bind();
+    glBindVertexArray(scene.VAO);
+
+    scene.instances->upload(scene.models, scene.materials);
+    scene.instances->drawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+    scene.instances->endFrame();
+}
+
+// a distinct pattern and size per material
+std::vector<unsigned char> makeImage(int index, int& width, int& height) {
+    width = 32 << (index % 3);
+    height = 32 << ((index / 3) % 3);
+
+    std::vector<unsigned char> pixels((size_t)width * height * 4);
+    int r = (index * 97) % 256, g = (index * 57) % 256, b = (index * 23) % 256;
+
+    for(int y = 0; y < height; ++y) {
+        for(int x = 0; x < width; ++x) {
+            bool stripe = ((x + y * (index % 5 + 1)) / 8) % 2 == 0;
+            unsigned char* texel = &pixels[((size_t)y * width + x) * 4];
+            texel[0] = (unsigned char)(stripe ? r : 255 - r);
+            texel[1] = (unsigned char)(stripe ? g : 255 - g);
+            texel[2] = (unsigned char)(stripe ? b : 255 - b);
+            texel[3] = 255;
+        }
+    }
+
+    return pixels;
+}
+
+int main() {
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(600, 600, "Atlas benchmark", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    // don't let vsync cap the measurement
+    glfwSwapInterval(0);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    ShaderLibrary shaders;
+    Shader& perDrawShader = shaders.variant("vertexShader.glsl", "fragmentShader.glsl");
+    Shader& atlasShader = shaders.variant("vertexShader.glsl", "fragmentShader.glsl", {{"INSTANCED", ""}, {"TEXTURE_ATLAS", ""}});
+    Shader* bindlessShader = bindlessTexturesAvailable() ? &shaders.variant("vertexShader.glsl", "fragmentShader.glsl", {{"INSTANCED", ""}, {"BINDLESS_TEXTURES", ""}}) : nullptr;
+    shaders.finishAll();
+
+    // the same images as separate textures and packed into the atlas
+    std::vector<std::vector<unsigned char>> images(MATERIAL_COUNT);
+    std::vector<AtlasImage> atlasImages(MATERIAL_COUNT);
+    std::vector<unsigned int> textures(MATERIAL_COUNT);
+
+    glGenTextures(MATERIAL_COUNT, textures.data());
+
+    for(int i = 0; i < MATERIAL_COUNT; ++i) {
+        AtlasImage& image = atlasImages[i];
+        images[i] = makeImage(i, image.width, image.height);
+        image.name = "material" + std::to_string(i);
+        image.pixels = images[i].data();
+
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+
+    TextureAtlas atlas;
+
+    if(!atlas.build(atlasImages)) {
+        return -1;
+    }
+
+    printAtlasStats(atlas);
+
+    // the atlas above already is the fallback, so only build this when it would be bindless
+    MaterialTextures bindless;
+
+    if(bindlessTexturesAvailable()) {
+        bindless.build(atlasImages);
+    }
+
+    unsigned int VAO, VBO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE, nullptr);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    InstanceBuffer instances;
+    instances.create();
+    instances.attach(VAO, INSTANCE_MODEL_LOCATION, true);
+
+    CameraBuffer camera;
+    camera.create();
+    camera.update(glm::lookAt(glm::vec3(0.0f, 0.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+                  glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 500.0f));
+
+    glEnable(GL_DEPTH_TEST);
+
+    Scene scene;
+    scene.perDrawShader = &perDrawShader;
+    scene.atlasShader = &atlasShader;
+    scene.modelLocation = perDrawShader.uniform("model");
+    scene.VAO = VAO;
+    scene.instances = &instances;
+    scene.bindlessShader = bindlessShader;
+    scene.atlas = &atlas;
+    scene.bindless = &bindless;
+    scene.textures = textures;
+
+    const size_t counts[] = {1000, 10000, 50000};
+
+    std::cout << "cubes      per-texture ms   atlas ms   speedup   bindless ms" << std::endl;
+
+    for(size_t count : counts) {
+        scene.models.resize(count);
+        scene.materials.resize(count);
+        srand(1234);
+
+        for(size_t i = 0; i < count; ++i) {
+            glm::vec3 position((rand() % 2000) / 10.0f - 100.0f, (rand() % 2000) / 10.0f - 100.0f, (rand() % 2000) / 10.0f - 100.0f);
+            scene.models[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.5f));
+            scene.materials[i] = (uint32_t)(rand() % MATERIAL_COUNT);
+        }
+
+        double perTextureMs = timeFrames(window, drawPerTexture, &scene);
+        double atlasMs = timeFrames(window, drawAtlas, &scene);
+
+        printf("%-10zu %-16.3f %-10.3f %-9.2f ", count, perTextureMs, atlasMs, perTextureMs / atlasMs);
+
+        if(bindless.bindless) {
+            printf("%.3f\n", timeFrames(window, drawBindless, &scene));
+        }
+        else {
+            printf("-\n");
+        }
+    }
+
+    instances.destroy();
+    camera.destroy();
+    printTextureResidencyStats(bindless);
+
+    atlas.destroy();
+    bindless.destroy();
+    glDeleteTextures(MATERIAL_COUNT, textures.data());
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteProgram(perDrawShader.shaderProgram);
+    glDeleteProgram(atlasShader.shaderProgram);
+
+    if(bindlessShader) {
+        glDeleteProgram(bindlessShader->shaderProgram);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
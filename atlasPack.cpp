@@ -0,0 +1,94 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <GL/glew.h>
+#include "textureAtlas.h"
+
+// Offline atlas packer to the .atlas format (see textureAtlas.h). No GL context is needed.
+//
+//   atlasPack out.atlas image... [--layer SIZE] [--padding N]
+//
+// Materials are named after the image file without its extension, which is what
+// TextureAtlas::material() looks up.
+
+void printUsage() {
+    std::cout << "usage: atlasPack out.atlas image... [--layer SIZE] [--padding N]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        printUsage();
+        return 1;
+    }
+
+    int layerSize = 2048, padding = 8;
+    std::vector<const char*> paths;
+
+    for(int i = 2; i < argc; ++i) {
+        if(strcmp(argv[i], "--layer") == 0 && i + 1 < argc) {
+            layerSize = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--padding") == 0 && i + 1 < argc) {
+            padding = atoi(argv[++i]);
+        }
+        else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<unsigned char*> images;
+    std::vector<const unsigned char*> pixels;
+    std::vector<glm::ivec2> sizes;
+    std::vector<std::string> names;
+
+    for(const char* path : paths) {
+        int width, height, channels;
+        unsigned char* image = stbi_load(path, &width, &height, &channels, 4);
+
+        if(!image) {
+            std::cout << "ERROR::ATLAS_PACK::DECODE_FAILED: " << path << " (" << stbi_failure_reason() << ")" << std::endl;
+            return 1;
+        }
+
+        images.push_back(image);
+        pixels.push_back(image);
+        sizes.push_back(glm::ivec2(width, height));
+        names.push_back(std::filesystem::path(path).stem().string());
+    }
+
+    AtlasLayout layout;
+
+    if(!packAtlas(sizes, layerSize, layerSize, padding, layout)) {
+        return 1;
+    }
+
+    bool ok = writeAtlasFile(argv[1], layout, names, composeAtlas(layout, pixels));
+
+    for(unsigned char* image : images) {
+        stbi_image_free(image);
+    }
+
+    if(!ok) {
+        return 1;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for(size_t i = 0; i < names.size(); ++i) {
+        const AtlasRegion& region = layout.regions[i];
+        printf("%-24s layer %-3d %4d,%-4d %dx%d\n", names[i].c_str(), region.layer, region.x, region.y, region.width, region.height);
+    }
+
+    std::cout << argv[1] << ": " << names.size() << " image(s) in " << layout.layerCount << " layer(s) of " << layerSize << "x" << layerSize
+              << ", " << ms << " ms" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef BENCH_FRAMES_H
+#define BENCH_FRAMES_H
+
+#include <chrono>
+#include <utility>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+// Frame timing shared by the benchmarks that draw: a few untimed frames to warm up
+// caches and drivers, then the average over the timed ones, with glFinish on both
+// sides so GPU work still queued at either end is counted where it belongs.
+
+const int BENCH_WARMUP_FRAMES = 3;
+const int BENCH_TIMED_FRAMES = 20;
+
+// ms per frame of drawFrame(context) plus the buffer swap
+template<typename DrawFrame, typename Context>
+double timeFrames(GLFWwindow* window, DrawFrame drawFrame, Context&& context, int timedFrames = BENCH_TIMED_FRAMES) {
+    for(int i = 0; i < BENCH_WARMUP_FRAMES; ++i) {
+        drawFrame(context);
+        glfwSwapBuffers(window);
+    }
+
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < timedFrames; ++i) {
+        drawFrame(context);
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    glFinish();
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / timedFrames;
+}
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef BINDLESS_TEXTURES_H
+#define BINDLESS_TEXTURES_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include "shader.h"
+#include "shaderPreprocessor.h"
+#include "mipmapGenerator.h"
+#include "textureAtlas.h"
+
+// Per-material textures addressed by a material index, whatever their sizes.
+//
+// With ARB_bindless_texture (and shader storage blocks), every material keeps its own
+// GL_TEXTURE_2D and its 64-bit handle sits in the MaterialHandles storage buffer; the
+// BINDLESS_TEXTURES permutation of the shaders turns the per-instance material index
+// (InstanceBuffer with materials) straight into a sampler, so one draw covers any
+// mix of sizes and formats. Without the extension, as under software rendering, the
+// same images go into a TextureAtlas instead and the TEXTURE_ATLAS permutation reads
+// them; material indices are the image order either way, so callers don't change.
+//
+// A handle has to be resident for the draws that sample it. Callers report the
+// materials a frame uses with use(); update() makes those resident before drawing
+// and makes handles nobody used for idleFrames non-resident again, which keeps the
+// driver's residency list (and the memory it pins) down to what is on screen.
+//
+// Divergent handles within a draw need NV_gpu_shader5 semantics, which the desktop
+// drivers that expose bindless textures provide.
+
+struct TextureResidencyStats {
+    unsigned int resident = 0;
+    unsigned int madeResident = 0;
+    unsigned int madeNonResident = 0;
+    size_t residentBytes = 0;
+};
+
+inline bool bindlessTexturesAvailable() {
+    return GLEW_ARB_bindless_texture && storageBlocksAvailable();
+}
+
+class MaterialTextures {
+    public:
+    // false means the texture array fallback
+    bool bindless = false;
+    unsigned int idleFrames = 120;
+    TextureResidencyStats stats;
+    TextureAtlas atlas;
+    // material name -> index
+    std::unordered_map<std::string, unsigned int> materials;
+
+    // RGBA8 images; their order gives the material indices
+    bool build(const std::vector<AtlasImage>& images, bool allowBindless = true) {
+        bindless = allowBindless && bindlessTexturesAvailable();
+
+        if(!bindless) {
+            if(!atlas.build(images)) {
+                return false;
+            }
+
+            materials = atlas.materials;
+            return true;
+        }
+
+        std::vector<GLuint64> handles;
+
+        for(size_t i = 0; i < images.size(); ++i) {
+            Material material;
+            material.texture = uploadTexture(images[i], material.bytes);
+            material.handle = glGetTextureHandleARB(material.texture);
+
+            entries.push_back(material);
+            handles.push_back(material.handle);
+            materials[images[i].name] = (unsigned int)i;
+        }
+
+        glGenBuffers(1, &SSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, SSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, handles.size() * sizeof(GLuint64), handles.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        return true;
+    }
+
+    // the permutation to compile the material shaders with
+    ShaderDefines shaderDefines() const {
+        if(bindless) {
+            return {{"INSTANCED", ""}, {"BINDLESS_TEXTURES", ""}};
+        }
+
+        return {{"INSTANCED", ""}, {"TEXTURE_ATLAS", ""}};
+    }
+
+    unsigned int material(const std::string& name) const {
+        auto found = materials.find(name);
+
+        if(found == materials.end()) {
+            std::cout << "ERROR::MATERIAL_TEXTURES::UNKNOWN_MATERIAL: " << name << std::endl;
+            return 0;
+        }
+
+        return found->second;
+    }
+
+    // materials drawn this frame; duplicates are fine
+    void use(const uint32_t* materialIndices, size_t count) {
+        if(!bindless) {
+            return;
+        }
+
+        for(size_t i = 0; i < count; ++i) {
+            if(materialIndices[i] < entries.size()) {
+                entries[materialIndices[i]].lastUsedFrame = frame;
+            }
+        }
+    }
+
+    void use(const std::vector<uint32_t>& materialIndices) {
+        use(materialIndices.data(), materialIndices.size());
+    }
+
+    // once per frame after use() and before the draws
+    void update() {
+        if(!bindless) {
+            return;
+        }
+
+        for(Material& material : entries) {
+            bool wanted = material.lastUsedFrame != NEVER_USED && frame - material.lastUsedFrame < idleFrames;
+
+            if(wanted && !material.resident) {
+                glMakeTextureHandleResidentARB(material.handle);
+                material.resident = true;
+                stats.resident++;
+                stats.madeResident++;
+                stats.residentBytes += material.bytes;
+            }
+            else if(!wanted && material.resident) {
+                glMakeTextureHandleNonResidentARB(material.handle);
+                material.resident = false;
+                stats.resident--;
+                stats.madeNonResident++;
+                stats.residentBytes -= material.bytes;
+            }
+        }
+
+        frame++;
+    }
+
+    void bind() const {
+        if(bindless) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_HANDLE_BINDING, SSBO);
+        }
+        else {
+            atlas.bind();
+        }
+    }
+
+    void destroy() {
+        for(Material& material : entries) {
+            if(material.resident) {
+                glMakeTextureHandleNonResidentARB(material.handle);
+            }
+
+            glDeleteTextures(1, &material.texture);
+        }
+
+        if(SSBO) {
+            glDeleteBuffers(1, &SSBO);
+        }
+
+        atlas.destroy();
+        entries.clear();
+        materials.clear();
+        SSBO = 0;
+        stats = TextureResidencyStats();
+    }
+
+    private:
+    static const uint64_t NEVER_USED = ~(uint64_t)0;
+
+    struct Material {
+        unsigned int texture = 0;
+        GLuint64 handle = 0;
+        size_t bytes = 0;
+        bool resident = false;
+        uint64_t lastUsedFrame = NEVER_USED;
+    };
+
+    std::vector<Material> entries;
+    unsigned int SSBO = 0;
+    uint64_t frame = 0;
+
+    static unsigned int uploadTexture(const AtlasImage& image, size_t& bytes) {
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+
+        MipChain chain = generateMipChain(image.pixels, image.width, image.height, 4);
+
+        for(size_t level = 0; level < chain.levels.size(); ++level) {
+            const MipLevel& info = chain.levels[level];
+            glTexImage2D(GL_TEXTURE_2D, (GLint)level + 1, GL_RGBA8, info.width, info.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, chain.data.data() + info.offset);
+        }
+
+        // sampler state is baked into the handle, so it has to be final before the handle is taken
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)chain.levels.size());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+
+        bytes = (size_t)image.width * image.height * 4 + chain.data.size();
+
+        return texture;
+    }
+};
+
+inline void printTextureResidencyStats(const MaterialTextures& textures) {
+    if(!textures.bindless) {
+        std::cout << "TEXTURE::RESIDENCY: bindless textures unavailable, using the texture array fallback" << std::endl;
+        return;
+    }
+
+    const TextureResidencyStats& stats = textures.stats;
+
+    std::cout << "TEXTURE::RESIDENCY: " << stats.resident << " resident handle(s), " << stats.residentBytes / 1024 << " KB, "
+              << stats.madeResident << " made resident, " << stats.madeNonResident << " made non-resident" << std::endl;
+}
+
+#endif
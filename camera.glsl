@@ -0,0 +1,6 @@
+// Shared per-frame camera data, filled once per frame by CameraBuffer (cameraBuffer.h)
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef CAMERA_BUFFER_H
+#define CAMERA_BUFFER_H
+
+#include <glm/glm.hpp>
+#include "shader.h"
+
+// Per-frame camera data in a uniform buffer bound at CAMERA_BLOCK_BINDING. Every
+// program that includes camera.glsl reads from it, so view/projection are uploaded
+// once per frame no matter how many programs draw.
+
+// mirrors the std140 Camera block in camera.glsl; mat4 columns are already 16-byte
+// aligned so the C++ layout matches without padding
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+};
+
+static_assert(sizeof(CameraBlock) == 3 * 64, "CameraBlock must match the std140 layout of camera.glsl");
+
+class CameraBuffer {
+    public:
+    unsigned int UBO = 0;
+
+    void create() {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, UBO);
+    }
+
+    // upload this frame's matrices; call once per frame before drawing
+    void update(const glm::mat4& view, const glm::mat4& projection) {
+        CameraBlock block;
+        block.view = view;
+        block.projection = projection;
+        block.viewProjection = projection * view;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void destroy() {
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "frustumCulling.h"
+
+// Frustum culling throughput for 1M instances, per kernel available on this CPU.
+// No GL context is needed.
+
+const size_t INSTANCE_COUNT = 1000000;
+const int ITERATIONS = 50;
+
+template<typename Bounds>
+void run(const char* name, size_t (*cull)(const Frustum&, const Bounds&, uint32_t*), const Frustum& frustum, const Bounds& bounds, std::vector<uint32_t>& visible, size_t expected) {
+    size_t count = cull(frustum, bounds, visible.data());
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < ITERATIONS; ++i) {
+        count = cull(frustum, bounds, visible.data());
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+
+    printf("%-16s %8.3f ms   %10.0f instances/ms   %zu visible%s\n", name, ms, bounds.size() / ms, count, count == expected ? "" : "   MISMATCH");
+}
+
+size_t cullSpheresScalarAll(const Frustum& frustum, const BoundingSphereSoA& spheres, uint32_t* visible) {
+    return cullSpheresScalar(frustum, spheres, 0, visible);
+}
+
+size_t cullBoxesScalarAll(const Frustum& frustum, const BoundingBoxSoA& boxes, uint32_t* visible) {
+    return cullBoxesScalar(frustum, boxes, 0, visible);
+}
+
+int main() {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+
+    BoundingSphereSoA spheres;
+    BoundingBoxSoA boxes;
+
+    for(size_t i = 0; i < INSTANCE_COUNT; ++i) {
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extent(size(random), size(random), size(random));
+
+        spheres.push(center, glm::length(extent));
+        boxes.push(center, extent);
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+    Frustum frustum = extractFrustum(projection * view);
+
+    std::vector<uint32_t> visible(INSTANCE_COUNT);
+
+    size_t expectedSpheres = cullSpheresScalar(frustum, spheres, 0, visible.data());
+    size_t expectedBoxes = cullBoxesScalar(frustum, boxes, 0, visible.data());
+
+    std::cout << INSTANCE_COUNT << " instances, " << ITERATIONS << " iterations" << std::endl;
+
+    run("spheres scalar", cullSpheresScalarAll, frustum, spheres, visible, expectedSpheres);
+#ifdef FRUSTUM_CULLING_X86
+    if(cullingHasSSE2()) {
+        run("spheres SSE2", cullSpheresSSE2, frustum, spheres, visible, expectedSpheres);
+    }
+
+    if(cullingHasAVX2()) {
+        run("spheres AVX2", cullSpheresAVX2, frustum, spheres, visible, expectedSpheres);
+    }
+#endif
+
+    run("boxes scalar", cullBoxesScalarAll, frustum, boxes, visible, expectedBoxes);
+#ifdef FRUSTUM_CULLING_X86
+    if(cullingHasSSE2()) {
+        run("boxes SSE2", cullBoxesSSE2, frustum, boxes, visible, expectedBoxes);
+    }
+
+    if(cullingHasAVX2()) {
+        run("boxes AVX2", cullBoxesAVX2, frustum, boxes, visible, expectedBoxes);
+    }
+#endif
+}
@@ -0,0 +1,140 @@
+#ifndef DRAW_INDIRECT_H
+#define DRAW_INDIRECT_H
+
+#include <vector>
+#include <iostream>
+#include "meshPool.h"
+#include "glState.h"
+
+// Batches draws of meshes that live in one MeshPool into a single submission.
+// With GL 4.3 / ARB_multi_draw_indirect the commands are written to a
+// GL_DRAW_INDIRECT_BUFFER and issued with one glMultiDrawElementsIndirect; without
+// it the same commands are replayed as a loop of glDrawElements*BaseVertex calls.
+// A non-zero baseInstance needs GL 4.2 / ARB_base_instance on either path; add()
+// refuses such draws without it rather than have them read the first instances.
+
+// layout fixed by the GL spec for indirect indexed draws
+struct DrawElementsIndirectCommand {
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+class DrawCommandBuffer {
+    public:
+    std::vector<DrawElementsIndirectCommand> commands;
+    unsigned int indirectBuffer = 0;
+    bool multiDrawIndirect = false;
+    bool baseInstanceSupported = false;
+
+    // GL calls made by the last submit()
+    unsigned int drawCalls = 0;
+
+    void create() {
+        multiDrawIndirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+        baseInstanceSupported = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+
+        if(multiDrawIndirect) {
+            glGenBuffers(1, &indirectBuffer);
+        }
+    }
+
+    void clear() {
+        commands.clear();
+    }
+
+    // baseInstance offsets per-instance attributes (e.g. an InstanceBuffer) for this draw;
+    // false when that isn't supported and the draw was left out
+    bool add(const MeshRange& mesh, unsigned int instanceCount = 1, unsigned int baseInstance = 0) {
+        if(mesh.indexCount == 0 || instanceCount == 0) {
+            return true;
+        }
+
+        if(baseInstance != 0 && !baseInstanceSupported) {
+            std::cout << "ERROR::DRAW_INDIRECT::NO_BASE_INSTANCE: baseInstance " << baseInstance << " needs GL 4.2 or ARB_base_instance" << std::endl;
+            return false;
+        }
+
+        commands.push_back(DrawElementsIndirectCommand{mesh.indexCount, instanceCount, mesh.firstIndex, mesh.baseVertex, baseInstance});
+
+        return true;
+    }
+
+    void submit(const MeshPool& pool, GLenum mode = GL_TRIANGLES) {
+        drawCalls = 0;
+
+        if(commands.empty()) {
+            return;
+        }
+
+        glBindVertexArray(pool.VAO);
+
+        if(multiDrawIndirect) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        }
+
+        draw(mode);
+
+        if(multiDrawIndirect) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+    }
+
+    // binds through state, so its counters see the VAO and indirect buffer binds (and
+    // elide them when they are already current); leaves both bound
+    void submit(GLState& state, const MeshPool& pool, GLenum mode = GL_TRIANGLES) {
+        drawCalls = 0;
+
+        if(commands.empty()) {
+            return;
+        }
+
+        state.bindVertexArray(pool.VAO);
+
+        if(multiDrawIndirect) {
+            state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        }
+
+        draw(mode);
+    }
+
+    void destroy() {
+        if(indirectBuffer) {
+            glDeleteBuffers(1, &indirectBuffer);
+            indirectBuffer = 0;
+        }
+    }
+
+    private:
+    // the pool's VAO and, with multi-draw indirect, indirectBuffer are bound
+    void draw(GLenum mode) {
+        if(multiDrawIndirect) {
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+
+            glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+            drawCalls = 1;
+            return;
+        }
+
+        for(const DrawElementsIndirectCommand& command : commands) {
+            void* offset = (void*)((size_t)command.firstIndex * sizeof(unsigned int));
+
+            // add() only lets a base instance through where it is supported
+            if(command.baseInstance != 0) {
+                glDrawElementsInstancedBaseVertexBaseInstance(mode, command.count, GL_UNSIGNED_INT, offset, command.instanceCount, command.baseVertex, command.baseInstance);
+            }
+            else if(command.instanceCount == 1) {
+                glDrawElementsBaseVertex(mode, command.count, GL_UNSIGNED_INT, offset, command.baseVertex);
+            }
+            else {
+                glDrawElementsInstancedBaseVertex(mode, command.count, GL_UNSIGNED_INT, offset, command.instanceCount, command.baseVertex);
+            }
+
+            drawCalls++;
+        }
+    }
+};
+
+#endif
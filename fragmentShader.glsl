@@ -1,12 +1,88 @@
 #version 330 core
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
 
 in vec2 myTextureCoord;
 
 out vec4 fragColor;
 
+#ifdef TEXTURE_ATLAS
+flat in float atlasLayer;
+
+uniform sampler2DArray myTexture;
+#elif defined(BINDLESS_TEXTURES)
+flat in uint materialIndex;
+
+// one resident texture handle per material (bindlessTextures.h)
+layout (std430) buffer MaterialHandles {
+    uvec2 handles[];
+};
+#else
+// the physical tile cache with VIRTUAL_TEXTURE
 uniform sampler2D myTexture;
+#endif
+
+#if defined(VIRTUAL_TEXTURE) || defined(VIRTUAL_TEXTURE_FEEDBACK)
+// virtualTexture.h: virtual width, height, tile size and coarsest level
+uniform vec4 vtSize;
+
+ivec2 virtualLevelSize(int level) {
+    return max(ivec2(1), ivec2(vtSize.xy) >> level);
+}
+
+// the level whose texels are about a pixel apart here
+int virtualLevel(vec2 uv, float bias) {
+    vec2 dx = dFdx(uv * vtSize.xy);
+    vec2 dy = dFdy(uv * vtSize.xy);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + bias;
+
+    return int(clamp(floor(lod), 0.0, vtSize.w));
+}
+#endif
+
+#ifdef VIRTUAL_TEXTURE
+// slot x, y and resident level per tile, a mip level per virtual level
+uniform sampler2D vtIndirection;
+// physical texture width, height, tile slot size and border
+uniform vec4 vtPhysical;
+
+vec4 sampleVirtual(vec2 uv) {
+    int level = virtualLevel(uv, 0.0);
+    uv = clamp(uv, 0.0, 0.99999);
+
+    ivec2 tile = ivec2(uv * vec2(virtualLevelSize(level))) / int(vtSize.z);
+    vec3 entry = floor(texelFetch(vtIndirection, tile, level).xyz * 255.0 + 0.5);
+
+    // the resident tile may be coarser than the one asked for
+    vec2 texel = uv * vec2(virtualLevelSize(int(entry.z)));
+    vec2 inTile = texel - floor(texel / vtSize.z) * vtSize.z;
+    vec2 physical = (entry.xy * vtPhysical.z + vtPhysical.w + inTile) / vtPhysical.xy;
+
+    return textureLod(myTexture, physical, 0.0);
+}
+#endif
+
+#ifdef VIRTUAL_TEXTURE_FEEDBACK
+// log2 of how much smaller the feedback framebuffer is than the viewport, negated
+uniform float vtFeedbackBias;
+#endif
 
 void main() {
     // fragColor = vec4(0.7, 0.3, 0.3, 1.0);
+#ifdef TEXTURE_ATLAS
+    fragColor = texture(myTexture, vec3(myTextureCoord, atlasLayer));
+#elif defined(BINDLESS_TEXTURES)
+    fragColor = texture(sampler2D(handles[materialIndex]), myTextureCoord);
+#elif defined(VIRTUAL_TEXTURE)
+    fragColor = sampleVirtual(myTextureCoord);
+#elif defined(VIRTUAL_TEXTURE_FEEDBACK)
+    // the tile this pixel wants: x and y low bytes, their high nibbles, level
+    int level = virtualLevel(myTextureCoord, vtFeedbackBias);
+    ivec2 tile = ivec2(clamp(myTextureCoord, 0.0, 0.99999) * vec2(virtualLevelSize(level))) / int(vtSize.z);
+    fragColor = vec4(tile.x & 255, tile.y & 255, ((tile.x >> 8) & 15) | (((tile.y >> 8) & 15) << 4), level) / 255.0;
+#else
     fragColor = texture(myTexture, myTextureCoord);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FRUSTUM_CULLING_X86 1
+#include <immintrin.h>
+#endif
+
+// Frustum culling of instance bounds stored structure-of-arrays, so one SIMD lane
+// tests one instance against a plane. Each cull function writes the indices of the
+// visible instances, in order, to `visible` (room for every instance is needed) and
+// returns how many there were.
+//
+// On x86 GCC/MinGW the SSE2 and AVX2 kernels are compiled with target attributes and
+// picked at runtime, so no -mavx2 is needed in the makefile; elsewhere the scalar
+// loop is used.
+
+// plane i is (normal, distance) with normal pointing inside; order is left, right,
+// bottom, top, near, far
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+struct BoundingSphereSoA {
+    std::vector<float> x, y, z, radius;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    void push(const glm::vec3& center, float r) {
+        x.push_back(center.x);
+        y.push_back(center.y);
+        z.push_back(center.z);
+        radius.push_back(r);
+    }
+
+    void clear() {
+        x.clear();
+        y.clear();
+        z.clear();
+        radius.clear();
+    }
+};
+
+// axis aligned boxes as center and half extents
+struct BoundingBoxSoA {
+    std::vector<float> x, y, z, extentX, extentY, extentZ;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    void push(const glm::vec3& center, const glm::vec3& extent) {
+        x.push_back(center.x);
+        y.push_back(center.y);
+        z.push_back(center.z);
+        extentX.push_back(extent.x);
+        extentY.push_back(extent.y);
+        extentZ.push_back(extent.z);
+    }
+
+    void clear() {
+        x.clear();
+        y.clear();
+        z.clear();
+        extentX.clear();
+        extentY.clear();
+        extentZ.clear();
+    }
+};
+
+// Gribb/Hartmann plane extraction from a GL-style clip matrix (projection * view)
+inline Frustum extractFrustum(const glm::mat4& viewProjection) {
+    const glm::mat4& m = viewProjection;
+
+    // glm is column major: m[column][row]
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+
+    for(glm::vec4& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+inline size_t cullSpheresScalar(const Frustum& frustum, const BoundingSphereSoA& spheres, size_t begin, uint32_t* visible) {
+    size_t count = 0;
+
+    for(size_t i = begin; i < spheres.size(); ++i) {
+        bool inside = true;
+
+        for(const glm::vec4& plane : frustum.planes) {
+            float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] + plane.w;
+            inside &= distance >= -spheres.radius[i];
+        }
+
+        visible[count] = (uint32_t)i;
+        count += inside;
+    }
+
+    return count;
+}
+
+inline size_t cullBoxesScalar(const Frustum& frustum, const BoundingBoxSoA& boxes, size_t begin, uint32_t* visible) {
+    size_t count = 0;
+
+    for(size_t i = begin; i < boxes.size(); ++i) {
+        bool inside = true;
+
+        for(const glm::vec4& plane : frustum.planes) {
+            float distance = plane.x * boxes.x[i] + plane.y * boxes.y[i] + plane.z * boxes.z[i] + plane.w;
+            float extent = std::fabs(plane.x) * boxes.extentX[i] + std::fabs(plane.y) * boxes.extentY[i] + std::fabs(plane.z) * boxes.extentZ[i];
+            inside &= distance >= -extent;
+        }
+
+        visible[count] = (uint32_t)i;
+        count += inside;
+    }
+
+    return count;
+}
+
+#ifdef FRUSTUM_CULLING_X86
+
+// append the lane indices set in mask
+inline size_t compactVisible(unsigned int mask, size_t base, uint32_t* visible) {
+    size_t count = 0;
+
+    while(mask) {
+        visible[count++] = (uint32_t)(base + __builtin_ctz(mask));
+        mask &= mask - 1;
+    }
+
+    return count;
+}
+
+__attribute__((target("sse2")))
+inline size_t cullSpheresSSE2(const Frustum& frustum, const BoundingSphereSoA& spheres, uint32_t* visible) {
+    size_t n = spheres.size();
+    size_t simdEnd = n & ~(size_t)3;
+    size_t count = 0;
+
+    for(size_t i = 0; i < simdEnd; i += 4) {
+        __m128 x = _mm_loadu_ps(&spheres.x[i]);
+        __m128 y = _mm_loadu_ps(&spheres.y[i]);
+        __m128 z = _mm_loadu_ps(&spheres.z[i]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for(const glm::vec4& plane : frustum.planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                                         _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        count += compactVisible((unsigned int)_mm_movemask_ps(inside), i, visible + count);
+    }
+
+    return count + cullSpheresScalar(frustum, spheres, simdEnd, visible + count);
+}
+
+__attribute__((target("sse2")))
+inline size_t cullBoxesSSE2(const Frustum& frustum, const BoundingBoxSoA& boxes, uint32_t* visible) {
+    size_t n = boxes.size();
+    size_t simdEnd = n & ~(size_t)3;
+    size_t count = 0;
+
+    for(size_t i = 0; i < simdEnd; i += 4) {
+        __m128 x = _mm_loadu_ps(&boxes.x[i]);
+        __m128 y = _mm_loadu_ps(&boxes.y[i]);
+        __m128 z = _mm_loadu_ps(&boxes.z[i]);
+        __m128 extentX = _mm_loadu_ps(&boxes.extentX[i]);
+        __m128 extentY = _mm_loadu_ps(&boxes.extentY[i]);
+        __m128 extentZ = _mm_loadu_ps(&boxes.extentZ[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for(const glm::vec4& plane : frustum.planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                                         _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            __m128 extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(std::fabs(plane.x))), _mm_mul_ps(extentY, _mm_set1_ps(std::fabs(plane.y)))),
+                                       _mm_mul_ps(extentZ, _mm_set1_ps(std::fabs(plane.z))));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, extent), _mm_setzero_ps()));
+        }
+
+        count += compactVisible((unsigned int)_mm_movemask_ps(inside), i, visible + count);
+    }
+
+    return count + cullBoxesScalar(frustum, boxes, simdEnd, visible + count);
+}
+
+__attribute__((target("avx2,fma")))
+inline size_t cullSpheresAVX2(const Frustum& frustum, const BoundingSphereSoA& spheres, uint32_t* visible) {
+    size_t n = spheres.size();
+    size_t simdEnd = n & ~(size_t)7;
+    size_t count = 0;
+
+    for(size_t i = 0; i < simdEnd; i += 8) {
+        __m256 x = _mm256_loadu_ps(&spheres.x[i]);
+        __m256 y = _mm256_loadu_ps(&spheres.y[i]);
+        __m256 z = _mm256_loadu_ps(&spheres.z[i]);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for(const glm::vec4& plane : frustum.planes) {
+            __m256 distance = _mm256_fmadd_ps(x, _mm256_set1_ps(plane.x),
+                              _mm256_fmadd_ps(y, _mm256_set1_ps(plane.y),
+                              _mm256_fmadd_ps(z, _mm256_set1_ps(plane.z), _mm256_set1_ps(plane.w))));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+
+        count += compactVisible((unsigned int)_mm256_movemask_ps(inside), i, visible + count);
+    }
+
+    return count + cullSpheresScalar(frustum, spheres, simdEnd, visible + count);
+}
+
+__attribute__((target("avx2,fma")))
+inline size_t cullBoxesAVX2(const Frustum& frustum, const BoundingBoxSoA& boxes, uint32_t* visible) {
+    size_t n = boxes.size();
+    size_t simdEnd = n & ~(size_t)7;
+    size_t count = 0;
+
+    for(size_t i = 0; i < simdEnd; i += 8) {
+        __m256 x = _mm256_loadu_ps(&boxes.x[i]);
+        __m256 y = _mm256_loadu_ps(&boxes.y[i]);
+        __m256 z = _mm256_loadu_ps(&boxes.z[i]);
+        __m256 extentX = _mm256_loadu_ps(&boxes.extentX[i]);
+        __m256 extentY = _mm256_loadu_ps(&boxes.extentY[i]);
+        __m256 extentZ = _mm256_loadu_ps(&boxes.extentZ[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for(const glm::vec4& plane : frustum.planes) {
+            __m256 distance = _mm256_fmadd_ps(x, _mm256_set1_ps(plane.x),
+                              _mm256_fmadd_ps(y, _mm256_set1_ps(plane.y),
+                              _mm256_fmadd_ps(z, _mm256_set1_ps(plane.z), _mm256_set1_ps(plane.w))));
+            __m256 extent = _mm256_fmadd_ps(extentX, _mm256_set1_ps(std::fabs(plane.x)),
+                            _mm256_fmadd_ps(extentY, _mm256_set1_ps(std::fabs(plane.y)),
+                            _mm256_mul_ps(extentZ, _mm256_set1_ps(std::fabs(plane.z)))));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, extent), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        count += compactVisible((unsigned int)_mm256_movemask_ps(inside), i, visible + count);
+    }
+
+    return count + cullBoxesScalar(frustum, boxes, simdEnd, visible + count);
+}
+
+inline bool cullingHasAVX2() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+
+inline bool cullingHasSSE2() {
+    static const bool supported = __builtin_cpu_supports("sse2");
+    return supported;
+}
+
+#endif
+
+// best kernel available on this CPU
+inline size_t cullSpheres(const Frustum& frustum, const BoundingSphereSoA& spheres, uint32_t* visible) {
+#ifdef FRUSTUM_CULLING_X86
+    if(cullingHasAVX2()) {
+        return cullSpheresAVX2(frustum, spheres, visible);
+    }
+
+    if(cullingHasSSE2()) {
+        return cullSpheresSSE2(frustum, spheres, visible);
+    }
+#endif
+    return cullSpheresScalar(frustum, spheres, 0, visible);
+}
+
+inline size_t cullBoxes(const Frustum& frustum, const BoundingBoxSoA& boxes, uint32_t* visible) {
+#ifdef FRUSTUM_CULLING_X86
+    if(cullingHasAVX2()) {
+        return cullBoxesAVX2(frustum, boxes, visible);
+    }
+
+    if(cullingHasSSE2()) {
+        return cullBoxesSSE2(frustum, boxes, visible);
+    }
+#endif
+    return cullBoxesScalar(frustum, boxes, 0, visible);
+}
+
+// vector conveniences: resize `visible` to exactly the visible instances
+inline void cullSpheres(const Frustum& frustum, const BoundingSphereSoA& spheres, std::vector<uint32_t>& visible) {
+    visible.resize(spheres.size());
+    visible.resize(cullSpheres(frustum, spheres, visible.data()));
+}
+
+inline void cullBoxes(const Frustum& frustum, const BoundingBoxSoA& boxes, std::vector<uint32_t>& visible) {
+    visible.resize(boxes.size());
+    visible.resize(cullBoxes(frustum, boxes, visible.data()));
+}
+
+#endif
@@ -0,0 +1,347 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+#include "shader.h"
+
+// Shadow copy of the GL state render loops set over and over: the program, the
+// vertex array, buffer and texture bindings, the active texture unit and enable bits.
+// Every call compares against the copy and only reaches the driver when the value
+// actually changes; the rest are counted as elided, per frame and in total.
+//
+// The GL_ELEMENT_ARRAY_BUFFER binding belongs to the vertex array, so it is shadowed
+// per VAO: binding a VAO brings back the element buffer last bound with it, and
+// binding that buffer again costs nothing.
+//
+// Everything but the active texture unit starts unknown, so the first call of each
+// kind always goes through; a new context starts on unit 0, so GLState assumes that.
+// Code that changes the same state without going through GLState has to restore it
+// (like the helpers that save and rebind the previous binding) or call invalidate()
+// afterwards. Deleting through GLState forgets the names, since GL unbinds deleted
+// objects and would otherwise hand the same names out again.
+
+enum GLStateCall {
+    GL_STATE_PROGRAM,
+    GL_STATE_VERTEX_ARRAY,
+    GL_STATE_BUFFER,
+    GL_STATE_TEXTURE,
+    GL_STATE_ACTIVE_TEXTURE,
+    GL_STATE_CAPABILITY,
+    GL_STATE_CALL_KINDS
+};
+
+struct GLStateCounts {
+    unsigned int issued[GL_STATE_CALL_KINDS] = {};
+    unsigned int elided[GL_STATE_CALL_KINDS] = {};
+
+    unsigned int totalIssued() const {
+        unsigned int sum = 0;
+
+        for(unsigned int count : issued) {
+            sum += count;
+        }
+
+        return sum;
+    }
+
+    unsigned int totalElided() const {
+        unsigned int sum = 0;
+
+        for(unsigned int count : elided) {
+            sum += count;
+        }
+
+        return sum;
+    }
+};
+
+struct GLStateStats {
+    // the frame in progress, the last one endFrame() closed, and every frame since reset
+    GLStateCounts frame;
+    GLStateCounts lastFrame;
+    GLStateCounts total;
+    unsigned int frames = 0;
+};
+
+const int GL_STATE_TEXTURE_UNITS = 32;
+
+class GLState {
+    public:
+    GLStateStats stats;
+
+    GLState() {
+        invalidate();
+        activeUnit = 0;
+    }
+
+    // forget everything, after code that changed state behind GLState's back
+    void invalidate() {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        elementBuffers.clear();
+
+        for(GLuint& buffer : buffers) {
+            buffer = UNKNOWN;
+        }
+
+        for(int unit = 0; unit < GL_STATE_TEXTURE_UNITS; ++unit) {
+            for(GLuint& texture : textures[unit]) {
+                texture = UNKNOWN;
+            }
+        }
+
+        capabilities.clear();
+    }
+
+    void beginFrame() {
+        stats.frame = GLStateCounts();
+    }
+
+    void endFrame() {
+        for(int kind = 0; kind < GL_STATE_CALL_KINDS; ++kind) {
+            stats.total.issued[kind] += stats.frame.issued[kind];
+            stats.total.elided[kind] += stats.frame.elided[kind];
+        }
+
+        stats.lastFrame = stats.frame;
+        stats.frames++;
+    }
+
+    void useProgram(GLuint name) {
+        if(count(GL_STATE_PROGRAM, program != name)) {
+            glUseProgram(name);
+            program = name;
+        }
+    }
+
+    // Shader::use() also finishes a deferred build, so it goes through that
+    void useProgram(Shader& shader) {
+        if(count(GL_STATE_PROGRAM, program != shader.shaderProgram)) {
+            shader.use();
+            program = shader.shaderProgram;
+        }
+    }
+
+    void bindVertexArray(GLuint name) {
+        if(count(GL_STATE_VERTEX_ARRAY, vertexArray != name)) {
+            glBindVertexArray(name);
+            vertexArray = name;
+        }
+    }
+
+    void bindBuffer(GLenum target, GLuint name) {
+        if(target == GL_ELEMENT_ARRAY_BUFFER) {
+            bindElementBuffer(name);
+            return;
+        }
+
+        int slot = bufferSlot(target);
+
+        // targets without a shadow copy always go through
+        if(count(GL_STATE_BUFFER, slot < 0 || buffers[slot] != name)) {
+            glBindBuffer(target, name);
+
+            if(slot >= 0) {
+                buffers[slot] = name;
+            }
+        }
+    }
+
+    void activeTexture(GLuint unit) {
+        if(count(GL_STATE_ACTIVE_TEXTURE, activeUnit != unit)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+    }
+
+    // on the active unit, like glBindTexture
+    void bindTexture(GLenum target, GLuint name) {
+        int slot = textureSlot(target);
+        bool unitKnown = activeUnit < (GLuint)GL_STATE_TEXTURE_UNITS;
+
+        if(count(GL_STATE_TEXTURE, slot < 0 || !unitKnown || textures[activeUnit][slot] != name)) {
+            glBindTexture(target, name);
+
+            if(slot >= 0 && unitKnown) {
+                textures[activeUnit][slot] = name;
+            }
+        }
+    }
+
+    // only switches units when the texture isn't already bound there
+    void bindTexture(GLuint unit, GLenum target, GLuint name) {
+        int slot = textureSlot(target);
+
+        if(slot >= 0 && unit < (GLuint)GL_STATE_TEXTURE_UNITS && textures[unit][slot] == name) {
+            count(GL_STATE_TEXTURE, false);
+            return;
+        }
+
+        activeTexture(unit);
+        bindTexture(target, name);
+    }
+
+    void enable(GLenum capability) {
+        setCapability(capability, true);
+    }
+
+    void disable(GLenum capability) {
+        setCapability(capability, false);
+    }
+
+    void setCapability(GLenum capability, bool enabled) {
+        auto found = capabilities.find(capability);
+
+        if(count(GL_STATE_CAPABILITY, found == capabilities.end() || found->second != enabled)) {
+            if(enabled) {
+                glEnable(capability);
+            }
+            else {
+                glDisable(capability);
+            }
+
+            capabilities[capability] = enabled;
+        }
+    }
+
+    void deleteProgram(GLuint name) {
+        glDeleteProgram(name);
+
+        if(program == name) {
+            program = UNKNOWN;
+        }
+    }
+
+    void deleteVertexArrays(GLsizei n, const GLuint* names) {
+        glDeleteVertexArrays(n, names);
+
+        for(GLsizei i = 0; i < n; ++i) {
+            elementBuffers.erase(names[i]);
+
+            if(vertexArray == names[i]) {
+                vertexArray = 0;
+            }
+        }
+    }
+
+    void deleteBuffers(GLsizei n, const GLuint* names) {
+        glDeleteBuffers(n, names);
+
+        for(GLsizei i = 0; i < n; ++i) {
+            for(GLuint& buffer : buffers) {
+                if(buffer == names[i]) {
+                    buffer = 0;
+                }
+            }
+
+            // GL only detaches it from the bound VAO, but forgetting it everywhere is safe
+            for(auto it = elementBuffers.begin(); it != elementBuffers.end(); ) {
+                it = it->second == names[i] ? elementBuffers.erase(it) : std::next(it);
+            }
+        }
+    }
+
+    void deleteTextures(GLsizei n, const GLuint* names) {
+        glDeleteTextures(n, names);
+
+        for(GLsizei i = 0; i < n; ++i) {
+            for(int unit = 0; unit < GL_STATE_TEXTURE_UNITS; ++unit) {
+                for(GLuint& texture : textures[unit]) {
+                    if(texture == names[i]) {
+                        texture = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    private:
+    static const GLuint UNKNOWN = ~(GLuint)0;
+    static const int BUFFER_TARGETS = 8;
+    static const int TEXTURE_TARGETS = 5;
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint activeUnit;
+    GLuint buffers[BUFFER_TARGETS];
+    GLuint textures[GL_STATE_TEXTURE_UNITS][TEXTURE_TARGETS];
+    // VAO -> the element buffer bound with it
+    std::unordered_map<GLuint, GLuint> elementBuffers;
+    std::unordered_map<GLenum, bool> capabilities;
+
+    // true when the call has to be issued
+    bool count(GLStateCall kind, bool changed) {
+        if(changed) {
+            stats.frame.issued[kind]++;
+        }
+        else {
+            stats.frame.elided[kind]++;
+        }
+
+        return changed;
+    }
+
+    void bindElementBuffer(GLuint name) {
+        // with the VAO unknown there is nothing to compare against or record under
+        if(vertexArray == UNKNOWN) {
+            count(GL_STATE_BUFFER, true);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, name);
+            return;
+        }
+
+        auto found = elementBuffers.find(vertexArray);
+
+        if(count(GL_STATE_BUFFER, found == elementBuffers.end() || found->second != name)) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, name);
+            elementBuffers[vertexArray] = name;
+        }
+    }
+
+    static int bufferSlot(GLenum target) {
+        switch(target) {
+            case GL_ARRAY_BUFFER: return 0;
+            case GL_UNIFORM_BUFFER: return 1;
+            case GL_PIXEL_UNPACK_BUFFER: return 2;
+            case GL_PIXEL_PACK_BUFFER: return 3;
+            case GL_COPY_READ_BUFFER: return 4;
+            case GL_COPY_WRITE_BUFFER: return 5;
+            case GL_DRAW_INDIRECT_BUFFER: return 6;
+            case GL_SHADER_STORAGE_BUFFER: return 7;
+            default: return -1;
+        }
+    }
+
+    static int textureSlot(GLenum target) {
+        switch(target) {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_2D_ARRAY: return 1;
+            case GL_TEXTURE_CUBE_MAP: return 2;
+            case GL_TEXTURE_3D: return 3;
+            case GL_TEXTURE_2D_MULTISAMPLE: return 4;
+            default: return -1;
+        }
+    }
+};
+
+inline void printGLStateStats(const GLState& state) {
+    static const char* names[GL_STATE_CALL_KINDS] = {"program", "vertex array", "buffer", "texture", "active texture", "enable"};
+
+    const GLStateStats& stats = state.stats;
+    unsigned int frames = stats.frames > 0 ? stats.frames : 1;
+
+    std::cout << "GL::STATE: " << stats.frames << " frame(s), per frame " << (double)stats.total.totalIssued() / frames << " call(s) issued, "
+              << (double)stats.total.totalElided() / frames << " elided" << std::endl;
+
+    for(int kind = 0; kind < GL_STATE_CALL_KINDS; ++kind) {
+        if(stats.total.issued[kind] + stats.total.elided[kind] > 0) {
+            std::cout << "GL::STATE:   " << names[kind] << ": " << (double)stats.total.issued[kind] / frames << " issued, "
+                      << (double)stats.total.elided[kind] / frames << " elided" << std::endl;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,238 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shaderLibrary.h"
+#include "cameraBuffer.h"
+#include "cubeMesh.h"
+#include "glState.h"
+#include "benchFrames.h"
+
+// Per-object draw loops that set program, texture and VAO before every draw, the way
+// the render loops here do, straight to GL against through GLState. Objects come in
+// runs that share state, like the meshes of one model, so most of those calls change
+// nothing.
+
+const int PROGRAM_COUNT = 4;
+const int TEXTURE_COUNT = 16;
+const int VAO_COUNT = 4;
+
+struct Object {
+    int program;
+    int texture;
+    int vertexArray;
+    glm::mat4 model;
+};
+
+struct Scene {
+    std::vector<Shader*> programs;
+    std::vector<GLint> modelLocations;
+    std::vector<unsigned int> textures;
+    std::vector<unsigned int> vertexArrays;
+    std::vector<Object> objects;
+    GLState* state;
+};
+
+void drawDirect(Scene& scene) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    for(const Object& object : scene.objects) {
+        glUseProgram(scene.programs[object.program]->shaderProgram);
+        glBindTexture(GL_TEXTURE_2D, scene.textures[object.texture]);
+        glBindVertexArray(scene.vertexArrays[object.vertexArray]);
+        scene.programs[object.program]->setMat4(scene.modelLocations[object.program], object.model);
+        glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+    }
+}
+
+void drawTracked(Scene& scene) {
+    GLState& state = *scene.state;
+    state.beginFrame();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    for(const Object& object : scene.objects) {
+        state.useProgram(scene.programs[object.program]->shaderProgram);
+        state.bindTexture(0, GL_TEXTURE_2D, scene.textures[object.texture]);
+        state.bindVertexArray(scene.vertexArrays[object.vertexArray]);
+        scene.programs[object.program]->setMat4(scene.modelLocations[object.program], object.model);
+        glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+    }
+
+    state.endFrame();
+}
+
+// binding what is already bound has to be elided, or the numbers below mean nothing
+bool checkElision(unsigned int texture, unsigned int vertexArray) {
+    GLState state;
+    state.beginFrame();
+
+    for(int i = 0; i < 2; ++i) {
+        state.bindTexture(GL_TEXTURE_2D, texture);
+        state.bindTexture(0, GL_TEXTURE_2D, texture);
+        state.bindVertexArray(vertexArray);
+    }
+
+    const GLStateCounts& frame = state.stats.frame;
+    bool elided = frame.issued[GL_STATE_TEXTURE] == 1 && frame.elided[GL_STATE_TEXTURE] == 3 && frame.issued[GL_STATE_ACTIVE_TEXTURE] == 0
+               && frame.issued[GL_STATE_VERTEX_ARRAY] == 1 && frame.elided[GL_STATE_VERTEX_ARRAY] == 1;
+
+    if(!elided) {
+        std::cout << "ERROR::GL_STATE_BENCH::REPEATED_BIND_ISSUED: texture " << frame.issued[GL_STATE_TEXTURE] << " issued, " << frame.elided[GL_STATE_TEXTURE]
+                  << " elided; vertex array " << frame.issued[GL_STATE_VERTEX_ARRAY] << " issued, " << frame.elided[GL_STATE_VERTEX_ARRAY] << " elided" << std::endl;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+
+    return elided;
+}
+
+// runs of objects: a program switch every ~500, texture every ~50, VAO every ~10
+std::vector<Object> makeObjects(size_t count) {
+    std::vector<Object> objects(count);
+    int program = 0, texture = 0, vertexArray = 0;
+
+    for(size_t i = 0; i < count; ++i) {
+        if(rand() % 500 == 0) {
+            program = rand() % PROGRAM_COUNT;
+        }
+
+        if(rand() % 50 == 0) {
+            texture = rand() % TEXTURE_COUNT;
+        }
+
+        if(rand() % 10 == 0) {
+            vertexArray = rand() % VAO_COUNT;
+        }
+
+        glm::vec3 position((rand() % 2000) / 10.0f - 100.0f, (rand() % 2000) / 10.0f - 100.0f, (rand() % 2000) / 10.0f - 100.0f);
+        objects[i] = {program, texture, vertexArray, glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.5f))};
+    }
+
+    return objects;
+}
+
+int main() {
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(600, 600, "GL state benchmark", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    // don't let vsync cap the measurement
+    glfwSwapInterval(0);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    Scene scene;
+    ShaderLibrary shaders;
+
+    // the define only makes the permutations separate programs
+    for(int i = 0; i < PROGRAM_COUNT; ++i) {
+        scene.programs.push_back(&shaders.variant("vertexShader.glsl", "fragmentShader.glsl", {{"BENCH_PROGRAM", std::to_string(i)}}));
+    }
+
+    shaders.finishAll();
+
+    for(Shader* program : scene.programs) {
+        scene.modelLocations.push_back(program->uniform("model"));
+    }
+
+    scene.textures.resize(TEXTURE_COUNT);
+    glGenTextures(TEXTURE_COUNT, scene.textures.data());
+
+    for(int i = 0; i < TEXTURE_COUNT; ++i) {
+        unsigned char texel[4] = {(unsigned char)(i * 16), (unsigned char)(255 - i * 16), 128, 255};
+        glBindTexture(GL_TEXTURE_2D, scene.textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    }
+
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+    scene.vertexArrays.resize(VAO_COUNT);
+    glGenVertexArrays(VAO_COUNT, scene.vertexArrays.data());
+
+    for(unsigned int VAO : scene.vertexArrays) {
+        glBindVertexArray(VAO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE, nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE, (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    CameraBuffer camera;
+    camera.create();
+    camera.update(glm::lookAt(glm::vec3(0.0f, 0.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+                  glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 500.0f));
+
+    glEnable(GL_DEPTH_TEST);
+
+    if(!checkElision(scene.textures[0], scene.vertexArrays[0])) {
+        return -1;
+    }
+
+    GLState state;
+    scene.state = &state;
+
+    const size_t counts[] = {1000, 10000, 50000};
+
+    std::cout << glGetString(GL_RENDERER) << std::endl;
+    std::cout << "objects    direct ms   tracked ms   speedup   calls issued   elided" << std::endl;
+
+    for(size_t count : counts) {
+        srand(1234);
+        scene.objects = makeObjects(count);
+
+        double directMs = timeFrames(window, drawDirect, scene);
+
+        // the direct loop bound things behind the tracker's back
+        state.invalidate();
+        double trackedMs = timeFrames(window, drawTracked, scene);
+
+        const GLStateCounts& frame = state.stats.lastFrame;
+        printf("%-10zu %-11.3f %-12.3f %-9.2f %-14u %u\n", count, directMs, trackedMs, directMs / trackedMs, frame.totalIssued(), frame.totalElided());
+    }
+
+    printGLStateStats(state);
+
+    camera.destroy();
+    glDeleteTextures(TEXTURE_COUNT, scene.textures.data());
+    glDeleteVertexArrays(VAO_COUNT, scene.vertexArrays.data());
+    glDeleteBuffers(1, &VBO);
+
+    for(Shader* program : scene.programs) {
+        glDeleteProgram(program->shaderProgram);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
@@ -0,0 +1,242 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "ringBuffer.h"
+
+// Per-instance model matrices for glDrawArraysInstanced. The matrix is fed to the
+// INSTANCED permutation of vertexShader.glsl as a mat4 attribute, which takes four
+// consecutive locations (one vec4 column each) advancing once per instance.
+// Matrices are rewritten every frame, so they live in a StreamRingBuffer: per frame,
+// upload() and draw as often as needed, then endFrame().
+//
+// Attached with materials, each instance also carries a uint index into the Materials
+// block (textureAtlas.h) at INSTANCE_MATERIAL_LOCATION, stored after the matrices in
+// the same ring region.
+
+const unsigned int INSTANCE_MODEL_LOCATION = 2;
+const unsigned int INSTANCE_MATERIAL_LOCATION = 7;
+
+class InstanceBuffer {
+    public:
+    // per-frame instance data is streamed through a persistent mapped ring
+    StreamRingBuffer ring;
+    unsigned int VAO = 0;
+    unsigned int location = INSTANCE_MODEL_LOCATION;
+    bool materials = false;
+    // GL 4.3 / ARB_vertex_attrib_binding: moving to the next ring region is one
+    // glBindVertexBuffer per stream instead of re-specifying every attribute
+    bool attribBinding = false;
+
+    // instances uploaded by the last upload() and how many fit in one frame
+    size_t count = 0;
+    size_t capacity = 0;
+
+    void create(size_t maxInstances = 1024) {
+        capacity = maxInstances;
+        ring.create(GL_ARRAY_BUFFER, capacity * INSTANCE_BYTES);
+        attribBinding = GLEW_VERSION_4_3 || GLEW_ARB_vertex_attrib_binding;
+    }
+
+    // add the instance matrix attribute to a VAO that already holds the mesh attributes
+    void attach(unsigned int vertexArray, unsigned int firstLocation = INSTANCE_MODEL_LOCATION, bool withMaterials = false) {
+        VAO = vertexArray;
+        location = firstLocation;
+        materials = withMaterials;
+
+        glBindVertexArray(VAO);
+
+        for(unsigned int column = 0; column < 4; ++column) {
+            glEnableVertexAttribArray(location + column);
+        }
+
+        if(materials) {
+            glEnableVertexAttribArray(INSTANCE_MATERIAL_LOCATION);
+        }
+
+        if(attribBinding) {
+            // the streams take the binding points of their first locations, which no mesh attribute uses
+            for(unsigned int column = 0; column < 4; ++column) {
+                glVertexAttribFormat(location + column, 4, GL_FLOAT, GL_FALSE, column * sizeof(glm::vec4));
+                glVertexAttribBinding(location + column, location);
+            }
+
+            glVertexBindingDivisor(location, 1);
+
+            if(materials) {
+                glVertexAttribIFormat(INSTANCE_MATERIAL_LOCATION, 1, GL_UNSIGNED_INT, 0);
+                glVertexAttribBinding(INSTANCE_MATERIAL_LOCATION, INSTANCE_MATERIAL_LOCATION);
+                glVertexBindingDivisor(INSTANCE_MATERIAL_LOCATION, 1);
+            }
+        }
+        else {
+            for(unsigned int column = 0; column < 4; ++column) {
+                glVertexAttribDivisor(location + column, 1);
+            }
+
+            if(materials) {
+                glVertexAttribDivisor(INSTANCE_MATERIAL_LOCATION, 1);
+            }
+        }
+
+        // the VAO is bound anyway, so give the attributes a buffer before the first draw
+        attributeOffset = materialOffset = (size_t)-1;
+        pointAttributes(0, 0);
+
+        glBindVertexArray(0);
+    }
+
+    // Write instances into this frame's ring region; draws after it read them. The
+    // first upload of a frame moves to the next region, later ones add to the same
+    // region, until endFrame(). Running past capacity reallocates the ring at twice the size.
+    // materialIndices may be null, which gives every instance material 0.
+    void upload(const glm::mat4* models, const uint32_t* materialIndices, size_t instanceCount) {
+        size_t modelBytes = instanceCount * sizeof(glm::mat4);
+        size_t bytes = modelBytes + (materials ? instanceCount * sizeof(uint32_t) : 0);
+
+        // where the ring will put it, allocations being 16 byte aligned
+        size_t start = frameOpen ? (frameBytes + 15) / 16 * 16 : 0;
+
+        if(start + bytes > ring.regionSize) {
+            ring.destroy();
+            capacity = instanceCount > capacity * 2 ? instanceCount : capacity * 2;
+            ring.create(GL_ARRAY_BUFFER, capacity * INSTANCE_BYTES);
+
+            // new buffer object, so the attributes must be re-pointed even at the same offset;
+            // draws already issued this frame keep reading the old one
+            attributeOffset = materialOffset = (size_t)-1;
+            frameOpen = false;
+            start = 0;
+        }
+
+        if(!frameOpen) {
+            ring.beginFrame();
+            frameOpen = true;
+            frameBytes = 0;
+        }
+
+        RingAllocation allocation = ring.allocate(bytes);
+
+        if(!allocation.pointer) {
+            count = 0;
+            return;
+        }
+
+        memcpy(allocation.pointer, models, modelBytes);
+
+        if(materials && materialIndices) {
+            memcpy((char*)allocation.pointer + modelBytes, materialIndices, instanceCount * sizeof(uint32_t));
+        }
+        else if(materials) {
+            memset((char*)allocation.pointer + modelBytes, 0, instanceCount * sizeof(uint32_t));
+        }
+
+        ring.flush();
+
+        uploadOffset = allocation.offset;
+        uploadMaterialOffset = allocation.offset + modelBytes;
+        frameBytes = start + bytes;
+        count = instanceCount;
+    }
+
+    void upload(const glm::mat4* models, size_t instanceCount) {
+        upload(models, nullptr, instanceCount);
+    }
+
+    void upload(const std::vector<glm::mat4>& models) {
+        upload(models.data(), models.size());
+    }
+
+    void upload(const std::vector<glm::mat4>& models, const std::vector<uint32_t>& materialIndices) {
+        upload(models.data(), materialIndices.data(), models.size());
+    }
+
+    // Point the instance attributes at the last upload, for draws made some other way
+    // (e.g. a DrawCommandBuffer); the VAO passed to attach() must be bound. Only does
+    // anything when the data moved, normally once a frame.
+    void bindAttributes() {
+        pointAttributes(uploadOffset, uploadMaterialOffset);
+    }
+
+    // one draw for every uploaded instance; the VAO passed to attach() must be bound
+    void drawArrays(GLenum mode, GLint first, GLsizei vertexCount) {
+        bindAttributes();
+        glDrawArraysInstanced(mode, first, vertexCount, (GLsizei)count);
+    }
+
+    // indexed version of drawArrays(); the VAO's element buffer supplies the indices
+    void drawElements(GLenum mode, GLsizei indexCount, GLenum indexType, size_t firstIndexOffset = 0) {
+        bindAttributes();
+        glDrawElementsInstanced(mode, indexCount, indexType, (void*)firstIndexOffset, (GLsizei)count);
+    }
+
+    // after the frame's last draw: fence the region so it isn't rewritten while those
+    // draws still read it; the next upload() starts a new frame
+    void endFrame() {
+        if(frameOpen) {
+            ring.endFrame();
+            frameOpen = false;
+        }
+    }
+
+    void destroy() {
+        ring.destroy();
+        count = 0;
+        capacity = 0;
+        frameOpen = false;
+        frameBytes = 0;
+    }
+
+    private:
+    // room for a matrix and a material index per instance, whether or not materials are used
+    static const size_t INSTANCE_BYTES = sizeof(glm::mat4) + sizeof(uint32_t);
+
+    bool frameOpen = false;
+    // bytes of the current region used by this frame's uploads
+    size_t frameBytes = 0;
+
+    // where the last upload put its data, and where the attributes point now
+    size_t uploadOffset = 0;
+    size_t uploadMaterialOffset = 0;
+    size_t attributeOffset = (size_t)-1;
+    size_t materialOffset = (size_t)-1;
+
+    // VAO state, set while the VAO is bound
+    void pointAttributes(size_t offset, size_t materialsAt) {
+        // the material stream follows the matrices, so it moves with the instance count too
+        if((offset == attributeOffset && (!materials || materialsAt == materialOffset)) || VAO == 0) {
+            return;
+        }
+
+        attributeOffset = offset;
+        materialOffset = materialsAt;
+
+        if(attribBinding) {
+            glBindVertexBuffer(location, ring.buffer, offset, sizeof(glm::mat4));
+
+            if(materials) {
+                glBindVertexBuffer(INSTANCE_MATERIAL_LOCATION, ring.buffer, materialsAt, sizeof(uint32_t));
+            }
+
+            return;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+
+        for(unsigned int column = 0; column < 4; ++column) {
+            glVertexAttribPointer(location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+        }
+
+        if(materials) {
+            glVertexAttribIPointer(INSTANCE_MATERIAL_LOCATION, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)materialsAt);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shaderLibrary.h"
+#include "cameraBuffer.h"
+#include "instancing.h"
+#include "cubeMesh.h"
+#include "benchFrames.h"
+
+// Compares drawing N cubes with one glUniformMatrix4fv + glDrawArrays per cube against
+// a single glDrawArraysInstanced fed from an InstanceBuffer, at 1k/10k/100k cubes.
+
+struct Scene {
+    Shader* perDrawShader;
+    Shader* instancedShader;
+    GLint modelLocation;
+    unsigned int VAO;
+    InstanceBuffer* instances;
+    std::vector<glm::mat4> models;
+};
+
+void drawPerCube(void* context) {
+    Scene& scene = *(Scene*)context;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.perDrawShader->use();
+    glBindVertexArray(scene.VAO);
+
+    for(const glm::mat4& model : scene.models) {
+        scene.perDrawShader->setMat4(scene.modelLocation, model);
+        glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+    }
+}
+
+void drawInstanced(void* context) {
+    Scene& scene = *(Scene*)context;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.instancedShader->use();
+    glBindVertexArray(scene.VAO);
+
+    // matrices are re-uploaded every frame, as a scene with moving instances would
+    scene.instances->upload(scene.models);
+    scene.instances->drawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+    scene.instances->endFrame();
+}
+
+int main() {
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(600, 600, "Instancing benchmark", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    // don't let vsync cap the measurement
+    glfwSwapInterval(0);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    ShaderLibrary shaders;
+    Shader& perDrawShader = shaders.variant("vertexShader.glsl", "fragmentShader.glsl");
+    Shader& instancedShader = shaders.variant("vertexShader.glsl", "fragmentShader.glsl", {{"INSTANCED", ""}});
+    shaders.finishAll();
+
+    unsigned int VAO, VBO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE, nullptr);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    InstanceBuffer instances;
+    instances.create();
+    instances.attach(VAO);
+
+    CameraBuffer camera;
+    camera.create();
+    camera.update(glm::lookAt(glm::vec3(0.0f, 0.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+                  glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 500.0f));
+
+    glEnable(GL_DEPTH_TEST);
+
+    Scene scene;
+    scene.perDrawShader = &perDrawShader;
+    scene.instancedShader = &instancedShader;
+    scene.modelLocation = perDrawShader.uniform("model");
+    scene.VAO = VAO;
+    scene.instances = &instances;
+
+    const size_t counts[] = {1000, 10000, 100000};
+
+    std::cout << "cubes      per-draw ms   instanced ms   speedup   instanced cubes/ms" << std::endl;
+
+    for(size_t count : counts) {
+        scene.models.resize(count);
+        srand(1234);
+
+        for(glm::mat4& model : scene.models) {
+            glm::vec3 position((rand() % 2000) / 10.0f - 100.0f, (rand() % 2000) / 10.0f - 100.0f, (rand() % 2000) / 10.0f - 100.0f);
+            model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.5f));
+        }
+
+        double perDrawMs = timeFrames(window, drawPerCube, &scene);
+        double instancedMs = timeFrames(window, drawInstanced, &scene);
+
+        printf("%-10zu %-13.3f %-14.3f %-9.2f %.0f\n", count, perDrawMs, instancedMs, perDrawMs / instancedMs, count / instancedMs);
+    }
+
+    instances.destroy();
+    camera.destroy();
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteProgram(perDrawShader.shaderProgram);
+    glDeleteProgram(instancedShader.shaderProgram);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
@@ -0,0 +1,103 @@
+#ifndef LOCK_FREE_QUEUE_H
+#define LOCK_FREE_QUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Bounded multi-producer multi-consumer queue (Dmitry Vyukov's design). Every slot
+// carries a sequence number that tells producers and consumers whose turn it is, so
+// push and pop are one compare-and-swap on the shared position plus a store, and
+// never take a lock. Capacity is rounded up to a power of two.
+
+template<typename T>
+class LockFreeQueue {
+    public:
+    explicit LockFreeQueue(size_t minCapacity = 1024) {
+        size_t capacity = 2;
+
+        while(capacity < minCapacity) {
+            capacity *= 2;
+        }
+
+        slots = std::vector<Slot>(capacity);
+        mask = capacity - 1;
+
+        for(size_t i = 0; i < capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    // false when full
+    bool push(T value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+
+        for(;;) {
+            Slot& slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+            if(difference == 0) {
+                if(tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(difference < 0) {
+                return false;
+            }
+            else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // false when empty
+    bool pop(T& value) {
+        size_t position = head.load(std::memory_order_relaxed);
+
+        for(;;) {
+            Slot& slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+            if(difference == 0) {
+                if(head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(slot.value);
+                    slot.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(difference < 0) {
+                return false;
+            }
+            else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+
+        Slot() : sequence(0), value() {}
+        Slot(const Slot&) : sequence(0), value() {}
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+
+    // producers and consumers on separate cache lines
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<size_t> head{0};
+};
+
+#endif
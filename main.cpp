@@ -6,88 +6,18 @@
 #include <string>
 #include <cstring>
 #include <filesystem>
+#include "shaderLibrary.h"
 
 using std::vector;
 using std::array;
 using std::string;
 
-const char *vertexShaderSource = R"(
-    #version 330 core
-    
-    layout (location = 0) in vec3 aPos;
-    layout (location = 1) in vec3 aColor;
-
-    uniform vec3 npos;
-    uniform float scale;
-
-    out vec3 myColor;
-
-    void main() {
-        gl_Position = vec4((aPos.x * scale) + npos.x, (aPos.y * scale) + npos.y, aPos.z + npos.z, 1.0);
-        // gl_Position = vec4(npos, 1.0);
-        myColor = aColor;
-    }
-)";
-
-const char *fragmentShaderSource = R"(
-    #version 330 core
-
-    out vec4 FragColor;
-
-    in vec3 myColor;
-
-    void main() {
-        // FragColor = vec4(1.0f, 0.5f, 0.2f, 1.0f);
-        FragColor = vec4(myColor, 1.0f);
-    }
-)";
-
 void processInput(GLFWwindow *window) {
     if(glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
 }
 
-unsigned int initVertexShader() {
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-
-    // Attach the shader source code to the shader object
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-
-    // compile the shader:
-    glCompileShader(vertexShader);
-
-    return vertexShader;
-}
-
-unsigned int initFragmentShader() {
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-
-    glCompileShader(fragmentShader);
-
-    return fragmentShader;
-}
-
-void shaderCheckSuccess(unsigned int shader, string type, int success, char infoLog[512]) {
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-
-    if(!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::" << type << "::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-}
-
-void checkLinkSuccess(unsigned int shaderProgram, int success, char infoLog[512]) {
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-}
-
 float xOffset = 0.0f;
 float yOffset = 0.0f;
 
@@ -136,32 +66,11 @@ int main() {
     glfwSetCursorPosCallback(window, cursor_callback);
 
     // SHADERS
-    int success = 0;
-    char infoLog[512];
+    // quadVertexShader.glsl/quadFragmentShader.glsl are shared with texture.cpp; this is the untextured permutation
+    ShaderLibrary shaders;
+    Shader& quadShader = shaders.variant("quadVertexShader.glsl", "quadFragmentShader.glsl");
 
-    // VERTEX SHADER
-    unsigned int vertexShader = initVertexShader();
-
-    shaderCheckSuccess(vertexShader, "VERTEX", success, infoLog);
-
-    // FRAGMENT SHADER
-    unsigned int fragmentShader = initFragmentShader();
-
-    shaderCheckSuccess(fragmentShader, "FRAGMENT", success, infoLog);
-
-    // link shaders
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // check for linking errors
-    checkLinkSuccess(shaderProgram, success, infoLog);
-
-    glUseProgram(shaderProgram);
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    quadShader.use();
 
     /* float vertices[] = {
         -0.5f, -0.5f, 0.0f, 0.3f, 0.5f, 0.7f,
@@ -228,6 +137,10 @@ int main() {
 
     // double xpos, ypos;
 
+    // uniform locations don't change after linking, so look them up once instead of every frame
+    int positionLocation = quadShader.uniform("npos");
+    int scaleLocation = quadShader.uniform("scale");
+
     // Loop until the user closes the window
     while (!glfwWindowShouldClose(window)) {
         // Render here
@@ -241,10 +154,7 @@ int main() {
 
         // printf("xoff: %f, yoff: %f\n", xOffset, yOffset);
 
-        int positionLocation = glGetUniformLocation(shaderProgram, "npos");
         glUniform3f(positionLocation, xOffset, yOffset, 0.0f);
-
-        int scaleLocation = glGetUniformLocation(shaderProgram, "scale");
         glUniform1f(scaleLocation, 0.5f);
 
         // Draw a triangle
@@ -274,6 +184,7 @@ int main() {
 
     glDeleteBuffers(1, &VBO);
     glDeleteVertexArrays(1, &VAO);
+    glDeleteProgram(quadShader.shaderProgram);
 
     // Clean up
     glfwDestroyWindow(window);
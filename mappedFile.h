@@ -0,0 +1,136 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+// keep the min/max macros from breaking std::min/std::max in every includer
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Read-only memory mapping of a whole file. The OS pages the data in on demand, so
+// nothing is read or copied until a byte is actually touched. Files read front to back
+// are opened sequential (read ahead as a whole); the rest, like virtual texture page
+// files, only fault in the pages that are touched.
+class MappedFile {
+    public:
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+    MappedFile() = default;
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path, bool sequential = true) {
+        close();
+
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, NULL);
+
+        if(file == INVALID_HANDLE_VALUE) {
+            std::cout << "ERROR::MAPPED_FILE::OPEN_FAILED: " << path << std::endl;
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        size = (size_t)fileSize.QuadPart;
+
+        if(size > 0) {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            data = mapping ? (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        }
+#else
+        fd = ::open(path, O_RDONLY);
+
+        if(fd < 0) {
+            std::cout << "ERROR::MAPPED_FILE::OPEN_FAILED: " << path << std::endl;
+            return false;
+        }
+
+        struct stat info;
+        fstat(fd, &info);
+        size = (size_t)info.st_size;
+
+        if(size > 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            data = mapped == MAP_FAILED ? nullptr : (const unsigned char*)mapped;
+
+            if(data && sequential) {
+                // mapped files are read front to back, and usually all of them
+                madvise(mapped, size, MADV_SEQUENTIAL);
+                madvise(mapped, size, MADV_WILLNEED);
+            }
+            else if(data) {
+                madvise(mapped, size, MADV_RANDOM);
+            }
+        }
+#endif
+
+        if(size > 0 && !data) {
+            std::cout << "ERROR::MAPPED_FILE::MAP_FAILED: " << path << std::endl;
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if(data) {
+            UnmapViewOfFile(data);
+        }
+
+        if(mapping) {
+            CloseHandle(mapping);
+        }
+
+        if(file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if(data) {
+            munmap((void*)data, size);
+        }
+
+        if(fd >= 0) {
+            ::close(fd);
+        }
+
+        fd = -1;
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <GL/glew.h>
+#include "meshFile.h"
+#include "objLoader.h"
+#include "meshOptimizer.h"
+#include "cubeMesh.h"
+
+// Offline converter to the .mesh format (see meshFile.h). No GL context is needed.
+//
+//   meshConvert model.obj out.mesh        Wavefront OBJ, see objLoader.h
+//   meshConvert --cube-grid N out.mesh    N*N*N indexed cubes, 12 triangles each
+//
+// Triangles are reordered for the post-transform vertex cache and vertices for fetch
+// locality (meshOptimizer.h). Output vertices are position (location 0) and texture
+// coordinate (location 1), the layout vertexShader.glsl reads. The cube grid is a way
+// to produce multi-million triangle files for meshLoadBench without a large asset at hand.
+
+void printUsage() {
+    std::cout << "usage: meshConvert model.obj out.mesh" << std::endl;
+    std::cout << "       meshConvert --cube-grid N out.mesh" << std::endl;
+}
+
+// position + uv vertices and 32-bit indices to a .mesh, with 16-bit indices whenever they fit
+bool writePositionUvMesh(const char* outputPath, const std::vector<float>& vertices, const std::vector<uint32_t>& indices) {
+    const int floatsPerVertex = CUBE_VERTEX_STRIDE / sizeof(float);
+
+    MeshFileDesc desc;
+    desc.vertices = vertices.data();
+    desc.vertexCount = (uint32_t)(vertices.size() / floatsPerVertex);
+    desc.vertexStride = CUBE_VERTEX_STRIDE;
+    desc.attributes = {
+        {0, 3, GL_FLOAT, 0, 0},
+        {1, 2, GL_FLOAT, 0, 3 * sizeof(float)},
+    };
+
+    // half the index blob
+    std::vector<uint16_t> shortIndices;
+
+    if(desc.vertexCount <= 0xFFFF) {
+        shortIndices.assign(indices.begin(), indices.end());
+        desc.indices = shortIndices.data();
+        desc.indexType = GL_UNSIGNED_SHORT;
+    }
+    else {
+        desc.indices = indices.data();
+        desc.indexType = GL_UNSIGNED_INT;
+    }
+
+    desc.indexCount = (uint32_t)indices.size();
+
+    if(!writeMeshFile(outputPath, desc)) {
+        return false;
+    }
+
+    printf("%s: %u vertices, %zu triangles, %.1f MB\n", outputPath, desc.vertexCount, indices.size() / 3,
+           (desc.vertexCount * (double)desc.vertexStride + desc.indexCount * (double)meshIndexSize(desc.indexType)) / (1024.0 * 1024.0));
+
+    return true;
+}
+
+bool convertObj(const char* inputPath, const char* outputPath) {
+    ObjMesh mesh;
+
+    if(!loadObj(inputPath, mesh)) {
+        return false;
+    }
+
+    printObjLoadStats(mesh);
+    optimizeMesh(inputPath, mesh.vertices, mesh.floatsPerVertex, mesh.indices);
+
+    return writePositionUvMesh(outputPath, mesh.vertices, mesh.indices);
+}
+
+bool convertCubeGrid(int gridSize, const char* outputPath) {
+    const int floatsPerVertex = CUBE_VERTEX_STRIDE / sizeof(float);
+
+    // every cube is a copy of one optimised indexed cube
+    std::vector<float> cube;
+    std::vector<uint32_t> cubeIndices;
+    buildOptimizedMesh("cube", cubeVertices, CUBE_VERTEX_COUNT, floatsPerVertex, cube, cubeIndices);
+
+    size_t cubeVertexCount = cube.size() / floatsPerVertex;
+    size_t cubeCount = (size_t)gridSize * gridSize * gridSize;
+
+    if(cubeCount * cubeVertexCount > 0xFFFFFFFFu) {
+        std::cout << "ERROR::MESH_CONVERT::TOO_MANY_VERTICES: grid " << gridSize << std::endl;
+        return false;
+    }
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    vertices.reserve(cubeCount * cube.size());
+    indices.reserve(cubeCount * cubeIndices.size());
+
+    float offset = (gridSize - 1) * 0.5f;
+
+    for(int x = 0; x < gridSize; ++x) {
+        for(int y = 0; y < gridSize; ++y) {
+            for(int z = 0; z < gridSize; ++z) {
+                uint32_t baseVertex = (uint32_t)(vertices.size() / floatsPerVertex);
+
+                // half size cubes on a unit grid
+                for(size_t v = 0; v < cubeVertexCount; ++v) {
+                    const float* vertex = cube.data() + v * floatsPerVertex;
+
+                    vertices.push_back(vertex[0] * 0.5f + x - offset);
+                    vertices.push_back(vertex[1] * 0.5f + y - offset);
+                    vertices.push_back(vertex[2] * 0.5f + z - offset);
+                    vertices.push_back(vertex[3]);
+                    vertices.push_back(vertex[4]);
+                }
+
+                for(uint32_t index : cubeIndices) {
+                    indices.push_back(baseVertex + index);
+                }
+            }
+        }
+    }
+
+    return writePositionUvMesh(outputPath, vertices, indices);
+}
+
+int main(int argc, char** argv) {
+    auto start = std::chrono::steady_clock::now();
+    bool converted;
+
+    if(argc == 4 && strcmp(argv[1], "--cube-grid") == 0) {
+        int gridSize = atoi(argv[2]);
+
+        if(gridSize <= 0) {
+            printUsage();
+            return -1;
+        }
+
+        converted = convertCubeGrid(gridSize, argv[3]);
+    }
+    else if(argc == 3) {
+        converted = convertObj(argv[1], argv[2]);
+    }
+    else {
+        printUsage();
+        return -1;
+    }
+
+    if(!converted) {
+        return -1;
+    }
+
+    printf("converted in %.1f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    return 0;
+}
@@ -0,0 +1,316 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include <iostream>
+#include "mappedFile.h"
+#include "vertexLayout.h"
+
+// Versioned binary mesh container (.mesh). Layout on disk:
+//
+//   MeshFileHeader   magic, version, counts, vertex layout, bounding volumes and the
+//                    offsets of the two blobs below
+//   vertex blob      interleaved vertices exactly as glBufferData wants them
+//   index blob       GL_UNSIGNED_SHORT or GL_UNSIGNED_INT indices
+//
+// Blobs start on MESH_FILE_ALIGNMENT boundaries. Loading maps the file and hands the
+// blob pointers straight to glBufferData: no parsing and no intermediate copies.
+// Files are little endian, which is what every platform we ship on uses.
+
+const uint32_t MESH_FILE_MAGIC = 0x4853454D; // "MESH"
+const uint32_t MESH_FILE_VERSION = 1;
+const uint32_t MESH_FILE_ALIGNMENT = 64;
+const uint32_t MESH_FILE_MAX_ATTRIBUTES = 8;
+
+struct MeshFileAttribute {
+    uint32_t location;
+    uint32_t components;
+    // GL component type (GL_FLOAT, GL_HALF_FLOAT, GL_SHORT, ...)
+    uint32_t type;
+    uint32_t normalized;
+    uint32_t offset;
+};
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride;
+    uint32_t indexType;
+    uint32_t attributeCount;
+    uint32_t reserved;
+
+    uint64_t vertexDataOffset;
+    uint64_t vertexDataSize;
+    uint64_t indexDataOffset;
+    uint64_t indexDataSize;
+
+    float boundsMin[3];
+    float boundsMax[3];
+    float sphereCenter[3];
+    float sphereRadius;
+
+    MeshFileAttribute attributes[MESH_FILE_MAX_ATTRIBUTES];
+};
+
+// everything needed to write a mesh; positions are read from the attribute at
+// location 0, which must be 3 GL_FLOATs, to compute the bounding volumes
+struct MeshFileDesc {
+    const void* vertices = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t vertexStride = 0;
+    const void* indices = nullptr;
+    uint32_t indexCount = 0;
+    uint32_t indexType = GL_UNSIGNED_INT;
+    std::vector<MeshFileAttribute> attributes;
+};
+
+inline uint32_t meshIndexSize(uint32_t indexType) {
+    return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+inline uint64_t alignMeshOffset(uint64_t offset) {
+    return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+inline void computeMeshBounds(const MeshFileDesc& desc, MeshFileHeader& header) {
+    const MeshFileAttribute* position = nullptr;
+
+    for(const MeshFileAttribute& attribute : desc.attributes) {
+        if(attribute.location == 0 && attribute.type == GL_FLOAT && attribute.components >= 3) {
+            position = &attribute;
+        }
+    }
+
+    float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+    float boundsMax[3] = {0.0f, 0.0f, 0.0f};
+
+    if(position && desc.vertexCount > 0) {
+        for(int axis = 0; axis < 3; ++axis) {
+            boundsMin[axis] = FLT_MAX;
+            boundsMax[axis] = -FLT_MAX;
+        }
+
+        const unsigned char* vertex = (const unsigned char*)desc.vertices + position->offset;
+
+        for(uint32_t i = 0; i < desc.vertexCount; ++i, vertex += desc.vertexStride) {
+            float p[3];
+            memcpy(p, vertex, sizeof(p));
+
+            for(int axis = 0; axis < 3; ++axis) {
+                boundsMin[axis] = p[axis] < boundsMin[axis] ? p[axis] : boundsMin[axis];
+                boundsMax[axis] = p[axis] > boundsMax[axis] ? p[axis] : boundsMax[axis];
+            }
+        }
+    }
+
+    float radiusSquared = 0.0f;
+
+    for(int axis = 0; axis < 3; ++axis) {
+        header.boundsMin[axis] = boundsMin[axis];
+        header.boundsMax[axis] = boundsMax[axis];
+        header.sphereCenter[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+
+        float halfExtent = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+        radiusSquared += halfExtent * halfExtent;
+    }
+
+    header.sphereRadius = std::sqrt(radiusSquared);
+}
+
+inline bool writeMeshFile(const char* path, const MeshFileDesc& desc) {
+    if(desc.attributes.size() > MESH_FILE_MAX_ATTRIBUTES) {
+        std::cout << "ERROR::MESH_FILE::TOO_MANY_ATTRIBUTES: " << desc.attributes.size() << std::endl;
+        return false;
+    }
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexCount = desc.vertexCount;
+    header.indexCount = desc.indexCount;
+    header.vertexStride = desc.vertexStride;
+    header.indexType = desc.indexType;
+    header.attributeCount = (uint32_t)desc.attributes.size();
+
+    for(size_t i = 0; i < desc.attributes.size(); ++i) {
+        header.attributes[i] = desc.attributes[i];
+    }
+
+    header.vertexDataSize = (uint64_t)desc.vertexCount * desc.vertexStride;
+    header.vertexDataOffset = alignMeshOffset(sizeof(MeshFileHeader));
+    header.indexDataSize = (uint64_t)desc.indexCount * meshIndexSize(desc.indexType);
+    header.indexDataOffset = alignMeshOffset(header.vertexDataOffset + header.vertexDataSize);
+
+    computeMeshBounds(desc, header);
+
+    FILE* file = fopen(path, "wb");
+
+    if(!file) {
+        std::cout << "ERROR::MESH_FILE::WRITE_FAILED: " << path << std::endl;
+        return false;
+    }
+
+    static const char padding[MESH_FILE_ALIGNMENT] = {};
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(padding, 1, header.vertexDataOffset - sizeof(header), file) == header.vertexDataOffset - sizeof(header);
+    ok = ok && fwrite(desc.vertices, 1, header.vertexDataSize, file) == header.vertexDataSize;
+
+    uint64_t gap = header.indexDataOffset - (header.vertexDataOffset + header.vertexDataSize);
+    ok = ok && fwrite(padding, 1, gap, file) == gap;
+    ok = ok && fwrite(desc.indices, 1, header.indexDataSize, file) == header.indexDataSize;
+
+    fclose(file);
+
+    if(!ok) {
+        std::cout << "ERROR::MESH_FILE::WRITE_FAILED: " << path << std::endl;
+    }
+
+    return ok;
+}
+
+// a mapped .mesh; the pointers stay valid while the MeshFile is open
+class MeshFile {
+    public:
+    MappedFile file;
+    const MeshFileHeader* header = nullptr;
+    const void* vertices = nullptr;
+    const void* indices = nullptr;
+
+    bool open(const char* path) {
+        header = nullptr;
+
+        if(!file.open(path)) {
+            return false;
+        }
+
+        if(file.size < sizeof(MeshFileHeader)) {
+            std::cout << "ERROR::MESH_FILE::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+
+        const MeshFileHeader* candidate = (const MeshFileHeader*)file.data;
+
+        if(candidate->magic != MESH_FILE_MAGIC || candidate->version != MESH_FILE_VERSION) {
+            std::cout << "ERROR::MESH_FILE::BAD_HEADER: " << path << " (version " << candidate->version << ", expected " << MESH_FILE_VERSION << ")" << std::endl;
+            return false;
+        }
+
+        if(candidate->attributeCount > MESH_FILE_MAX_ATTRIBUTES
+            || !blobInFile(candidate->vertexDataOffset, candidate->vertexDataSize)
+            || !blobInFile(candidate->indexDataOffset, candidate->indexDataSize)) {
+            std::cout << "ERROR::MESH_FILE::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+
+        // the counts and layout are what the GL reads by, so they have to fit the blobs
+        if(!layoutFits(*candidate)) {
+            std::cout << "ERROR::MESH_FILE::BAD_LAYOUT: " << path << std::endl;
+            return false;
+        }
+
+        header = candidate;
+        vertices = file.data + header->vertexDataOffset;
+        indices = file.data + header->indexDataOffset;
+
+        return true;
+    }
+
+    void close() {
+        file.close();
+        header = nullptr;
+        vertices = nullptr;
+        indices = nullptr;
+    }
+
+    private:
+    bool blobInFile(uint64_t offset, uint64_t size) const {
+        return offset <= file.size && size <= file.size - offset;
+    }
+
+    static bool layoutFits(const MeshFileHeader& header) {
+        if(header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT) {
+            return false;
+        }
+
+        if((uint64_t)header.indexCount * meshIndexSize(header.indexType) > header.indexDataSize
+            || (uint64_t)header.vertexCount * header.vertexStride > header.vertexDataSize) {
+            return false;
+        }
+
+        for(uint32_t i = 0; i < header.attributeCount; ++i) {
+            const MeshFileAttribute& attribute = header.attributes[i];
+
+            if(attribute.components < 1 || attribute.components > 4
+                || (uint64_t)attribute.offset + vertexAttributeBytes(attribute.components, attribute.type) > header.vertexStride) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+// GL objects for one uploaded .mesh
+struct GpuMesh {
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    unsigned int indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    void draw(GLenum mode = GL_TRIANGLES) const {
+        glBindVertexArray(VAO);
+        glDrawElements(mode, indexCount, indexType, nullptr);
+    }
+
+    void destroy() {
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteVertexArrays(1, &VAO);
+        VAO = VBO = EBO = 0;
+    }
+};
+
+// upload straight from the mapping and describe the vertex layout from the header
+inline GpuMesh uploadMeshFile(const MeshFile& mesh) {
+    GpuMesh gpu;
+    const MeshFileHeader& header = *mesh.header;
+
+    glGenVertexArrays(1, &gpu.VAO);
+    glGenBuffers(1, &gpu.VBO);
+    glGenBuffers(1, &gpu.EBO);
+
+    glBindVertexArray(gpu.VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.VBO);
+    glBufferData(GL_ARRAY_BUFFER, header.vertexDataSize, mesh.vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, header.indexDataSize, mesh.indices, GL_STATIC_DRAW);
+
+    for(uint32_t i = 0; i < header.attributeCount; ++i) {
+        const MeshFileAttribute& attribute = header.attributes[i];
+
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE,
+                              header.vertexStride, (void*)(size_t)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    gpu.indexCount = header.indexCount;
+    gpu.indexType = header.indexType;
+
+    return gpu;
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "meshFile.h"
+
+// Time to get a .mesh from disk into GL buffers, comparing
+//
+//   mmap     MeshFile maps the file and glBufferData reads straight from the mapping
+//   fread    the whole file is read into a heap buffer first, then uploaded
+//
+// Produce a large input with e.g. `meshConvert --cube-grid 120 cubeGrid.mesh`
+// (1.7M cubes, 20.7M triangles, ~760 MB). Runs after the first are served from the page cache.
+
+const int ITERATIONS = 5;
+
+double sinceMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double loadMapped(const char* path, unsigned int& triangles) {
+    auto start = std::chrono::steady_clock::now();
+
+    MeshFile mesh;
+
+    if(!mesh.open(path)) {
+        return -1.0;
+    }
+
+    GpuMesh gpu = uploadMeshFile(mesh);
+    glFinish();
+
+    double ms = sinceMs(start);
+
+    triangles = gpu.indexCount / 3;
+    gpu.destroy();
+
+    return ms;
+}
+
+double loadRead(const char* path, unsigned int& triangles) {
+    auto start = std::chrono::steady_clock::now();
+
+    FILE* file = fopen(path, "rb");
+
+    if(!file) {
+        std::cout << "ERROR::MESH_LOAD_BENCH::OPEN_FAILED: " << path << std::endl;
+        return -1.0;
+    }
+
+    fseek(file, 0, SEEK_END);
+    std::vector<unsigned char> bytes(ftell(file));
+    fseek(file, 0, SEEK_SET);
+    size_t read = fread(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+
+    if(read != bytes.size() || read < sizeof(MeshFileHeader)) {
+        std::cout << "ERROR::MESH_LOAD_BENCH::READ_FAILED: " << path << std::endl;
+        return -1.0;
+    }
+
+    const MeshFileHeader& header = *(const MeshFileHeader*)bytes.data();
+
+    unsigned int VAO, VBO, EBO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, header.vertexDataSize, bytes.data() + header.vertexDataOffset, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, header.indexDataSize, bytes.data() + header.indexDataOffset, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glFinish();
+
+    double ms = sinceMs(start);
+
+    triangles = header.indexCount / 3;
+
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteVertexArrays(1, &VAO);
+
+    return ms;
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "cubeGrid.mesh";
+
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Mesh load benchmark", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    MappedFile file;
+
+    if(!file.open(path)) {
+        std::cout << "create one with: meshConvert --cube-grid 120 " << path << std::endl;
+        return -1;
+    }
+
+    double megabytes = file.size / (1024.0 * 1024.0);
+    file.close();
+
+    std::cout << "run   mmap ms    fread ms   mmap MB/s   fread MB/s   triangles" << std::endl;
+
+    for(int i = 0; i < ITERATIONS; ++i) {
+        unsigned int triangles = 0;
+        double mappedMs = loadMapped(path, triangles);
+        double readMs = loadRead(path, triangles);
+
+        if(mappedMs < 0.0 || readMs < 0.0) {
+            return -1;
+        }
+
+        printf("%-5d %-10.1f %-10.1f %-11.0f %-12.0f %u\n", i, mappedMs, readMs, megabytes / mappedMs * 1000.0, megabytes / readMs * 1000.0, triangles);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
@@ -0,0 +1,317 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+// Index buffer generation and reordering for interleaved float vertices:
+//
+//   weldVertices         unindexed (or redundantly indexed) vertices -> unique vertices + indices
+//   optimizeVertexCache  reorder triangles so recently shaded vertices get reused
+//                        (Tom Forsyth's linear-speed vertex cache optimisation)
+//   optimizeVertexFetch  renumber vertices in first-use order so the vertex fetch
+//                        walks the VBO front to back
+//
+// analyzeVertexCache() simulates a FIFO post-transform cache and reports ACMR (vertices
+// shaded per triangle, 0.5 at best for a regular grid, 3 at worst) and ATVR (vertices
+// shaded per unique vertex, 1 at best).
+
+struct VertexCacheStats {
+    size_t triangles = 0;
+    size_t transformed = 0;
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+inline VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16) {
+    VertexCacheStats stats;
+    std::vector<size_t> shadedAt(vertexCount, 0);
+    size_t timestamp = cacheSize + 1;
+
+    for(size_t i = 0; i < indexCount; ++i) {
+        uint32_t index = indices[i];
+
+        // in the FIFO if it was pushed less than cacheSize misses ago
+        if(timestamp - shadedAt[index] > cacheSize) {
+            shadedAt[index] = timestamp++;
+            stats.transformed++;
+        }
+    }
+
+    stats.triangles = indexCount / 3;
+    stats.acmr = stats.triangles ? (float)stats.transformed / stats.triangles : 0.0f;
+    stats.atvr = vertexCount ? (float)stats.transformed / vertexCount : 0.0f;
+
+    return stats;
+}
+
+inline uint32_t hashVertex(const float* vertex, int floatsPerVertex) {
+    uint32_t hash = 2166136261u;
+
+    for(int i = 0; i < floatsPerVertex; ++i) {
+        uint32_t bits;
+        memcpy(&bits, vertex + i, sizeof(bits));
+
+        hash ^= bits;
+        hash *= 16777619u;
+        hash ^= hash >> 15;
+    }
+
+    return hash;
+}
+
+// Bitwise identical vertices become one. Uses an open addressing table of vertex
+// indices, so no keys are copied. Returns the number of unique vertices.
+inline size_t weldVertices(const float* vertices, size_t vertexCount, int floatsPerVertex, std::vector<float>& welded, std::vector<uint32_t>& indices) {
+    size_t tableSize = 1;
+
+    while(tableSize < vertexCount * 2) {
+        tableSize *= 2;
+    }
+
+    const uint32_t empty = 0xFFFFFFFF;
+    std::vector<uint32_t> table(tableSize, empty);
+    size_t vertexBytes = floatsPerVertex * sizeof(float);
+
+    welded.clear();
+    indices.resize(vertexCount);
+
+    for(size_t i = 0; i < vertexCount; ++i) {
+        const float* vertex = vertices + i * floatsPerVertex;
+        size_t slot = hashVertex(vertex, floatsPerVertex) & (tableSize - 1);
+
+        while(table[slot] != empty && memcmp(welded.data() + (size_t)table[slot] * floatsPerVertex, vertex, vertexBytes) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if(table[slot] == empty) {
+            table[slot] = (uint32_t)(welded.size() / floatsPerVertex);
+            welded.insert(welded.end(), vertex, vertex + floatsPerVertex);
+        }
+
+        indices[i] = table[slot];
+    }
+
+    return welded.size() / floatsPerVertex;
+}
+
+// Forsyth's scoring: vertices just used score high (except the last triangle's three,
+// which are slightly penalised to avoid strips folding back), and vertices with few
+// triangles left get a boost so they are finished off and leave the cache for good.
+const int FORSYTH_CACHE_SIZE = 32;
+
+inline float forsythVertexScore(int cachePosition, unsigned int remainingTriangles) {
+    if(remainingTriangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+
+    if(cachePosition >= 0) {
+        if(cachePosition < 3) {
+            score = 0.75f;
+        }
+        else {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            float linear = 1.0f - (cachePosition - 3) * scaler;
+            score = linear * std::sqrt(linear);
+        }
+    }
+
+    return score + 2.0f / std::sqrt((float)remainingTriangles);
+}
+
+inline void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+
+    if(triangleCount == 0) {
+        return;
+    }
+
+    // triangles using each vertex, as one flat array with per-vertex offsets
+    std::vector<unsigned int> remaining(vertexCount, 0);
+
+    for(uint32_t index : indices) {
+        remaining[index]++;
+    }
+
+    std::vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+
+    for(size_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<size_t> adjacencyFill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+
+    for(size_t t = 0; t < triangleCount; ++t) {
+        for(int corner = 0; corner < 3; ++corner) {
+            uint32_t v = indices[t * 3 + corner];
+            adjacency[adjacencyFill[v]++] = (uint32_t)t;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+
+    for(size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    // room for the cache plus the three vertices pushed in front of it
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+
+    size_t bestTriangle = (size_t)-1;
+    size_t scanCursor = 0;
+
+    for(size_t added = 0; added < triangleCount; ++added) {
+        // nothing in the cache connects to what's left: continue with the first triangle not
+        // yet emitted. Scanning for the best score instead costs O(n) per disconnected piece.
+        if(bestTriangle == (size_t)-1) {
+            while(emitted[scanCursor]) {
+                scanCursor++;
+            }
+
+            bestTriangle = scanCursor;
+        }
+
+        size_t t = bestTriangle;
+        emitted[t] = true;
+
+        uint32_t triangle[3] = {indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]};
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // take the triangle out of its vertices' adjacency
+        for(uint32_t v : triangle) {
+            size_t begin = adjacencyOffset[v];
+            size_t end = begin + remaining[v];
+
+            for(size_t a = begin; a < end; ++a) {
+                if(adjacency[a] == t) {
+                    adjacency[a] = adjacency[end - 1];
+                    break;
+                }
+            }
+
+            remaining[v]--;
+        }
+
+        // move the triangle's vertices to the front of the LRU cache
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        int newCount = 0;
+
+        for(int corner = 0; corner < 3; ++corner) {
+            // degenerate triangles repeat a vertex
+            if(corner == 0 || triangle[corner] != triangle[0]) {
+                if(corner < 2 || triangle[2] != triangle[1]) {
+                    newCache[newCount++] = triangle[corner];
+                }
+            }
+        }
+
+        for(int i = 0; i < cacheCount; ++i) {
+            uint32_t v = cache[i];
+
+            if(v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache[newCount++] = v;
+            }
+        }
+
+        for(int i = 0; i < newCount; ++i) {
+            uint32_t v = newCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? i : -1;
+            vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+        }
+
+        cacheCount = newCount < FORSYTH_CACHE_SIZE ? newCount : FORSYTH_CACHE_SIZE;
+        memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+        // score the triangles touching the cache and pick the next one among them
+        bestTriangle = (size_t)-1;
+        float bestScore = -1.0f;
+
+        for(int i = 0; i < newCount; ++i) {
+            uint32_t v = newCache[i];
+
+            for(size_t a = adjacencyOffset[v]; a < adjacencyOffset[v] + remaining[v]; ++a) {
+                uint32_t candidate = adjacency[a];
+                float score = vertexScore[indices[candidate * 3]] + vertexScore[indices[candidate * 3 + 1]] + vertexScore[indices[candidate * 3 + 2]];
+
+                if(score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = candidate;
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+// Renumber vertices in the order the index buffer first uses them and drop unused
+// ones. Returns the new vertex count.
+inline size_t optimizeVertexFetch(std::vector<float>& vertices, int floatsPerVertex, std::vector<uint32_t>& indices) {
+    size_t vertexCount = vertices.size() / floatsPerVertex;
+    const uint32_t unused = 0xFFFFFFFF;
+
+    std::vector<uint32_t> remap(vertexCount, unused);
+    std::vector<float> reordered;
+    reordered.reserve(vertices.size());
+
+    for(uint32_t& index : indices) {
+        if(remap[index] == unused) {
+            remap[index] = (uint32_t)(reordered.size() / floatsPerVertex);
+            reordered.insert(reordered.end(), vertices.begin() + (size_t)index * floatsPerVertex, vertices.begin() + (size_t)(index + 1) * floatsPerVertex);
+        }
+
+        index = remap[index];
+    }
+
+    vertices.swap(reordered);
+
+    return vertices.size() / floatsPerVertex;
+}
+
+inline void printVertexCacheStats(const char* name, const VertexCacheStats& before, const VertexCacheStats& after) {
+    std::cout << "MESH::OPTIMIZE: " << name << ": " << after.triangles << " triangles, ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+// weld + cache + fetch optimisation of an unindexed triangle list, with stats
+inline void buildOptimizedMesh(const char* name, const float* unindexed, size_t vertexCount, int floatsPerVertex, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+    // unindexed drawing shades every corner: ACMR 3, and each unique vertex as often as it is used
+    VertexCacheStats before;
+    before.triangles = vertexCount / 3;
+    before.transformed = vertexCount;
+    before.acmr = 3.0f;
+
+    size_t uniqueCount = weldVertices(unindexed, vertexCount, floatsPerVertex, vertices, indices);
+    before.atvr = uniqueCount ? (float)vertexCount / uniqueCount : 0.0f;
+
+    optimizeVertexCache(indices, uniqueCount);
+    uniqueCount = optimizeVertexFetch(vertices, floatsPerVertex, indices);
+
+    printVertexCacheStats(name, before, analyzeVertexCache(indices.data(), indices.size(), uniqueCount));
+}
+
+// cache + fetch optimisation of an already indexed mesh, with stats
+inline void optimizeMesh(const char* name, std::vector<float>& vertices, int floatsPerVertex, std::vector<uint32_t>& indices) {
+    size_t vertexCount = vertices.size() / floatsPerVertex;
+    VertexCacheStats before = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+    optimizeVertexCache(indices, vertexCount);
+    vertexCount = optimizeVertexFetch(vertices, floatsPerVertex, indices);
+
+    printVertexCacheStats(name, before, analyzeVertexCache(indices.data(), indices.size(), vertexCount));
+}
+
+#endif
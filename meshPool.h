@@ -0,0 +1,412 @@
+#ifndef MESH_POOL_H
+#define MESH_POOL_H
+
+#include <map>
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include "vertexLayout.h"
+
+// Many meshes of the same vertex format packed into one VBO + EBO behind one VAO;
+// use one MeshPool per vertex format. A mesh is just a MeshRange inside the shared
+// buffers, so switching meshes needs no VAO or buffer binds: draws differ only in
+// first index and base vertex and can be batched (see drawIndirect.h).
+//
+// Vertex and index space are handed out by a best-fit free list. Removing meshes
+// leaves holes; defragment() packs the live meshes back together with GPU side
+// copies, and add() defragments and then grows the buffers before giving up.
+// Meshes are referred to by MeshHandle, which stays valid when ranges move. A handle
+// is a slot index plus the slot's generation, so once a mesh is removed its old
+// handles stop working instead of reaching whatever mesh reuses the slot.
+//
+// add(), defragment() and growing put the previous VAO and array buffer binding back,
+// so they can run between draws tracked by a GLState; they do leave
+// GL_COPY_READ_BUFFER and GL_COPY_WRITE_BUFFER unbound.
+
+struct MeshRange {
+    int baseVertex = 0;
+    unsigned int firstIndex = 0;
+    unsigned int indexCount = 0;
+    unsigned int vertexCount = 0;
+};
+
+// generation in the high 32 bits, slot in the low 32
+typedef uint64_t MeshHandle;
+
+const MeshHandle INVALID_MESH = ~(MeshHandle)0;
+
+// best-fit free list over [0, capacity) with coalescing of neighbouring free blocks
+class RangeAllocator {
+    public:
+    size_t capacity = 0;
+
+    // offset -> size of every free block
+    std::map<size_t, size_t> freeBlocks;
+
+    void reset(size_t size) {
+        capacity = size;
+        freeBlocks.clear();
+
+        if(size > 0) {
+            freeBlocks[0] = size;
+        }
+    }
+
+    bool allocate(size_t size, size_t& offset) {
+        // nothing to place, so it fits even when the space is full
+        if(size == 0) {
+            offset = 0;
+            return true;
+        }
+
+        auto best = freeBlocks.end();
+
+        for(auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+            if(it->second >= size && (best == freeBlocks.end() || it->second < best->second)) {
+                best = it;
+
+                if(it->second == size) {
+                    break;
+                }
+            }
+        }
+
+        if(best == freeBlocks.end()) {
+            return false;
+        }
+
+        offset = best->first;
+        size_t remaining = best->second - size;
+        freeBlocks.erase(best);
+
+        if(remaining > 0) {
+            freeBlocks[offset + size] = remaining;
+        }
+
+        return true;
+    }
+
+    void release(size_t offset, size_t size) {
+        if(size == 0) {
+            return;
+        }
+
+        auto next = freeBlocks.lower_bound(offset);
+
+        // merge with the block right after
+        if(next != freeBlocks.end() && offset + size == next->first) {
+            size += next->second;
+            next = freeBlocks.erase(next);
+        }
+
+        // and with the one right before
+        if(next != freeBlocks.begin()) {
+            auto previous = std::prev(next);
+
+            if(previous->first + previous->second == offset) {
+                previous->second += size;
+                return;
+            }
+        }
+
+        freeBlocks[offset] = size;
+    }
+
+    void grow(size_t newCapacity) {
+        if(newCapacity <= capacity) {
+            return;
+        }
+
+        size_t added = newCapacity - capacity;
+        size_t start = capacity;
+        capacity = newCapacity;
+
+        release(start, added);
+    }
+
+    size_t freeSpace() const {
+        size_t total = 0;
+
+        for(const auto& block : freeBlocks) {
+            total += block.second;
+        }
+
+        return total;
+    }
+
+    size_t largestFreeBlock() const {
+        size_t largest = 0;
+
+        for(const auto& block : freeBlocks) {
+            largest = block.second > largest ? block.second : largest;
+        }
+
+        return largest;
+    }
+};
+
+class MeshPool {
+    public:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    int vertexStride = 0;
+    std::vector<VertexAttribute> attributes;
+
+    // vertex and index space, in vertices / indices
+    RangeAllocator vertexSpace;
+    RangeAllocator indexSpace;
+
+    // the slot in each handle indexes this; removed meshes are not live
+    struct MeshSlot {
+        MeshRange range;
+        uint32_t generation = 0;
+        bool live = false;
+    };
+
+    std::vector<MeshSlot> meshes;
+
+    unsigned int defragmentations = 0;
+    unsigned int growths = 0;
+
+    void create(int stride, const std::vector<VertexAttribute>& vertexAttributes, size_t maxVertices, size_t maxIndices) {
+        vertexStride = stride;
+        attributes = vertexAttributes;
+
+        vertexSpace.reset(maxVertices);
+        indexSpace.reset(maxIndices);
+
+        glGenVertexArrays(1, &VAO);
+        allocateStorage(VBO, EBO, maxVertices, maxIndices);
+        describeVertexArray();
+    }
+
+    void create(const VertexLayout& layout, size_t maxVertices, size_t maxIndices) {
+        create(layout.stride, layout.attributes, maxVertices, maxIndices);
+    }
+
+    // copy a mesh into the shared buffers; indices stay relative to the mesh's own vertices
+    MeshHandle add(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+        size_t vertexOffset, indexOffset;
+
+        if(!reserve(vertexCount, indexCount, vertexOffset, indexOffset)) {
+            std::cout << "ERROR::MESH_POOL::OUT_OF_SPACE: " << vertexCount << " vertices, " << indexCount << " indices requested" << std::endl;
+            return INVALID_MESH;
+        }
+
+        MeshRange range;
+        range.baseVertex = (int)vertexOffset;
+        range.firstIndex = (unsigned int)indexOffset;
+        range.vertexCount = (unsigned int)vertexCount;
+        range.indexCount = (unsigned int)indexCount;
+
+        // the previous bindings are put back, so a GLState shadowing them stays right
+        GLint previousBuffer = 0, previousVertexArray = 0;
+        glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousBuffer);
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * vertexStride, vertexCount * vertexStride, vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, (GLuint)previousBuffer);
+
+        // binding the VAO first keeps the EBO bind from leaking into whatever VAO is current
+        glBindVertexArray(VAO);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+        glBindVertexArray((GLuint)previousVertexArray);
+
+        // reuse the slot of a removed mesh if there is one
+        uint32_t slot;
+
+        if(!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            slot = (uint32_t)meshes.size();
+            meshes.push_back(MeshSlot());
+        }
+
+        meshes[slot].range = range;
+        meshes[slot].live = true;
+
+        return (MeshHandle)meshes[slot].generation << 32 | slot;
+    }
+
+    // a mesh that was added and not removed since
+    bool valid(MeshHandle handle) const {
+        uint32_t slot = (uint32_t)handle;
+
+        return slot < meshes.size() && meshes[slot].live && meshes[slot].generation == (uint32_t)(handle >> 32);
+    }
+
+    void remove(MeshHandle handle) {
+        if(!valid(handle)) {
+            std::cout << "ERROR::MESH_POOL::STALE_HANDLE: slot " << (uint32_t)handle << " generation " << (uint32_t)(handle >> 32) << std::endl;
+            return;
+        }
+
+        MeshSlot& mesh = meshes[(uint32_t)handle];
+
+        vertexSpace.release(mesh.range.baseVertex, mesh.range.vertexCount);
+        indexSpace.release(mesh.range.firstIndex, mesh.range.indexCount);
+
+        // the next add() into this slot hands out a different handle
+        mesh.range = MeshRange();
+        mesh.live = false;
+        mesh.generation++;
+        freeSlots.push_back((uint32_t)handle);
+    }
+
+    // an empty range, which draws nothing, for a stale handle
+    const MeshRange& range(MeshHandle handle) const {
+        static const MeshRange empty;
+
+        if(!valid(handle)) {
+            std::cout << "ERROR::MESH_POOL::STALE_HANDLE: slot " << (uint32_t)handle << " generation " << (uint32_t)(handle >> 32) << std::endl;
+            return empty;
+        }
+
+        return meshes[(uint32_t)handle].range;
+    }
+
+    // Pack every live mesh to the front of fresh buffers with glCopyBufferSubData, so
+    // the free space becomes one block at the end. Returns the bytes copied.
+    size_t defragment() {
+        defragmentations++;
+
+        return relocate(vertexSpace.capacity, indexSpace.capacity);
+    }
+
+    void destroy() {
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteVertexArrays(1, &VAO);
+        VAO = VBO = EBO = 0;
+        meshes.clear();
+        freeSlots.clear();
+    }
+
+    private:
+    std::vector<uint32_t> freeSlots;
+
+    bool reserve(size_t vertexCount, size_t indexCount, size_t& vertexOffset, size_t& indexOffset) {
+        for(int attempt = 0; attempt < 3; ++attempt) {
+            if(vertexSpace.allocate(vertexCount, vertexOffset)) {
+                if(indexSpace.allocate(indexCount, indexOffset)) {
+                    return true;
+                }
+
+                vertexSpace.release(vertexOffset, vertexCount);
+            }
+
+            if(attempt == 0) {
+                // enough space in total but too fragmented: compact first
+                if(vertexSpace.freeSpace() >= vertexCount && indexSpace.freeSpace() >= indexCount) {
+                    defragment();
+                }
+            }
+            else if(attempt == 1) {
+                size_t vertexCapacity = vertexSpace.capacity * 2 > vertexSpace.capacity + vertexCount ? vertexSpace.capacity * 2 : vertexSpace.capacity + vertexCount;
+                size_t indexCapacity = indexSpace.capacity * 2 > indexSpace.capacity + indexCount ? indexSpace.capacity * 2 : indexSpace.capacity + indexCount;
+
+                relocate(vertexCapacity, indexCapacity);
+                growths++;
+            }
+        }
+
+        return false;
+    }
+
+    void allocateStorage(unsigned int& vertexBuffer, unsigned int& indexBuffer, size_t vertexCapacity, size_t indexCapacity) {
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &indexBuffer);
+
+        // the copy target, so the array buffer binding is left alone
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * vertexStride, NULL, GL_STATIC_DRAW);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // point the VAO at the current VBO/EBO; the element buffer binding is VAO state.
+    // Puts back the previous VAO and array buffer, like add()
+    void describeVertexArray() {
+        GLint previousBuffer = 0, previousVertexArray = 0;
+        glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousBuffer);
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+        for(const VertexAttribute& attribute : attributes) {
+            glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE, vertexStride, (void*)attribute.offset);
+            glEnableVertexAttribArray(attribute.location);
+        }
+
+        glBindVertexArray((GLuint)previousVertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, (GLuint)previousBuffer);
+    }
+
+    // copy every live mesh, packed, into new buffers of the given capacity
+    size_t relocate(size_t vertexCapacity, size_t indexCapacity) {
+        unsigned int newVBO, newEBO;
+        allocateStorage(newVBO, newEBO, vertexCapacity, indexCapacity);
+
+        size_t vertexHead = 0, indexHead = 0, copied = 0;
+
+        for(MeshSlot& mesh : meshes) {
+            MeshRange& range = mesh.range;
+
+            if(!mesh.live) {
+                continue;
+            }
+
+            glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (size_t)range.baseVertex * vertexStride, vertexHead * vertexStride, (size_t)range.vertexCount * vertexStride);
+
+            glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, newEBO);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (size_t)range.firstIndex * sizeof(unsigned int), indexHead * sizeof(unsigned int), (size_t)range.indexCount * sizeof(unsigned int));
+
+            copied += (size_t)range.vertexCount * vertexStride + (size_t)range.indexCount * sizeof(unsigned int);
+
+            // indices are relative to baseVertex, so only the range itself changes
+            range.baseVertex = (int)vertexHead;
+            range.firstIndex = (unsigned int)indexHead;
+
+            vertexHead += range.vertexCount;
+            indexHead += range.indexCount;
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VBO = newVBO;
+        EBO = newEBO;
+
+        describeVertexArray();
+
+        vertexSpace.reset(vertexCapacity);
+        indexSpace.reset(indexCapacity);
+
+        size_t offset;
+
+        if(vertexHead > 0) {
+            vertexSpace.allocate(vertexHead, offset);
+        }
+
+        if(indexHead > 0) {
+            indexSpace.allocate(indexHead, offset);
+        }
+
+        return copied;
+    }
+};
+
+#endif
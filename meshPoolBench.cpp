@@ -0,0 +1,349 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "shaderLibrary.h"
+#include "cameraBuffer.h"
+#include "meshPool.h"
+#include "drawIndirect.h"
+#include "benchFrames.h"
+
+// Churns a MeshPool that starts too small: meshes of random sizes (empty ones
+// included) are added and removed until the free lists are fragmented, defragment()
+// has run and the buffers have grown. Afterwards the buffers are read back to check
+// that every live mesh still holds its own vertices and indices, that no two meshes
+// overlap and that handles of removed meshes are refused.
+//
+// Then the surviving meshes are drawn every frame, once with a VAO, VBO and EBO per
+// mesh and once from the pool through a DrawCommandBuffer (one
+// glMultiDrawElementsIndirect where supported). The camera collapses every vertex onto
+// one point, so the frames time the submission rather than the fill.
+
+const int CHURN_STEPS = 4000;
+const int MAX_MESH_VERTICES = 300;
+const int START_VERTICES = 2048;
+const int START_INDICES = 4096;
+
+// a vertex is (mesh id, vertex number, 1), so a misplaced copy shows up
+const int VERTEX_FLOATS = 3;
+
+// more than the other benches; a frame here is only a few hundred draws
+const int TIMED_FRAMES = 50;
+
+struct TestMesh {
+    MeshHandle handle;
+    unsigned int id;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+};
+
+// a mesh in buffers of its own
+struct SeparateMesh {
+    unsigned int VAO, VBO, EBO;
+    GLsizei indexCount;
+};
+
+struct DrawScene {
+    MeshPool* pool;
+    DrawCommandBuffer* draws;
+    std::vector<TestMesh>* live;
+    std::vector<SeparateMesh> separate;
+};
+
+double sinceMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void readMesh(const MeshPool& pool, const MeshRange& range, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    vertices.resize((size_t)range.vertexCount * VERTEX_FLOATS);
+    indices.resize(range.indexCount);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, pool.VBO);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, (size_t)range.baseVertex * pool.vertexStride, vertices.size() * sizeof(float), vertices.data());
+    glBindBuffer(GL_COPY_READ_BUFFER, pool.EBO);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, (size_t)range.firstIndex * sizeof(unsigned int), indices.size() * sizeof(unsigned int), indices.data());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+TestMesh addTestMesh(MeshPool& pool, unsigned int id) {
+    TestMesh mesh;
+    mesh.id = id;
+    mesh.vertexCount = rand() % 8 == 0 ? 0 : 1 + rand() % MAX_MESH_VERTICES;
+    mesh.indexCount = mesh.vertexCount > 0 ? 3 * (1 + rand() % mesh.vertexCount) : 0;
+
+    std::vector<float> vertices((size_t)mesh.vertexCount * VERTEX_FLOATS);
+    std::vector<unsigned int> indices(mesh.indexCount);
+
+    for(unsigned int i = 0; i < mesh.vertexCount; ++i) {
+        vertices[i * VERTEX_FLOATS + 0] = (float)id;
+        vertices[i * VERTEX_FLOATS + 1] = (float)i;
+        vertices[i * VERTEX_FLOATS + 2] = 1.0f;
+    }
+
+    for(unsigned int i = 0; i < mesh.indexCount; ++i) {
+        indices[i] = (i * 7 + id) % mesh.vertexCount;
+    }
+
+    mesh.handle = pool.add(vertices.data(), mesh.vertexCount, indices.data(), mesh.indexCount);
+
+    return mesh;
+}
+
+bool checkMesh(const MeshPool& pool, const TestMesh& mesh) {
+    const MeshRange& range = pool.range(mesh.handle);
+
+    if(range.vertexCount != mesh.vertexCount || range.indexCount != mesh.indexCount) {
+        std::cout << "ERROR::MESH_POOL_BENCH::WRONG_RANGE: mesh " << mesh.id << std::endl;
+        return false;
+    }
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    readMesh(pool, range, vertices, indices);
+
+    for(unsigned int i = 0; i < range.vertexCount; ++i) {
+        if(vertices[i * VERTEX_FLOATS + 0] != (float)mesh.id || vertices[i * VERTEX_FLOATS + 1] != (float)i) {
+            std::cout << "ERROR::MESH_POOL_BENCH::WRONG_VERTEX: mesh " << mesh.id << " vertex " << i << std::endl;
+            return false;
+        }
+    }
+
+    for(unsigned int i = 0; i < range.indexCount; ++i) {
+        if(indices[i] != (i * 7 + mesh.id) % mesh.vertexCount) {
+            std::cout << "ERROR::MESH_POOL_BENCH::WRONG_INDEX: mesh " << mesh.id << " index " << i << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// live ranges must not share a vertex or an index
+bool checkOverlap(const MeshPool& pool, const std::vector<TestMesh>& live) {
+    std::vector<std::pair<size_t, size_t>> vertexRanges, indexRanges;
+
+    for(const TestMesh& mesh : live) {
+        const MeshRange& range = pool.range(mesh.handle);
+        vertexRanges.push_back({(size_t)range.baseVertex, (size_t)range.baseVertex + range.vertexCount});
+        indexRanges.push_back({range.firstIndex, (size_t)range.firstIndex + range.indexCount});
+    }
+
+    for(std::vector<std::pair<size_t, size_t>>* ranges : {&vertexRanges, &indexRanges}) {
+        std::sort(ranges->begin(), ranges->end());
+
+        size_t end = 0;
+
+        for(const auto& range : *ranges) {
+            if(range.first == range.second) {
+                continue;
+            }
+
+            if(range.first < end) {
+                std::cout << "ERROR::MESH_POOL_BENCH::OVERLAP: at " << range.first << std::endl;
+                return false;
+            }
+
+            end = range.second;
+        }
+    }
+
+    return true;
+}
+
+// the same meshes, copied out of the pool into buffers of their own
+std::vector<SeparateMesh> separateMeshes(const MeshPool& pool, const std::vector<TestMesh>& live) {
+    std::vector<SeparateMesh> separate;
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+
+    for(const TestMesh& mesh : live) {
+        if(mesh.indexCount == 0) {
+            continue;
+        }
+
+        readMesh(pool, pool.range(mesh.handle), vertices, indices);
+
+        SeparateMesh copy;
+        copy.indexCount = (GLsizei)indices.size();
+
+        glGenVertexArrays(1, &copy.VAO);
+        glGenBuffers(1, &copy.VBO);
+        glGenBuffers(1, &copy.EBO);
+
+        glBindVertexArray(copy.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, copy.VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, VERTEX_FLOATS, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), nullptr);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, copy.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        separate.push_back(copy);
+    }
+
+    return separate;
+}
+
+void drawSeparate(DrawScene& scene) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    for(const SeparateMesh& mesh : scene.separate) {
+        glBindVertexArray(mesh.VAO);
+        glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, nullptr);
+    }
+}
+
+void drawPooled(DrawScene& scene) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    scene.draws->clear();
+
+    for(const TestMesh& mesh : *scene.live) {
+        scene.draws->add(scene.pool->range(mesh.handle));
+    }
+
+    scene.draws->submit(*scene.pool);
+}
+
+int main() {
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(600, 600, "Mesh pool benchmark", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    // don't let vsync cap the measurement
+    glfwSwapInterval(0);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    srand(1234);
+
+    MeshPool pool;
+    pool.create(VERTEX_FLOATS * sizeof(float), {{0, VERTEX_FLOATS, 0}}, START_VERTICES, START_INDICES);
+
+    std::vector<TestMesh> live;
+    std::vector<MeshHandle> removed;
+    unsigned int nextId = 0, adds = 0, removes = 0;
+    double addMs = 0.0, removeMs = 0.0;
+
+    // grows toward ~200 live meshes, then keeps replacing them
+    for(int step = 0; step < CHURN_STEPS; ++step) {
+        if(live.empty() || rand() % 400 >= (int)live.size()) {
+            auto start = std::chrono::steady_clock::now();
+            TestMesh mesh = addTestMesh(pool, nextId++);
+            addMs += sinceMs(start);
+            adds++;
+
+            if(mesh.handle == INVALID_MESH) {
+                std::cout << "ERROR::MESH_POOL_BENCH::ADD_FAILED: mesh " << mesh.id << std::endl;
+                return -1;
+            }
+
+            live.push_back(mesh);
+        }
+        else {
+            size_t victim = rand() % live.size();
+
+            auto start = std::chrono::steady_clock::now();
+            pool.remove(live[victim].handle);
+            removeMs += sinceMs(start);
+            removes++;
+
+            removed.push_back(live[victim].handle);
+            live[victim] = live.back();
+            live.pop_back();
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t copied = pool.defragment();
+    glFinish();
+    double defragmentMs = sinceMs(start);
+
+    bool ok = checkOverlap(pool, live);
+
+    for(const TestMesh& mesh : live) {
+        ok = ok && pool.valid(mesh.handle) && checkMesh(pool, mesh);
+    }
+
+    for(MeshHandle handle : removed) {
+        if(pool.valid(handle)) {
+            std::cout << "ERROR::MESH_POOL_BENCH::STALE_HANDLE_ACCEPTED: slot " << (uint32_t)handle << std::endl;
+            ok = false;
+            break;
+        }
+    }
+
+    printf("%u add(s) %.3f ms, %u remove(s) %.3f ms, %zu live mesh(es)\n", adds, addMs, removes, removeMs, live.size());
+    printf("%u defragmentation(s), %u growth(s), capacity %zu vertices / %zu indices\n", pool.defragmentations, pool.growths, pool.vertexSpace.capacity, pool.indexSpace.capacity);
+    printf("final defragment: %zu bytes in %.3f ms, largest free block %zu vertices\n", copied, defragmentMs, pool.vertexSpace.largestFreeBlock());
+    std::cout << (ok ? "pool contents check out" : "pool check FAILED") << std::endl;
+
+    ShaderLibrary shaders;
+    Shader& shader = shaders.variant("vertexShader.glsl", "fragmentShader.glsl");
+    shaders.finishAll();
+
+    shader.use();
+    shader.setMat4("model", glm::mat4(1.0f));
+
+    CameraBuffer camera;
+    camera.create();
+    camera.update(glm::mat4(1.0f), glm::mat4(0.0f));
+
+    DrawCommandBuffer draws;
+    draws.create();
+
+    DrawScene scene;
+    scene.pool = &pool;
+    scene.draws = &draws;
+    scene.live = &live;
+    scene.separate = separateMeshes(pool, live);
+
+    double separateMs = timeFrames(window, drawSeparate, scene, TIMED_FRAMES);
+    double pooledMs = timeFrames(window, drawPooled, scene, TIMED_FRAMES);
+
+    std::cout << glGetString(GL_RENDERER) << std::endl;
+    printf("separate VAOs: %.3f ms per frame, %zu draw call(s)\n", separateMs, scene.separate.size());
+    printf("pooled:        %.3f ms per frame, %u draw call(s)%s\n", pooledMs, draws.drawCalls, draws.multiDrawIndirect ? " (multi-draw indirect)" : "");
+
+    for(const SeparateMesh& mesh : scene.separate) {
+        glDeleteBuffers(1, &mesh.VBO);
+        glDeleteBuffers(1, &mesh.EBO);
+        glDeleteVertexArrays(1, &mesh.VAO);
+    }
+
+    draws.destroy();
+    camera.destroy();
+    glDeleteProgram(shader.shaderProgram);
+    pool.destroy();
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    return ok ? 0 : -1;
+}
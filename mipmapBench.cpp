@@ -0,0 +1,185 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "mipmapGenerator.h"
+
+// Time to build a full mip chain with glGenerateMipmap against mipmapGenerator.h on
+// one CPU thread, per filter and kernel, plus the upload of the CPU levels.
+//
+//   mipmapBench [image]     a 2048x2048 generated RGBA image without one
+//
+// Run it under llvmpipe (LIBGL_ALWAYS_SOFTWARE=1) to see the software driver case,
+// where glGenerateMipmap runs on the render thread's CPU time.
+
+const int IMAGE_SIZE = 2048;
+const int ITERATIONS = 5;
+
+struct Variant {
+    const char* name;
+    MipFilter filter;
+    MipSimd simd;
+};
+
+std::vector<unsigned char> makeImage() {
+    std::vector<unsigned char> pixels((size_t)IMAGE_SIZE * IMAGE_SIZE * 4);
+
+    for(int y = 0; y < IMAGE_SIZE; ++y) {
+        for(int x = 0; x < IMAGE_SIZE; ++x) {
+            unsigned char* texel = &pixels[((size_t)y * IMAGE_SIZE + x) * 4];
+            texel[0] = (unsigned char)(127.5f + 127.5f * std::sin(x * 0.05f) * std::cos(y * 0.03f));
+            texel[1] = (unsigned char)(((x / 16) ^ (y / 16)) & 1 ? 230 : 20);
+            texel[2] = (unsigned char)((x * y) >> 14);
+            texel[3] = 255;
+        }
+    }
+
+    return pixels;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double gpuGenerateMs(const unsigned char* pixels, int width, int height, GLenum format) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glFinish();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < ITERATIONS; ++i) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    glFinish();
+    double ms = elapsedMs(start) / ITERATIONS;
+
+    glDeleteTextures(1, &texture);
+
+    return ms;
+}
+
+double uploadLevelsMs(const MipChain& chain, GLenum format) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glFinish();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < ITERATIONS; ++i) {
+        for(size_t level = 0; level < chain.levels.size(); ++level) {
+            const MipLevel& info = chain.levels[level];
+            glTexImage2D(GL_TEXTURE_2D, (GLint)level + 1, format, info.width, info.height, 0, format, GL_UNSIGNED_BYTE, chain.data.data() + info.offset);
+        }
+    }
+
+    glFinish();
+    double ms = elapsedMs(start) / ITERATIONS;
+
+    glDeleteTextures(1, &texture);
+
+    return ms;
+}
+
+int main(int argc, char** argv) {
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Mipmap benchmark", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    int width = IMAGE_SIZE, height = IMAGE_SIZE, channels = 4;
+    std::vector<unsigned char> generated;
+    unsigned char* pixels = nullptr;
+
+    if(argc > 1) {
+        pixels = stbi_load(argv[1], &width, &height, &channels, 0);
+
+        if(!pixels) {
+            std::cout << "ERROR::MIPMAP_BENCH::DECODE_FAILED: " << argv[1] << " (" << stbi_failure_reason() << ")" << std::endl;
+            return -1;
+        }
+    }
+    else {
+        generated = makeImage();
+        pixels = generated.data();
+    }
+
+    GLenum format = channels == 4 ? GL_RGBA : channels == 3 ? GL_RGB : channels == 2 ? GL_RG : GL_RED;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    std::cout << glGetString(GL_RENDERER) << ", " << width << "x" << height << "x" << channels << std::endl;
+    printf("%-28s %-12s %-11s %s\n", "mip chain", "build ms", "upload ms", "render thread ms");
+
+    double gpuMs = gpuGenerateMs(pixels, width, height, format);
+    printf("%-28s %-12.2f %-11s %.2f\n", "glGenerateMipmap", gpuMs, "-", gpuMs);
+
+    Variant variants[] = {
+        {"box, scalar", MIP_FILTER_BOX, MIP_SIMD_SCALAR},
+        {"box, sse2", MIP_FILTER_BOX, MIP_SIMD_SSE2},
+        {"box, avx2", MIP_FILTER_BOX, MIP_SIMD_AVX2},
+        {"kaiser, scalar", MIP_FILTER_KAISER, MIP_SIMD_SCALAR},
+        {"kaiser, sse2", MIP_FILTER_KAISER, MIP_SIMD_SSE2},
+        {"kaiser, avx2", MIP_FILTER_KAISER, MIP_SIMD_AVX2},
+    };
+
+    for(const Variant& variant : variants) {
+        MipSettings settings;
+        settings.filter = variant.filter;
+        settings.simd = variant.simd;
+
+        if(mipKernels(variant.simd).simd != variant.simd) {
+            printf("%-28s not supported on this CPU\n", variant.name);
+            continue;
+        }
+
+        MipChain chain;
+        auto start = std::chrono::steady_clock::now();
+
+        for(int i = 0; i < ITERATIONS; ++i) {
+            chain = generateMipChain(pixels, width, height, channels, settings);
+        }
+
+        double buildMs = elapsedMs(start) / ITERATIONS;
+        double uploadMs = uploadLevelsMs(chain, format);
+
+        // the build happens on a worker, so only the upload costs the render thread
+        printf("%-28s %-12.2f %-11.2f %.2f\n", variant.name, buildMs, uploadMs, uploadMs);
+    }
+
+    if(generated.empty()) {
+        stbi_image_free(pixels);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
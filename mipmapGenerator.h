@@ -0,0 +1,451 @@
+#ifndef MIPMAP_GENERATOR_H
+#define MIPMAP_GENERATOR_H
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIPMAP_GENERATOR_X86 1
+#include <immintrin.h>
+#endif
+
+// Builds a texture's mip chain on the CPU, so worker threads can do it next to the
+// decode and the GL thread only uploads finished levels instead of calling
+// glGenerateMipmap.
+//
+// Each level is filtered from the previous one kept in float, with a separable 2:1
+// kernel: a 2x2 box, or an 8 tap Kaiser windowed sinc that keeps small mips sharper
+// without aliasing. With srgb set, colour channels are converted to linear before
+// filtering and back afterwards; a box filter straight on sRGB bytes darkens every
+// level (the average of black and white comes out at 128, where 188 is correct).
+// Alpha is always filtered as stored. The filter loops have SSE2 and AVX2 kernels
+// picked at run time like frustumCulling.h.
+
+enum MipFilter { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+
+enum MipSimd { MIP_SIMD_BEST, MIP_SIMD_SCALAR, MIP_SIMD_SSE2, MIP_SIMD_AVX2 };
+
+struct MipSettings {
+    MipFilter filter = MIP_FILTER_BOX;
+    bool srgb = true;
+    MipSimd simd = MIP_SIMD_BEST;
+};
+
+struct MipLevel {
+    int width, height;
+    size_t offset, size;
+};
+
+// levels 1 and up; level 0 stays with the caller
+struct MipChain {
+    int channels = 0;
+    std::vector<MipLevel> levels;
+    std::vector<unsigned char> data;
+};
+
+// ---- filter kernels ----
+
+// out[i] = sum of weights[k] * rows[k][i]
+inline void filterRowsScalar(const float* const* rows, const float* weights, int taps, float* out, size_t count) {
+    for(size_t i = 0; i < count; ++i) {
+        float sum = 0.0f;
+
+        for(int k = 0; k < taps; ++k) {
+            sum += weights[k] * rows[k][i];
+        }
+
+        out[i] = sum;
+    }
+}
+
+// RGBA float texels: out[x] = sum of weights[k] * padded[2x + k]
+inline void filterTexelsScalar(const float* padded, const float* weights, int taps, float* out, int outWidth) {
+    for(int x = 0; x < outWidth; ++x) {
+        for(int c = 0; c < 4; ++c) {
+            float sum = 0.0f;
+
+            for(int k = 0; k < taps; ++k) {
+                sum += weights[k] * padded[(2 * x + k) * 4 + c];
+            }
+
+            out[x * 4 + c] = sum;
+        }
+    }
+}
+
+#ifdef MIPMAP_GENERATOR_X86
+
+__attribute__((target("sse2")))
+inline void filterRowsSSE2(const float* const* rows, const float* weights, int taps, float* out, size_t count) {
+    size_t simdEnd = count & ~(size_t)3;
+
+    for(size_t i = 0; i < simdEnd; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+
+        for(int k = 0; k < taps; ++k) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+        }
+
+        _mm_storeu_ps(out + i, sum);
+    }
+
+    const float* tail[8];
+
+    for(int k = 0; k < taps; ++k) {
+        tail[k] = rows[k] + simdEnd;
+    }
+
+    filterRowsScalar(tail, weights, taps, out + simdEnd, count - simdEnd);
+}
+
+// one RGBA texel per register
+__attribute__((target("sse2")))
+inline void filterTexelsSSE2(const float* padded, const float* weights, int taps, float* out, int outWidth) {
+    for(int x = 0; x < outWidth; ++x) {
+        __m128 sum = _mm_setzero_ps();
+
+        for(int k = 0; k < taps; ++k) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(padded + (2 * x + k) * 4)));
+        }
+
+        _mm_storeu_ps(out + x * 4, sum);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline void filterRowsAVX2(const float* const* rows, const float* weights, int taps, float* out, size_t count) {
+    size_t simdEnd = count & ~(size_t)7;
+
+    for(size_t i = 0; i < simdEnd; i += 8) {
+        __m256 sum = _mm256_setzero_ps();
+
+        for(int k = 0; k < taps; ++k) {
+            sum = _mm256_fmadd_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i), sum);
+        }
+
+        _mm256_storeu_ps(out + i, sum);
+    }
+
+    const float* tail[8];
+
+    for(int k = 0; k < taps; ++k) {
+        tail[k] = rows[k] + simdEnd;
+    }
+
+    filterRowsScalar(tail, weights, taps, out + simdEnd, count - simdEnd);
+}
+
+// two output texels per register; their sources are two texels apart
+__attribute__((target("avx2,fma")))
+inline void filterTexelsAVX2(const float* padded, const float* weights, int taps, float* out, int outWidth) {
+    int simdEnd = outWidth & ~1;
+
+    for(int x = 0; x < simdEnd; x += 2) {
+        __m256 sum = _mm256_setzero_ps();
+
+        for(int k = 0; k < taps; ++k) {
+            const float* source = padded + (2 * x + k) * 4;
+            __m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(source)), _mm_loadu_ps(source + 8), 1);
+            sum = _mm256_fmadd_ps(_mm256_set1_ps(weights[k]), texels, sum);
+        }
+
+        _mm256_storeu_ps(out + x * 4, sum);
+    }
+
+    if(simdEnd < outWidth) {
+        filterTexelsScalar(padded + simdEnd * 2 * 4, weights, taps, out + simdEnd * 4, outWidth - simdEnd);
+    }
+}
+
+inline bool mipmapHasAVX2() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+
+inline bool mipmapHasSSE2() {
+    static const bool supported = __builtin_cpu_supports("sse2");
+    return supported;
+}
+
+#endif
+
+struct MipKernels {
+    MipSimd simd;
+    void (*rows)(const float* const*, const float*, int, float*, size_t);
+    void (*texels)(const float*, const float*, int, float*, int);
+};
+
+// the requested kernels, or the next best this CPU has
+inline MipKernels mipKernels(MipSimd simd = MIP_SIMD_BEST) {
+#ifdef MIPMAP_GENERATOR_X86
+    if((simd == MIP_SIMD_BEST || simd == MIP_SIMD_AVX2) && mipmapHasAVX2()) {
+        return {MIP_SIMD_AVX2, filterRowsAVX2, filterTexelsAVX2};
+    }
+
+    if(simd != MIP_SIMD_SCALAR && mipmapHasSSE2()) {
+        return {MIP_SIMD_SSE2, filterRowsSSE2, filterTexelsSSE2};
+    }
+#endif
+    (void)simd;
+    return {MIP_SIMD_SCALAR, filterRowsScalar, filterTexelsScalar};
+}
+
+// ---- filters ----
+
+struct MipKernel {
+    // source texel under the first tap, relative to 2 * destination texel
+    int first;
+    int taps;
+    float weights[8];
+};
+
+// modified Bessel function of the first kind, order 0
+inline double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+
+    for(int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+
+    return sum;
+}
+
+inline MipKernel mipKernel(MipFilter filter) {
+    MipKernel kernel;
+
+    if(filter == MIP_FILTER_BOX) {
+        kernel.first = 0;
+        kernel.taps = 2;
+        kernel.weights[0] = kernel.weights[1] = 0.5f;
+        return kernel;
+    }
+
+    // sinc windowed by a Kaiser window (alpha 4) two destination texels wide, sampled
+    // at the eight source texel centres around the destination texel
+    const double alpha = 4.0, width = 2.0, pi = 3.14159265358979323846;
+
+    kernel.first = -3;
+    kernel.taps = 8;
+
+    double total = 0.0, weights[8];
+
+    for(int k = 0; k < 8; ++k) {
+        double distance = (k + kernel.first + 0.5 - 1.0) / 2.0;
+        double sinc = distance == 0.0 ? 1.0 : std::sin(pi * distance) / (pi * distance);
+        double window = distance / width;
+        window = besselI0(alpha * std::sqrt(std::fmax(0.0, 1.0 - window * window))) / besselI0(alpha);
+
+        weights[k] = sinc * window;
+        total += weights[k];
+    }
+
+    for(int k = 0; k < 8; ++k) {
+        kernel.weights[k] = (float)(weights[k] / total);
+    }
+
+    return kernel;
+}
+
+// ---- colour conversion ----
+
+struct MipColorTables {
+    float srgbToLinear[256];
+    float unormToFloat[256];
+    // linear value * 4095 -> sRGB byte
+    unsigned char linearToSrgb[4096];
+
+    MipColorTables() {
+        for(int i = 0; i < 256; ++i) {
+            double value = i / 255.0;
+            srgbToLinear[i] = (float)(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+            unormToFloat[i] = (float)value;
+        }
+
+        for(int i = 0; i < 4096; ++i) {
+            double value = i / 4095.0;
+            value = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+            linearToSrgb[i] = (unsigned char)(value * 255.0 + 0.5);
+        }
+    }
+};
+
+inline const MipColorTables& mipColorTables() {
+    static const MipColorTables tables;
+    return tables;
+}
+
+// ---- rows ----
+
+// a source row of bytes as linear RGBA floats, widened with clamped texels to the
+// kernel's reach: texel j of padded is source texel kernel.first + j
+inline void mipWidenByteRow(const unsigned char* row, int width, int channels, const bool* linearChannel, const MipKernel& kernel, float* padded, int paddedWidth) {
+    const MipColorTables& tables = mipColorTables();
+
+    for(int j = 0; j < paddedWidth; ++j) {
+        int x = j + kernel.first;
+        x = x < 0 ? 0 : x >= width ? width - 1 : x;
+
+        const unsigned char* source = row + (size_t)x * channels;
+        float* texel = padded + (size_t)j * 4;
+
+        for(int c = 0; c < 4; ++c) {
+            texel[c] = c >= channels ? 0.0f : linearChannel[c] ? tables.unormToFloat[source[c]] : tables.srgbToLinear[source[c]];
+        }
+    }
+}
+
+// linear RGBA floats back to bytes; the Kaiser lobes can overshoot, so clamp
+inline void mipStoreTexels(const float* texels, size_t count, int channels, const bool* linearChannel, unsigned char* out) {
+    const MipColorTables& tables = mipColorTables();
+
+    for(size_t i = 0; i < count; ++i) {
+        for(int c = 0; c < channels; ++c) {
+            float value = texels[i * 4 + c];
+            value = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+
+            out[i * channels + c] = linearChannel[c] ? (unsigned char)(value * 255.0f + 0.5f) : tables.linearToSrgb[(int)(value * 4095.0f + 0.5f)];
+        }
+    }
+}
+
+// ---- chain ----
+
+inline MipChain generateMipChain(const unsigned char* pixels, int width, int height, int channels, const MipSettings& settings = MipSettings()) {
+    MipKernels kernels = mipKernels(settings.simd);
+    MipKernel kernel = mipKernel(settings.filter);
+
+    // alpha is the last channel of grey+alpha and RGBA images
+    int alphaChannel = channels == 2 || channels == 4 ? channels - 1 : -1;
+    bool linearChannel[4];
+
+    for(int c = 0; c < 4; ++c) {
+        linearChannel[c] = !settings.srgb || c == alphaChannel;
+    }
+
+    MipChain chain;
+    chain.channels = channels;
+
+    // current level as linear RGBA float; empty while the source is still the byte image
+    std::vector<float> level, next, horizontal, padded;
+    const float* rows[8];
+
+    while(width > 1 || height > 1) {
+        int nextWidth = width > 1 ? width / 2 : 1;
+        int nextHeight = height > 1 ? height / 2 : 1;
+
+        // horizontal: each source row, widened with clamped texels to the kernel's reach
+        int paddedWidth = 2 * (nextWidth - 1) + kernel.taps;
+        padded.resize((size_t)paddedWidth * 4);
+        horizontal.resize((size_t)nextWidth * height * 4);
+
+        for(int y = 0; y < height; ++y) {
+            if(level.empty()) {
+                mipWidenByteRow(pixels + (size_t)y * width * channels, width, channels, linearChannel, kernel, padded.data(), paddedWidth);
+            }
+            else {
+                for(int j = 0; j < paddedWidth; ++j) {
+                    int x = j + kernel.first;
+                    x = x < 0 ? 0 : x >= width ? width - 1 : x;
+
+                    memcpy(&padded[(size_t)j * 4], &level[((size_t)y * width + x) * 4], 4 * sizeof(float));
+                }
+            }
+
+            kernels.texels(padded.data(), kernel.weights, kernel.taps, &horizontal[(size_t)y * nextWidth * 4], nextWidth);
+        }
+
+        // vertical
+        next.resize((size_t)nextWidth * nextHeight * 4);
+
+        for(int y = 0; y < nextHeight; ++y) {
+            for(int k = 0; k < kernel.taps; ++k) {
+                int sourceY = 2 * y + kernel.first + k;
+                sourceY = sourceY < 0 ? 0 : sourceY >= height ? height - 1 : sourceY;
+                rows[k] = &horizontal[(size_t)sourceY * nextWidth * 4];
+            }
+
+            kernels.rows(rows, kernel.weights, kernel.taps, &next[(size_t)y * nextWidth * 4], (size_t)nextWidth * 4);
+        }
+
+        MipLevel info = {nextWidth, nextHeight, chain.data.size(), (size_t)nextWidth * nextHeight * channels};
+        chain.levels.push_back(info);
+        chain.data.resize(info.offset + info.size);
+
+        mipStoreTexels(next.data(), (size_t)nextWidth * nextHeight, channels, linearChannel, chain.data.data() + info.offset);
+
+        level.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    return chain;
+}
+
+// The next level a row at a time, for images too large to keep a level of in float
+// (virtualTexture.h). Same kernels as generateMipChain, but a level below the first
+// is filtered from the rounded bytes of the one above rather than its floats. Rows
+// should be asked for in order: only the kernel's reach of horizontally filtered
+// source rows is kept, and each is filtered once.
+class MipRowFilter {
+    public:
+    int width, height, channels;
+    int nextWidth, nextHeight;
+
+    MipRowFilter(int sourceWidth, int sourceHeight, int imageChannels, const MipSettings& settings = MipSettings())
+        : width(sourceWidth), height(sourceHeight), channels(imageChannels), kernels(mipKernels(settings.simd)), kernel(mipKernel(settings.filter)) {
+        nextWidth = width > 1 ? width / 2 : 1;
+        nextHeight = height > 1 ? height / 2 : 1;
+
+        int alphaChannel = channels == 2 || channels == 4 ? channels - 1 : -1;
+
+        for(int c = 0; c < 4; ++c) {
+            linearChannel[c] = !settings.srgb || c == alphaChannel;
+        }
+
+        paddedWidth = 2 * (nextWidth - 1) + kernel.taps;
+        padded.resize((size_t)paddedWidth * 4);
+        horizontal.resize((size_t)kernel.taps * nextWidth * 4);
+        vertical.resize((size_t)nextWidth * 4);
+        cachedRows.assign(kernel.taps, -1);
+    }
+
+    // sourceRow(y) returns row y of the source level, channels bytes per texel
+    template<typename SourceRow>
+    void filterRow(int y, SourceRow&& sourceRow, unsigned char* out) {
+        const float* rows[8];
+
+        for(int k = 0; k < kernel.taps; ++k) {
+            int sourceY = 2 * y + kernel.first + k;
+            sourceY = sourceY < 0 ? 0 : sourceY >= height ? height - 1 : sourceY;
+
+            // a row's taps are consecutive source rows, so they never share a slot
+            int slot = sourceY % kernel.taps;
+            float* row = &horizontal[(size_t)slot * nextWidth * 4];
+
+            if(cachedRows[slot] != sourceY) {
+                mipWidenByteRow(sourceRow(sourceY), width, channels, linearChannel, kernel, padded.data(), paddedWidth);
+                kernels.texels(padded.data(), kernel.weights, kernel.taps, row, nextWidth);
+                cachedRows[slot] = sourceY;
+            }
+
+            rows[k] = row;
+        }
+
+        kernels.rows(rows, kernel.weights, kernel.taps, vertical.data(), (size_t)nextWidth * 4);
+        mipStoreTexels(vertical.data(), (size_t)nextWidth, channels, linearChannel, out);
+    }
+
+    private:
+    MipKernels kernels;
+    MipKernel kernel;
+    bool linearChannel[4];
+    int paddedWidth;
+    std::vector<float> padded, horizontal, vertical;
+    // source row held in each slot of horizontal
+    std::vector<int> cachedRows;
+};
+
+#endif
@@ -0,0 +1,456 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include "mappedFile.h"
+
+// Wavefront OBJ importer producing an indexed mesh in the interleaved layout the
+// rest of the renderer uses: position (3 floats), texture coordinate (2 floats) and,
+// if asked for, normal (3 floats).
+//
+// The file is memory mapped and split at line boundaries into one chunk per hardware
+// thread. Each thread parses its chunk with the hand written number parsers below
+// (no iostream or strtod locale lookups) into its own v / vt / vn / face arrays.
+// The chunks are then concatenated and every distinct position/uv/normal tuple
+// becomes one vertex, found through a hash map. Only v, vt, vn and f lines are read;
+// polygons are triangulated as fans and everything else (groups, materials) skipped.
+
+struct ObjLoadStats {
+    size_t bytes = 0;
+    unsigned int threads = 0;
+    double parseMs = 0.0;
+    double indexMs = 0.0;
+    double totalMs = 0.0;
+};
+
+struct ObjMesh {
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    // 5, or 8 when normals were requested
+    int floatsPerVertex = 5;
+    size_t vertexCount = 0;
+
+    ObjLoadStats stats;
+};
+
+const int32_t OBJ_MISSING = INT32_MIN;
+
+// bits of ObjCorner::relative
+enum ObjIndexBits { OBJ_RELATIVE_POSITION = 1, OBJ_RELATIVE_UV = 2, OBJ_RELATIVE_NORMAL = 4 };
+
+// 0-based indices. OBJ's negative indices count back from the last vertex read, which
+// a chunk only knows relative to its own start: those are stored relative to the
+// chunk and flagged until the sizes of the chunks before it are known.
+struct ObjCorner {
+    int32_t position, uv, normal;
+    uint32_t relative;
+};
+
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+
+    std::vector<float> positions, uvs, normals;
+    // three corners per triangle
+    std::vector<ObjCorner> corners;
+};
+
+inline bool objSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* objSkipSpace(const char* p, const char* end) {
+    while(p < end && objSpace(*p)) {
+        ++p;
+    }
+
+    return p;
+}
+
+inline const char* objNextLine(const char* p, const char* end) {
+    while(p < end && *p != '\n') {
+        ++p;
+    }
+
+    return p < end ? p + 1 : end;
+}
+
+inline const char* objParseInt(const char* p, const char* end, int32_t& value) {
+    bool negative = false;
+
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    int32_t result = 0;
+
+    while(p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (*p - '0');
+        ++p;
+    }
+
+    value = negative ? -result : result;
+
+    return p;
+}
+
+// decimal float with optional exponent; good to a couple of ulps, which is plenty for
+// mesh data and several times faster than strtod
+inline const char* objParseFloat(const char* p, const char* end, float& value) {
+    static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    bool negative = false;
+
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+
+    for(; p < end && *p >= '0' && *p <= '9'; ++p) {
+        // digits past 19 no longer fit and no longer matter
+        if(digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else {
+            exponent++;
+        }
+    }
+
+    if(p < end && *p == '.') {
+        for(++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        int32_t written;
+        p = objParseInt(p + 1, end, written);
+        exponent += written;
+    }
+
+    double result = (double)mantissa;
+
+    while(exponent > 22) {
+        result *= 1e22;
+        exponent -= 22;
+    }
+
+    while(exponent < -22) {
+        result /= 1e22;
+        exponent += 22;
+    }
+
+    result = exponent >= 0 ? result * powersOfTen[exponent] : result / powersOfTen[-exponent];
+    value = (float)(negative ? -result : result);
+
+    return p;
+}
+
+inline const char* objParseFloats(const char* p, const char* end, std::vector<float>& out, int count) {
+    for(int i = 0; i < count; ++i) {
+        float value = 0.0f;
+        p = objSkipSpace(p, end);
+        p = objParseFloat(p, end, value);
+        out.push_back(value);
+    }
+
+    return p;
+}
+
+// 1-based or negative OBJ index to the ObjCorner encoding
+inline int32_t objResolveIndex(int32_t index, size_t localCount, uint32_t& relative, uint32_t bit) {
+    if(index > 0) {
+        return index - 1;
+    }
+
+    if(index < 0) {
+        relative |= bit;
+        return (int32_t)localCount + index;
+    }
+
+    return OBJ_MISSING;
+}
+
+inline const char* objParseCorner(const char* p, const char* end, const ObjChunk& chunk, ObjCorner& corner) {
+    int32_t index;
+    p = objParseInt(p, end, index);
+    corner.relative = 0;
+    corner.position = objResolveIndex(index, chunk.positions.size() / 3, corner.relative, OBJ_RELATIVE_POSITION);
+    corner.uv = OBJ_MISSING;
+    corner.normal = OBJ_MISSING;
+
+    if(p < end && *p == '/') {
+        ++p;
+
+        // v//vn has no texture coordinate
+        if(p < end && *p != '/') {
+            p = objParseInt(p, end, index);
+            corner.uv = objResolveIndex(index, chunk.uvs.size() / 2, corner.relative, OBJ_RELATIVE_UV);
+        }
+
+        if(p < end && *p == '/') {
+            p = objParseInt(p + 1, end, index);
+            corner.normal = objResolveIndex(index, chunk.normals.size() / 3, corner.relative, OBJ_RELATIVE_NORMAL);
+        }
+    }
+
+    return p;
+}
+
+inline void parseObjChunk(ObjChunk& chunk) {
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+
+    while(p < end) {
+        p = objSkipSpace(p, end);
+
+        if(p + 1 < end && p[0] == 'v' && objSpace(p[1])) {
+            p = objParseFloats(p + 2, end, chunk.positions, 3);
+        }
+        else if(p + 2 < end && p[0] == 'v' && p[1] == 't' && objSpace(p[2])) {
+            p = objParseFloats(p + 3, end, chunk.uvs, 2);
+        }
+        else if(p + 2 < end && p[0] == 'v' && p[1] == 'n' && objSpace(p[2])) {
+            p = objParseFloats(p + 3, end, chunk.normals, 3);
+        }
+        else if(p + 1 < end && p[0] == 'f' && objSpace(p[1])) {
+            ObjCorner first, previous, corner;
+            int count = 0;
+
+            p = objSkipSpace(p + 2, end);
+
+            while(p < end && *p != '\n' && *p != '#') {
+                const char* cornerBegin = p;
+                p = objParseCorner(p, end, chunk, corner);
+
+                // not a number: give up on the rest of the line
+                if(p == cornerBegin) {
+                    break;
+                }
+
+                // fan triangulation: (first, previous, current) from the third corner on
+                if(count >= 2) {
+                    chunk.corners.push_back(first);
+                    chunk.corners.push_back(previous);
+                    chunk.corners.push_back(corner);
+                }
+
+                if(count == 0) {
+                    first = corner;
+                }
+
+                previous = corner;
+                count++;
+
+                p = objSkipSpace(p, end);
+            }
+        }
+
+        p = objNextLine(p, end);
+    }
+}
+
+struct ObjVertexKey {
+    int32_t position, uv, normal;
+
+    bool operator==(const ObjVertexKey& other) const {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+};
+
+struct ObjVertexKeyHash {
+    size_t operator()(const ObjVertexKey& key) const {
+        uint64_t hash = (uint64_t)(uint32_t)key.position * 0x9E3779B97F4A7C15ull;
+        hash ^= ((uint64_t)(uint32_t)key.uv + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+        hash ^= ((uint64_t)(uint32_t)key.normal + 0x85EBCA77C2B2AE63ull) * 0x165667B19E3779F9ull;
+
+        return (size_t)(hash ^ (hash >> 29));
+    }
+};
+
+inline bool loadObj(const char* path, ObjMesh& mesh, bool withNormals = false, unsigned int threadCount = 0) {
+    auto start = std::chrono::steady_clock::now();
+
+    mesh = ObjMesh();
+    mesh.floatsPerVertex = withNormals ? 8 : 5;
+
+    MappedFile file;
+
+    if(!file.open(path)) {
+        return false;
+    }
+
+    const char* text = (const char*)file.data;
+    const char* textEnd = text + file.size;
+
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // small files aren't worth the thread start up
+    size_t chunkCount = file.size / (256 * 1024) + 1;
+    chunkCount = chunkCount < threadCount ? chunkCount : threadCount;
+    chunkCount = chunkCount > 0 ? chunkCount : 1;
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* chunkBegin = text;
+
+    for(size_t i = 0; i < chunkCount; ++i) {
+        const char* chunkEnd = i + 1 == chunkCount ? textEnd : text + file.size / chunkCount * (i + 1);
+        chunkEnd = chunkEnd < chunkBegin ? chunkBegin : chunkEnd;
+
+        // never cut a line in two
+        if(chunkEnd < textEnd && chunkEnd > text && chunkEnd[-1] != '\n') {
+            chunkEnd = objNextLine(chunkEnd, textEnd);
+        }
+
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    std::vector<std::thread> workers;
+
+    for(size_t i = 1; i < chunkCount; ++i) {
+        workers.emplace_back(parseObjChunk, std::ref(chunks[i]));
+    }
+
+    parseObjChunk(chunks[0]);
+
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+
+    auto parsed = std::chrono::steady_clock::now();
+
+    // concatenate the chunks, turning chunk-local indices into global ones
+    std::vector<float> positions, uvs, normals;
+    size_t totalCorners = 0;
+
+    for(const ObjChunk& chunk : chunks) {
+        totalCorners += chunk.corners.size();
+    }
+
+    std::vector<ObjCorner> corners;
+    corners.reserve(totalCorners);
+
+    for(ObjChunk& chunk : chunks) {
+        int32_t positionBase = (int32_t)(positions.size() / 3);
+        int32_t uvBase = (int32_t)(uvs.size() / 2);
+        int32_t normalBase = (int32_t)(normals.size() / 3);
+
+        for(ObjCorner corner : chunk.corners) {
+            if(corner.relative & OBJ_RELATIVE_POSITION) {
+                corner.position += positionBase;
+            }
+
+            if(corner.relative & OBJ_RELATIVE_UV) {
+                corner.uv += uvBase;
+            }
+
+            if(corner.relative & OBJ_RELATIVE_NORMAL) {
+                corner.normal += normalBase;
+            }
+
+            corners.push_back(corner);
+        }
+
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+        chunk = ObjChunk();
+    }
+
+    int32_t positionCount = (int32_t)(positions.size() / 3);
+    int32_t uvCount = (int32_t)(uvs.size() / 2);
+    int32_t normalCount = (int32_t)(normals.size() / 3);
+
+    std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash> vertexIndices;
+    vertexIndices.reserve(corners.size() / 2);
+    mesh.indices.reserve(corners.size());
+
+    for(const ObjCorner& corner : corners) {
+        if(corner.position < 0 || corner.position >= positionCount) {
+            std::cout << "ERROR::OBJ::BAD_INDEX: " << path << " references vertex " << corner.position + 1 << " of " << positionCount << std::endl;
+            return false;
+        }
+
+        ObjVertexKey key;
+        key.position = corner.position;
+        key.uv = corner.uv >= 0 && corner.uv < uvCount ? corner.uv : OBJ_MISSING;
+        // normals don't split vertices that won't store them
+        key.normal = withNormals && corner.normal >= 0 && corner.normal < normalCount ? corner.normal : OBJ_MISSING;
+
+        auto inserted = vertexIndices.emplace(key, (uint32_t)mesh.vertexCount);
+
+        if(inserted.second) {
+            const float* position = positions.data() + key.position * 3;
+            mesh.vertices.insert(mesh.vertices.end(), position, position + 3);
+
+            if(key.uv != OBJ_MISSING) {
+                mesh.vertices.push_back(uvs[key.uv * 2]);
+                mesh.vertices.push_back(uvs[key.uv * 2 + 1]);
+            }
+            else {
+                mesh.vertices.push_back(0.0f);
+                mesh.vertices.push_back(0.0f);
+            }
+
+            if(withNormals) {
+                if(key.normal != OBJ_MISSING) {
+                    const float* normal = normals.data() + key.normal * 3;
+                    mesh.vertices.insert(mesh.vertices.end(), normal, normal + 3);
+                }
+                else {
+                    mesh.vertices.insert(mesh.vertices.end(), {0.0f, 0.0f, 0.0f});
+                }
+            }
+
+            mesh.vertexCount++;
+        }
+
+        mesh.indices.push_back(inserted.first->second);
+    }
+
+    auto finished = std::chrono::steady_clock::now();
+
+    mesh.stats.bytes = file.size;
+    mesh.stats.threads = (unsigned int)chunkCount;
+    mesh.stats.parseMs = std::chrono::duration<double, std::milli>(parsed - start).count();
+    mesh.stats.indexMs = std::chrono::duration<double, std::milli>(finished - parsed).count();
+    mesh.stats.totalMs = std::chrono::duration<double, std::milli>(finished - start).count();
+
+    return true;
+}
+
+inline void printObjLoadStats(const ObjMesh& mesh) {
+    const ObjLoadStats& stats = mesh.stats;
+    double megabytes = stats.bytes / (1024.0 * 1024.0);
+
+    std::cout << "OBJ::LOAD: " << megabytes << " MB, " << mesh.vertexCount << " vertices, " << mesh.indices.size() / 3 << " triangles on "
+              << stats.threads << " thread(s): parse " << stats.parseMs << " ms (" << megabytes / stats.parseMs * 1000.0 << " MB/s), index "
+              << stats.indexMs << " ms, total " << megabytes / stats.totalMs * 1000.0 << " MB/s" << std::endl;
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+// Entries are keyed by a hash of the shader sources, the injected defines and the
+// driver's vendor/renderer/version strings, so a driver update or an edited shader
+// simply misses and falls back to compiling from source.
+
+#define PROGRAM_CACHE_DIR "shaderCache"
+
+const uint32_t PROGRAM_CACHE_MAGIC = 0x4E494250; // "PBIN"
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+    // how long the source compile took when the entry was written, used to report time saved
+    double compileMs;
+};
+
+struct ProgramCacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    // misses whose link failed; they aren't cached and their time isn't in compileMs
+    unsigned int linkFailures = 0;
+    double loadMs = 0.0;
+    double compileMs = 0.0;
+    double savedMs = 0.0;
+};
+
+inline ProgramCacheStats programCacheStats;
+
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    for(size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+inline uint64_t hashString(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+    // hash the length too so ("ab", "c") and ("a", "bc") don't collide
+    uint64_t length = text.size();
+    hash = hashBytes(&length, sizeof(length), hash);
+
+    return hashBytes(text.data(), text.size(), hash);
+}
+
+inline bool programBinarySupported() {
+    if(!(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+        return false;
+    }
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    return formats > 0;
+}
+
+inline uint64_t programCacheKey(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines) {
+    const char* vendor = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+
+    uint64_t hash = hashString(vertexSource);
+    hash = hashString(fragmentSource, hash);
+    hash = hashString(defines, hash);
+    hash = hashString(vendor ? vendor : "", hash);
+    hash = hashString(renderer ? renderer : "", hash);
+    hash = hashString(version ? version : "", hash);
+
+    return hash;
+}
+
+inline std::string programCachePath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+
+    return std::string(PROGRAM_CACHE_DIR) + "/" + name;
+}
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// try to fill an unlinked program from the cache; returns false on any mismatch so the
+// caller falls back to compiling from source
+inline bool loadProgramBinary(GLuint program, uint64_t key) {
+    if(!programBinarySupported()) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string path = programCachePath(key);
+
+    FILE* file = fopen(path.c_str(), "rb");
+
+    if(!file) {
+        return false;
+    }
+
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1
+        && header.magic == PROGRAM_CACHE_MAGIC
+        && header.version == PROGRAM_CACHE_VERSION
+        && header.key == key;
+
+    if(valid) {
+        binary.resize(header.binaryLength);
+        valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+
+    fclose(file);
+
+    if(!valid) {
+        return false;
+    }
+
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+    // the driver is free to reject a binary it produced earlier (e.g. after an update)
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    if(!success) {
+        std::cout << "SHADER::CACHE::STALE " << path << ", recompiling" << std::endl;
+        return false;
+    }
+
+    double loadMs = elapsedMs(start);
+
+    programCacheStats.hits++;
+    programCacheStats.loadMs += loadMs;
+    programCacheStats.savedMs += header.compileMs - loadMs;
+
+    std::cout << "SHADER::CACHE::HIT " << path << " loaded in " << loadMs << " ms (saved " << header.compileMs - loadMs << " ms)" << std::endl;
+
+    return true;
+}
+
+// call before glLinkProgram so the driver keeps a retrievable binary around
+inline void hintProgramBinaryRetrievable(GLuint program) {
+    if(programBinarySupported()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+inline void storeProgramBinary(GLuint program, uint64_t key, double compileMs) {
+    std::string path = programCachePath(key);
+
+    programCacheStats.misses++;
+
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    if(!success) {
+        programCacheStats.linkFailures++;
+        std::cout << "SHADER::CACHE::MISS " << path << " failed to link after " << compileMs << " ms, not cached" << std::endl;
+        return;
+    }
+
+    programCacheStats.compileMs += compileMs;
+
+    std::cout << "SHADER::CACHE::MISS " << path << " compiled in " << compileMs << " ms" << std::endl;
+
+    if(!programBinarySupported()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if(length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(PROGRAM_CACHE_DIR, error);
+
+    FILE* file = fopen(path.c_str(), "wb");
+
+    if(!file) {
+        std::cout << "ERROR::SHADER::CACHE::WRITE_FAILED: " << path << std::endl;
+        return;
+    }
+
+    ProgramCacheHeader header = {PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, format, (uint32_t)length, compileMs};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(binary.data(), 1, binary.size(), file);
+    fclose(file);
+}
+
+inline void printProgramCacheStats() {
+    std::cout << "SHADER::CACHE: " << programCacheStats.hits << " hit(s), " << programCacheStats.misses << " miss(es) ("
+              << programCacheStats.linkFailures << " failed to link), "
+              << programCacheStats.compileMs << " ms compiling, " << programCacheStats.loadMs << " ms loading binaries, "
+              << programCacheStats.savedMs << " ms saved" << std::endl;
+}
+
+#endif
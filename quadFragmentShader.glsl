@@ -0,0 +1,18 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec3 myColor;
+#ifdef TEXTURED
+in vec2 textureCoord;
+
+uniform sampler2D myTexture;
+#endif
+
+void main() {
+#ifdef TEXTURED
+    FragColor = texture(myTexture, textureCoord) * vec4(myColor, 1.0f);
+#else
+    FragColor = vec4(myColor, 1.0f);
+#endif
+}
\ No newline at end of file
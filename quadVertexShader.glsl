@@ -0,0 +1,23 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+#ifdef TEXTURED
+layout (location = 2) in vec2 aTexCoord;
+#endif
+
+uniform vec3 npos;
+uniform float scale;
+
+out vec3 myColor;
+#ifdef TEXTURED
+out vec2 textureCoord;
+#endif
+
+void main() {
+    gl_Position = vec4((aPos.x * scale) + npos.x, (aPos.y * scale) + npos.y, aPos.z + npos.z, 1.0);
+    myColor = aColor;
+#ifdef TEXTURED
+    textureCoord = aTexCoord;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,329 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "glState.h"
+
+// Draws collected per frame and submitted in state order instead of the order the
+// code happened to loop in.
+//
+// Every item is a 64-bit sort key and a 32-bit payload, the index of its transform.
+// The key orders by, from the top bit down:
+//
+//   pass (4 bits) | translucent (1) | opaque:      program (12) | material (16) | mesh (12) | depth (16)
+//                                   | translucent: far-to-near depth (16) | program (12) | material (16) | mesh (12)
+//
+// so opaque draws are grouped by program, then texture, then VAO, and go front to
+// back within those; translucent ones come after them and are blended back to front. The keys are
+// sorted with an LSD radix sort, 8 bits a pass, skipping the passes where every key has
+// the same byte (usually the low unused bits and the pass), and submit() walks the
+// result changing program, material or VAO only where those fields of the key differ
+// from the previous item's. The state goes through a GLState, so its counters show
+// what the submission issued.
+
+const int RENDER_KEY_PASS_SHIFT = 60;
+const int RENDER_KEY_TRANSLUCENT_SHIFT = 59;
+const int RENDER_MAX_PASSES = 16;
+const int RENDER_MAX_PROGRAMS = 4096;
+const int RENDER_MAX_MATERIALS = 65536;
+const int RENDER_MAX_MESHES = 4096;
+const int RENDER_DEPTH_BUCKETS = 65536;
+
+struct RenderSortKey {
+    unsigned int pass;
+    bool translucent;
+    unsigned int program;
+    unsigned int material;
+    unsigned int mesh;
+    // 0 nearest
+    unsigned int depth;
+};
+
+inline uint64_t packRenderKey(const RenderSortKey& key) {
+    uint64_t packed = (uint64_t)(key.pass & 15) << RENDER_KEY_PASS_SHIFT;
+    uint64_t program = key.program & 4095, material = key.material & 65535, mesh = key.mesh & 4095, depth = key.depth & 65535;
+
+    if(key.translucent) {
+        return packed | (uint64_t)1 << RENDER_KEY_TRANSLUCENT_SHIFT | (65535 - depth) << 43 | program << 31 | material << 15 | mesh << 3;
+    }
+
+    return packed | program << 47 | material << 31 | mesh << 19 | depth << 3;
+}
+
+inline RenderSortKey unpackRenderKey(uint64_t packed) {
+    RenderSortKey key;
+    key.pass = (unsigned int)(packed >> RENDER_KEY_PASS_SHIFT);
+    key.translucent = (packed >> RENDER_KEY_TRANSLUCENT_SHIFT) & 1;
+
+    if(key.translucent) {
+        key.depth = 65535 - (unsigned int)((packed >> 43) & 65535);
+        key.program = (unsigned int)((packed >> 31) & 4095);
+        key.material = (unsigned int)((packed >> 15) & 65535);
+        key.mesh = (unsigned int)((packed >> 3) & 4095);
+    }
+    else {
+        key.program = (unsigned int)((packed >> 47) & 4095);
+        key.material = (unsigned int)((packed >> 31) & 65535);
+        key.mesh = (unsigned int)((packed >> 19) & 4095);
+        key.depth = (unsigned int)((packed >> 3) & 65535);
+    }
+
+    return key;
+}
+
+struct RenderSortItem {
+    uint64_t key;
+    uint32_t payload;
+};
+
+// stable LSD radix sort on the keys; scratch is resized to match
+inline void radixSortRenderItems(std::vector<RenderSortItem>& items, std::vector<RenderSortItem>& scratch) {
+    size_t count = items.size();
+    scratch.resize(count);
+
+    if(count < 2) {
+        return;
+    }
+
+    // all eight histograms in one read of the keys
+    uint32_t histograms[8][256] = {};
+
+    for(const RenderSortItem& item : items) {
+        for(int digit = 0; digit < 8; ++digit) {
+            histograms[digit][(item.key >> (digit * 8)) & 255]++;
+        }
+    }
+
+    RenderSortItem* source = items.data();
+    RenderSortItem* target = scratch.data();
+
+    for(int digit = 0; digit < 8; ++digit) {
+        uint32_t* histogram = histograms[digit];
+        int shift = digit * 8;
+
+        // a byte every key shares doesn't reorder anything
+        if(histogram[(source[0].key >> shift) & 255] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+
+        for(int bucket = 0; bucket < 256; ++bucket) {
+            uint32_t size = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += size;
+        }
+
+        for(size_t i = 0; i < count; ++i) {
+            target[histogram[(source[i].key >> shift) & 255]++] = source[i];
+        }
+
+        std::swap(source, target);
+    }
+
+    if(source != items.data()) {
+        items.swap(scratch);
+    }
+}
+
+// a VAO and what to draw from it; indexType 0 draws arrays
+struct RenderMesh {
+    unsigned int vertexArray = 0;
+    GLenum mode = GL_TRIANGLES;
+    GLsizei count = 0;
+    GLenum indexType = 0;
+    // first vertex, or byte offset into the element buffer
+    size_t first = 0;
+};
+
+struct RenderMaterial {
+    GLenum target = GL_TEXTURE_2D;
+    unsigned int texture = 0;
+};
+
+struct RenderQueueStats {
+    unsigned int items = 0;
+    unsigned int programChanges = 0;
+    unsigned int materialChanges = 0;
+    unsigned int meshChanges = 0;
+    unsigned int passChanges = 0;
+    double sortMs = 0.0;
+    double submitMs = 0.0;
+};
+
+class RenderQueue {
+    public:
+    // view depth mapped onto the 16 bit buckets; further is clamped
+    float maxDepth = 1000.0f;
+    // the last submitted frame
+    RenderQueueStats stats;
+
+    // programs take their model matrix from the "model" uniform
+    unsigned int addProgram(Shader& shader) {
+        if(programs.size() >= (size_t)RENDER_MAX_PROGRAMS) {
+            std::cout << "ERROR::RENDER_QUEUE::TOO_MANY_PROGRAMS: " << RENDER_MAX_PROGRAMS << std::endl;
+            return 0;
+        }
+
+        programs.push_back(&shader);
+        modelLocations.push_back(shader.uniform("model"));
+
+        return (unsigned int)programs.size() - 1;
+    }
+
+    unsigned int addMaterial(unsigned int texture, GLenum target = GL_TEXTURE_2D) {
+        if(materials.size() >= (size_t)RENDER_MAX_MATERIALS) {
+            std::cout << "ERROR::RENDER_QUEUE::TOO_MANY_MATERIALS: " << RENDER_MAX_MATERIALS << std::endl;
+            return 0;
+        }
+
+        RenderMaterial material;
+        material.target = target;
+        material.texture = texture;
+        materials.push_back(material);
+
+        return (unsigned int)materials.size() - 1;
+    }
+
+    unsigned int addMesh(const RenderMesh& mesh) {
+        if(meshes.size() >= (size_t)RENDER_MAX_MESHES) {
+            std::cout << "ERROR::RENDER_QUEUE::TOO_MANY_MESHES: " << RENDER_MAX_MESHES << std::endl;
+            return 0;
+        }
+
+        meshes.push_back(mesh);
+
+        return (unsigned int)meshes.size() - 1;
+    }
+
+    // start collecting a new frame
+    void clear() {
+        items.clear();
+        transforms.clear();
+    }
+
+    // viewDepth is the distance along the view direction
+    void push(unsigned int pass, bool translucent, unsigned int program, unsigned int material, unsigned int mesh, const glm::mat4& model, float viewDepth) {
+        float normalized = std::min(std::max(viewDepth / maxDepth, 0.0f), 1.0f);
+
+        RenderSortKey key;
+        key.pass = pass;
+        key.translucent = translucent;
+        key.program = program;
+        key.material = material;
+        key.mesh = mesh;
+        key.depth = (unsigned int)(normalized * (RENDER_DEPTH_BUCKETS - 1));
+
+        RenderSortItem item = {packRenderKey(key), (uint32_t)transforms.size()};
+
+        transforms.push_back(model);
+        items.push_back(item);
+    }
+
+    void sort() {
+        auto start = std::chrono::steady_clock::now();
+        radixSortRenderItems(items, scratch);
+        stats.sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // sorts and draws everything; translucent items are blended with depth writes off
+    void submit(GLState& state) {
+        sort();
+
+        auto start = std::chrono::steady_clock::now();
+
+        stats.items = (unsigned int)items.size();
+        stats.programChanges = stats.materialChanges = stats.meshChanges = stats.passChanges = 0;
+
+        // impossible values, so the first item sets everything
+        uint64_t previousPass = ~(uint64_t)0;
+        unsigned int program = ~0u, material = ~0u, vertexArray = ~0u;
+
+        for(const RenderSortItem& item : items) {
+            RenderSortKey key = unpackRenderKey(item.key);
+            const RenderMesh& mesh = meshes[key.mesh];
+
+            uint64_t pass = item.key >> RENDER_KEY_TRANSLUCENT_SHIFT;
+
+            if(pass != previousPass) {
+                setBlending(state, key.translucent);
+                previousPass = pass;
+                stats.passChanges++;
+            }
+
+            if(key.program != program) {
+                state.useProgram(*programs[key.program]);
+                program = key.program;
+                stats.programChanges++;
+            }
+
+            if(key.material != material) {
+                const RenderMaterial& info = materials[key.material];
+                state.bindTexture(0, info.target, info.texture);
+                material = key.material;
+                stats.materialChanges++;
+            }
+
+            if(mesh.vertexArray != vertexArray) {
+                state.bindVertexArray(mesh.vertexArray);
+                vertexArray = mesh.vertexArray;
+                stats.meshChanges++;
+            }
+
+            programs[program]->setMat4(modelLocations[program], transforms[item.payload]);
+
+            if(mesh.indexType) {
+                glDrawElements(mesh.mode, mesh.count, mesh.indexType, (void*)mesh.first);
+            }
+            else {
+                glDrawArrays(mesh.mode, (GLint)mesh.first, mesh.count);
+            }
+        }
+
+        // leave the defaults for whoever draws next
+        if(previousPass != ~(uint64_t)0) {
+            setBlending(state, false);
+        }
+
+        stats.submitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    size_t size() const {
+        return items.size();
+    }
+
+    private:
+    std::vector<Shader*> programs;
+    std::vector<GLint> modelLocations;
+    std::vector<RenderMaterial> materials;
+    std::vector<RenderMesh> meshes;
+
+    // per frame
+    std::vector<RenderSortItem> items, scratch;
+    std::vector<glm::mat4> transforms;
+
+    static void setBlending(GLState& state, bool translucent) {
+        state.setCapability(GL_BLEND, translucent);
+        glDepthMask(translucent ? GL_FALSE : GL_TRUE);
+
+        if(translucent) {
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+    }
+};
+
+inline void printRenderQueueStats(const RenderQueue& queue) {
+    const RenderQueueStats& stats = queue.stats;
+
+    std::cout << "RENDER::QUEUE: " << stats.items << " item(s), " << stats.programChanges << " program, " << stats.materialChanges << " material, "
+              << stats.meshChanges << " mesh and " << stats.passChanges << " pass change(s), sort " << stats.sortMs << " ms, submit " << stats.submitMs << " ms" << std::endl;
+}
+
+#endif
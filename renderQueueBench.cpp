@@ -0,0 +1,225 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shaderLibrary.h"
+#include "cameraBuffer.h"
+#include "cubeMesh.h"
+#include "glState.h"
+#include "renderQueue.h"
+#include "benchFrames.h"
+
+// A scene of cubes spread over many programs, textures and VAOs in no particular
+// order, drawn in that order (through a GLState, so only actual changes are issued)
+// against a RenderQueue that sorts them by key first. A tenth of the cubes are
+// translucent and drawn blended, after the opaque ones and back to front.
+
+const int PROGRAM_COUNT = 8;
+const int TEXTURE_COUNT = 64;
+const int TRANSLUCENT_TEXTURE_COUNT = 8;
+const int VAO_COUNT = 4;
+const glm::vec3 EYE(0.0f, 0.0f, 120.0f);
+
+struct Object {
+    unsigned int program;
+    unsigned int material;
+    unsigned int mesh;
+    bool translucent;
+    glm::mat4 model;
+    float viewDepth;
+};
+
+struct Scene {
+    std::vector<Shader*> programs;
+    std::vector<GLint> modelLocations;
+    std::vector<unsigned int> textures;
+    std::vector<unsigned int> vertexArrays;
+    std::vector<Object> objects;
+    GLState* state;
+    RenderQueue* queue;
+};
+
+void drawSceneOrder(Scene& scene) {
+    GLState& state = *scene.state;
+    state.beginFrame();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    for(const Object& object : scene.objects) {
+        state.setCapability(GL_BLEND, object.translucent);
+        state.useProgram(*scene.programs[object.program]);
+        state.bindTexture(0, GL_TEXTURE_2D, scene.textures[object.material]);
+        state.bindVertexArray(scene.vertexArrays[object.mesh]);
+        scene.programs[object.program]->setMat4(scene.modelLocations[object.program], object.model);
+        glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+    }
+
+    state.setCapability(GL_BLEND, false);
+    state.endFrame();
+}
+
+void drawQueued(Scene& scene) {
+    GLState& state = *scene.state;
+    RenderQueue& queue = *scene.queue;
+    state.beginFrame();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    queue.clear();
+
+    for(const Object& object : scene.objects) {
+        queue.push(0, object.translucent, object.program, object.material, object.mesh, object.model, object.viewDepth);
+    }
+
+    queue.submit(state);
+    state.endFrame();
+}
+
+std::vector<Object> makeObjects(size_t count) {
+    std::vector<Object> objects(count);
+
+    for(Object& object : objects) {
+        glm::vec3 position((rand() % 2000) / 10.0f - 100.0f, (rand() % 2000) / 10.0f - 100.0f, (rand() % 2000) / 10.0f - 100.0f);
+
+        object.translucent = rand() % 10 == 0;
+        object.program = rand() % PROGRAM_COUNT;
+        object.material = object.translucent ? TEXTURE_COUNT + rand() % TRANSLUCENT_TEXTURE_COUNT : rand() % TEXTURE_COUNT;
+        object.mesh = rand() % VAO_COUNT;
+        object.model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.5f));
+        object.viewDepth = EYE.z - position.z;
+    }
+
+    return objects;
+}
+
+int main() {
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(600, 600, "Render queue benchmark", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    // don't let vsync cap the measurement
+    glfwSwapInterval(0);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    Scene scene;
+    RenderQueue queue;
+    ShaderLibrary shaders;
+
+    // the define only makes the permutations separate programs
+    for(int i = 0; i < PROGRAM_COUNT; ++i) {
+        scene.programs.push_back(&shaders.variant("vertexShader.glsl", "fragmentShader.glsl", {{"BENCH_PROGRAM", std::to_string(i)}}));
+    }
+
+    shaders.finishAll();
+
+    for(Shader* program : scene.programs) {
+        scene.modelLocations.push_back(program->uniform("model"));
+        queue.addProgram(*program);
+    }
+
+    // opaque textures, then half transparent ones for the translucent cubes
+    scene.textures.resize(TEXTURE_COUNT + TRANSLUCENT_TEXTURE_COUNT);
+    glGenTextures((GLsizei)scene.textures.size(), scene.textures.data());
+
+    for(size_t i = 0; i < scene.textures.size(); ++i) {
+        bool translucent = i >= (size_t)TEXTURE_COUNT;
+        unsigned char texel[4] = {(unsigned char)(i * 4), (unsigned char)(255 - i * 4), 128, (unsigned char)(translucent ? 128 : 255)};
+
+        glBindTexture(GL_TEXTURE_2D, scene.textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+        queue.addMaterial(scene.textures[i]);
+    }
+
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+    scene.vertexArrays.resize(VAO_COUNT);
+    glGenVertexArrays(VAO_COUNT, scene.vertexArrays.data());
+
+    for(unsigned int VAO : scene.vertexArrays) {
+        glBindVertexArray(VAO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE, nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, CUBE_VERTEX_STRIDE, (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        RenderMesh mesh;
+        mesh.vertexArray = VAO;
+        mesh.count = CUBE_VERTEX_COUNT;
+        queue.addMesh(mesh);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    CameraBuffer camera;
+    camera.create();
+    camera.update(glm::lookAt(EYE, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 500.0f));
+
+    glEnable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    queue.maxDepth = 500.0f;
+
+    GLState state;
+    scene.state = &state;
+    scene.queue = &queue;
+
+    const size_t counts[] = {1000, 10000, 50000};
+
+    std::cout << glGetString(GL_RENDERER) << std::endl;
+    std::cout << "objects    scene order ms   state calls   queued ms   state calls   speedup   sort ms" << std::endl;
+
+    for(size_t count : counts) {
+        srand(1234);
+        scene.objects = makeObjects(count);
+
+        double sceneOrderMs = timeFrames(window, drawSceneOrder, scene);
+        unsigned int sceneOrderCalls = state.stats.lastFrame.totalIssued();
+
+        double queuedMs = timeFrames(window, drawQueued, scene);
+        unsigned int queuedCalls = state.stats.lastFrame.totalIssued();
+
+        printf("%-10zu %-16.3f %-13u %-11.3f %-13u %-9.2f %.3f\n", count, sceneOrderMs, sceneOrderCalls, queuedMs, queuedCalls, sceneOrderMs / queuedMs, queue.stats.sortMs);
+    }
+
+    printRenderQueueStats(queue);
+
+    camera.destroy();
+    glDeleteTextures((GLsizei)scene.textures.size(), scene.textures.data());
+    glDeleteVertexArrays(VAO_COUNT, scene.vertexArrays.data());
+    glDeleteBuffers(1, &VBO);
+
+    for(Shader* program : scene.programs) {
+        glDeleteProgram(program->shaderProgram);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
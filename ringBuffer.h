@@ -0,0 +1,192 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <vector>
+#include <cstddef>
+#include <iostream>
+
+// Streaming buffer for data rewritten every frame (instance matrices, dynamic
+// vertices). The storage is split into RING_REGIONS regions used round robin:
+//
+//  - with GL 4.4 / ARB_buffer_storage the buffer is allocated once with
+//    glBufferStorage and stays mapped (persistent + coherent). allocate() hands out
+//    pointers straight into GPU-visible memory and a fence per region makes sure the
+//    GPU is done reading a region before the CPU writes it again three frames later.
+//  - otherwise allocations go to a CPU staging copy that flush() uploads with
+//    glBufferSubData after the store was orphaned in beginFrame().
+//
+// Per frame: beginFrame(), allocate()/write, flush(), draw using the returned
+// offsets, endFrame().
+
+const int RING_REGIONS = 3;
+
+struct RingAllocation {
+    void* pointer = nullptr;
+    // byte offset into the GL buffer, for glVertexAttribPointer / glDrawElements etc.
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+class StreamRingBuffer {
+    public:
+    unsigned int buffer = 0;
+    GLenum target = GL_ARRAY_BUFFER;
+    size_t regionSize = 0;
+    bool persistent = false;
+
+    // frames the CPU had to wait for the GPU to release a region, and bytes handed out
+    unsigned int stalls = 0;
+    size_t bytesAllocated = 0;
+
+    void create(GLenum bufferTarget, size_t bytesPerFrame) {
+        target = bufferTarget;
+        regionSize = bytesPerFrame;
+        persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+
+        if(persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            glBufferStorage(target, regionSize * RING_REGIONS, NULL, flags);
+            mapped = (char*)glMapBufferRange(target, 0, regionSize * RING_REGIONS, flags);
+
+            if(!mapped) {
+                std::cout << "ERROR::RING_BUFFER::MAP_FAILED, falling back to glBufferSubData" << std::endl;
+                persistent = false;
+
+                // immutable storage can't be respecified, so start over with a mutable buffer
+                glBindBuffer(target, 0);
+                glDeleteBuffers(1, &buffer);
+                glGenBuffers(1, &buffer);
+                glBindBuffer(target, buffer);
+            }
+        }
+
+        if(!persistent) {
+            glBufferData(target, regionSize, NULL, GL_STREAM_DRAW);
+            staging.resize(regionSize);
+        }
+
+        glBindBuffer(target, 0);
+
+        region = RING_REGIONS - 1;
+        head = 0;
+        flushed = 0;
+    }
+
+    // move to the next region, waiting only if the GPU is still reading it
+    void beginFrame() {
+        if(persistent) {
+            region = (region + 1) % RING_REGIONS;
+
+            if(fences[region]) {
+                GLenum result = glClientWaitSync(fences[region], 0, 0);
+
+                if(result == GL_TIMEOUT_EXPIRED) {
+                    stalls++;
+
+                    // flush so the fence is guaranteed to signal, then wait for real
+                    while((result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000)) == GL_TIMEOUT_EXPIRED) {
+                    }
+                }
+
+                glDeleteSync(fences[region]);
+                fences[region] = 0;
+            }
+        }
+        else {
+            // orphan: the driver gives us fresh storage while last frame's keeps drawing
+            glBindBuffer(target, buffer);
+            glBufferData(target, regionSize, NULL, GL_STREAM_DRAW);
+            glBindBuffer(target, 0);
+        }
+
+        head = 0;
+        flushed = 0;
+    }
+
+    // space for this frame's data; pointer is null when the region is exhausted
+    RingAllocation allocate(size_t size, size_t alignment = 16) {
+        RingAllocation allocation;
+        size_t start = (head + alignment - 1) / alignment * alignment;
+
+        if(start + size > regionSize) {
+            std::cout << "ERROR::RING_BUFFER::OUT_OF_SPACE: " << size << " bytes requested, " << regionSize - head << " left this frame" << std::endl;
+            return allocation;
+        }
+
+        head = start + size;
+        bytesAllocated += size;
+
+        allocation.size = size;
+
+        if(persistent) {
+            allocation.offset = region * regionSize + start;
+            allocation.pointer = mapped + allocation.offset;
+        }
+        else {
+            allocation.offset = start;
+            allocation.pointer = staging.data() + start;
+        }
+
+        return allocation;
+    }
+
+    // make everything allocated so far visible to GL; coherent mappings need nothing
+    void flush() {
+        if(persistent || head == flushed) {
+            return;
+        }
+
+        glBindBuffer(target, buffer);
+        glBufferSubData(target, flushed, head - flushed, staging.data() + flushed);
+        glBindBuffer(target, 0);
+
+        flushed = head;
+    }
+
+    // call after the last draw that reads this frame's region
+    void endFrame() {
+        if(!persistent) {
+            return;
+        }
+
+        if(fences[region]) {
+            glDeleteSync(fences[region]);
+        }
+
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void destroy() {
+        for(GLsync& fence : fences) {
+            if(fence) {
+                glDeleteSync(fence);
+                fence = 0;
+            }
+        }
+
+        if(persistent && mapped) {
+            glBindBuffer(target, buffer);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+        }
+
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        mapped = nullptr;
+        staging.clear();
+    }
+
+    private:
+    char* mapped = nullptr;
+    std::vector<char> staging;
+    GLsync fences[RING_REGIONS] = {};
+    int region = 0;
+    size_t head = 0;
+    size_t flushed = 0;
+};
+
+#endif
@@ -3,8 +3,75 @@
 
 #include <string>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <cstring>
+#include <utility>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "programCache.h"
+#include "shaderFile.h"
+#include "shaderPreprocessor.h"
+
+// FNV-1a hash of a uniform name. constexpr so handles for literal names can be
+// computed at compile time and the per-frame path never hashes a string.
+constexpr unsigned int hashUniformName(const char* name) {
+    unsigned int hash = 2166136261u;
+
+    while(*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// Fixed binding points for uniform blocks shared by every program. Any program that
+// declares one of these blocks gets it bound at link time, so a single buffer bound
+// to the binding point feeds all of them.
+enum UniformBlockBinding {
+    CAMERA_BLOCK_BINDING = 0,
+    MATERIAL_BLOCK_BINDING = 1
+};
+
+inline GLint uniformBlockBinding(const char* blockName) {
+    if(strcmp(blockName, "Camera") == 0) {
+        return CAMERA_BLOCK_BINDING;
+    }
+
+    if(strcmp(blockName, "Materials") == 0) {
+        return MATERIAL_BLOCK_BINDING;
+    }
+
+    return -1;
+}
+
+// the same for shader storage blocks, where the driver has them
+enum StorageBlockBinding {
+    MATERIAL_HANDLE_BINDING = 0
+};
+
+inline GLint storageBlockBinding(const char* blockName) {
+    if(strcmp(blockName, "MaterialHandles") == 0) {
+        return MATERIAL_HANDLE_BINDING;
+    }
+
+    return -1;
+}
+
+inline bool storageBlocksAvailable() {
+    return GLEW_VERSION_4_3 || (GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_program_interface_query);
+}
+
+inline bool parallelShaderCompileAvailable() {
+    return GLEW_KHR_parallel_shader_compile;
+}
+
+struct UniformInfo {
+    std::string name;
+    GLint location;
+    GLenum type;
+    GLint size;
+};
 
 class Shader {
     public:
@@ -12,70 +79,434 @@ class Shader {
     const char* fragmentShaderSource;
     unsigned int vertexShader, fragmentShader, shaderProgram;
 
-    Shader(const char* vertexShaderPath, const char* fragmentShaderPath) {
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::string vertexString;
-        std::string fragmentString;
+    // active uniforms, reflected once after linking and keyed by hashUniformName()
+    std::unordered_map<unsigned int, UniformInfo> uniforms;
 
-        try {
-            // open files
-            vShaderFile.open(vertexShaderPath);
-            fShaderFile.open(fragmentShaderPath);
+    // glGetUniformLocation calls made (only during reflection) and by-name lookups
+    // into the uniform table; both should stay flat across frames in steady state
+    unsigned int uniformLocationQueries = 0;
+    unsigned int uniformNameLookups = 0;
 
-            std::stringstream vShaderStream;
-            std::stringstream fShaderStream;
+    // bumped every time a hot reload swaps a new program in
+    unsigned int generation = 0;
 
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
+    // source files as loaded, and the preprocessed text compiled from them; the
+    // *ShaderSource pointers above point into vertexCode/fragmentCode
+    ShaderFile vertexFile;
+    ShaderFile fragmentFile;
+    std::string vertexCode;
+    std::string fragmentCode;
 
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
+    // defines injected into both stages, and the files each stage was expanded from
+    ShaderDefines defines;
+    ShaderSourceInfo vertexInfo;
+    ShaderSourceInfo fragmentInfo;
 
-            // convert stream into string
-            vertexString  = vShaderStream.str();
-            fragmentString = fShaderStream.str();
+    // a deferred Shader only submits its compile and link; see finishBuild()
+    Shader(const char* vertexShaderPath, const char* fragmentShaderPath, bool deferred = false, const ShaderDefines& shaderDefines = {})
+        : Shader(loadShaderFile(vertexShaderPath), loadShaderFile(fragmentShaderPath), deferred, shaderDefines) {
+    }
+
+    // build from sources that were already loaded, e.g. with loadShaderFiles()
+    Shader(ShaderFile vertex, ShaderFile fragment, bool deferred = false, const ShaderDefines& shaderDefines = {})
+        : vertexFile(std::move(vertex)), fragmentFile(std::move(fragment)), defines(shaderDefines) {
+        preprocess(vertexFile, fragmentFile);
+
+        beginBuild();
+
+        if(!deferred) {
+            finishBuild();
+        }
+    }
+
+    // the source pointers and GL program are owned, so a Shader is never copied
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    // binds the program; a deferred build is completed (status, logs, reflection) on first use
+    void use() {
+        if(pending) {
+            finishBuild();
         }
-        catch(std::ifstream::failure& e) {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+
+        glUseProgram(shaderProgram);
+    }
+
+    // true once the driver has finished compiling and linking, without blocking on it
+    bool isReady() const {
+        return !pending || programCompleted(shaderProgram);
+    }
+
+    // query compile/link status, store the binary and reflect uniforms
+    void finishBuild() {
+        if(!pending) {
+            return;
         }
 
-        vertexShaderSource = vertexString.c_str();
-        fragmentShaderSource = fragmentString.c_str();
+        pending = false;
 
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-        glCompileShader(vertexShader);
-        checkCompileErrors(vertexShader, "VERTEX");
+        if(vertexShader || fragmentShader) {
+            // the status queries wait for whatever compiling and linking is left
+            auto start = std::chrono::steady_clock::now();
 
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-        glCompileShader(fragmentShader);
-        checkCompileErrors(fragmentShader, "FRAGMENT");
+            checkCompileErrors(vertexShader, "VERTEX");
+            checkCompileErrors(fragmentShader, "FRAGMENT");
+            checkCompileErrors(shaderProgram, "PROGRAM");
 
-        shaderProgram = glCreateProgram();
-        glAttachShader(shaderProgram, vertexShader);
-        glAttachShader(shaderProgram, fragmentShader);
-        glLinkProgram(shaderProgram);
-        checkCompileErrors(shaderProgram, "PROGRAM");
+            buildMs += elapsedMs(start);
+
+            glDeleteShader(vertexShader);
+            glDeleteShader(fragmentShader);
+            vertexShader = 0;
+            fragmentShader = 0;
 
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+            storeProgramBinary(shaderProgram, cacheKey, buildMs);
+        }
+
+        reflectUniforms();
     }
 
-    void use() const {
-        glUseProgram(shaderProgram);
+    // Hot reload. beginReload() rereads the sources and submits a new program next to
+    // the current one, which stays bound and in use meanwhile. finishReload() swaps it
+    // in only if it linked; a broken edit just logs and keeps the old program.
+    // reloadReady() only polls with GL_KHR_parallel_shader_compile; without it
+    // finishReload() blocks on the compile and link (see programCompleted()).
+    bool isReloading() const {
+        return reloadProgram != 0;
+    }
+
+    bool reloadReady() const {
+        return reloadProgram == 0 || programCompleted(reloadProgram);
+    }
+
+    void beginReload() {
+        if(pending) {
+            finishBuild();
+        }
+
+        discardReload();
+
+        ShaderFile vertex = loadShaderFile(vertexFile.path);
+        ShaderFile fragment = loadShaderFile(fragmentFile.path);
+
+        if(!vertex.loaded || !fragment.loaded) {
+            return;
+        }
+
+        reloadVertexCode = preprocessShader(vertex, defines, reloadVertexInfo);
+        reloadFragmentCode = preprocessShader(fragment, defines, reloadFragmentInfo);
+        reloadVertexFile = std::move(vertex);
+        reloadFragmentFile = std::move(fragment);
+
+        auto start = std::chrono::steady_clock::now();
+
+        reloadProgram = glCreateProgram();
+        submitProgram(reloadProgram, reloadVertexCode.c_str(), reloadFragmentCode.c_str(), reloadVertexShader, reloadFragmentShader);
+
+        reloadBuildMs = elapsedMs(start);
+    }
+
+    // returns true when shaderProgram was replaced; uniform locations must be fetched again
+    bool finishReload() {
+        if(reloadProgram == 0) {
+            return false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        bool success = checkCompileErrors(reloadVertexShader, "VERTEX");
+        success = checkCompileErrors(reloadFragmentShader, "FRAGMENT") && success;
+        success = success && checkCompileErrors(reloadProgram, "PROGRAM");
+
+        reloadBuildMs += elapsedMs(start);
+
+        if(!success) {
+            std::cout << "SHADER::RELOAD::FAILED " << vertexFile.path << " + " << fragmentFile.path << ", keeping previous program" << std::endl;
+            discardReload();
+            return false;
+        }
+
+        glDeleteShader(reloadVertexShader);
+        glDeleteShader(reloadFragmentShader);
+        reloadVertexShader = 0;
+        reloadFragmentShader = 0;
+
+        // the old program may still be bound; deleting it is deferred by GL until it isn't
+        GLint current = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+
+        GLuint previous = shaderProgram;
+        shaderProgram = reloadProgram;
+        reloadProgram = 0;
+
+        if((GLuint)current == previous) {
+            glUseProgram(shaderProgram);
+        }
+
+        glDeleteProgram(previous);
+
+        vertexFile = std::move(reloadVertexFile);
+        fragmentFile = std::move(reloadFragmentFile);
+        vertexCode = std::move(reloadVertexCode);
+        fragmentCode = std::move(reloadFragmentCode);
+        vertexInfo = std::move(reloadVertexInfo);
+        fragmentInfo = std::move(reloadFragmentInfo);
+        vertexShaderSource = vertexCode.c_str();
+        fragmentShaderSource = fragmentCode.c_str();
+
+        cacheKey = programCacheKey(vertexCode, fragmentCode, shaderDefineBlock(defines));
+        storeProgramBinary(shaderProgram, cacheKey, reloadBuildMs);
+
+        reflectUniforms();
+        ++generation;
+
+        std::cout << "SHADER::RELOAD::OK " << vertexFile.path << " + " << fragmentFile.path << std::endl;
+
+        return true;
+    }
+
+    // every file this program was built from, #includes included
+    std::vector<std::string> dependencies() const {
+        std::vector<std::string> files = vertexInfo.files;
+
+        for(const std::string& file : fragmentInfo.files) {
+            if(std::find(files.begin(), files.end(), file) == files.end()) {
+                files.push_back(file);
+            }
+        }
+
+        return files;
+    }
+
+    // resolve a uniform name to its location through the reflected table; fetch these
+    // once outside the render loop and pass the location to the setters below
+    GLint uniform(const char* name) {
+        if(pending) {
+            finishBuild();
+        }
+
+        ++uniformNameLookups;
+
+        auto it = uniforms.find(hashUniformName(name));
+
+        return it == uniforms.end() ? -1 : it->second.location;
+    }
+
+    void setMat4(GLint location, const glm::mat4& value) const {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+
+    void setVec3(GLint location, const glm::vec3& value) const {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+
+    void setFloat(GLint location, float value) const {
+        glUniform1f(location, value);
+    }
+
+    void setInt(GLint location, int value) const {
+        glUniform1i(location, value);
+    }
+
+    void setMat4(const char* name, const glm::mat4& value) {
+        setMat4(uniform(name), value);
+    }
+
+    void setVec3(const char* name, const glm::vec3& value) {
+        setVec3(uniform(name), value);
+    }
+
+    void setFloat(const char* name, float value) {
+        setFloat(uniform(name), value);
+    }
+
+    void setInt(const char* name, int value) {
+        setInt(uniform(name), value);
     }
 
     private:
+    uint64_t cacheKey = 0;
+    bool pending = false;
+
+    // Time spent submitting the compile and link plus waiting on their status, which is
+    // what the binary cache saves. It leaves out whatever the caller did between
+    // beginBuild() and finishBuild(), and work a parallel compiling driver finished
+    // in the background meanwhile.
+    double buildMs = 0.0;
+
+    // a cache hit links immediately; otherwise submit compile and link without
+    // reading any status back, so the driver can work on it in the background
+    void beginBuild() {
+        vertexShader = 0;
+        fragmentShader = 0;
+        pending = true;
+
+        shaderProgram = glCreateProgram();
+
+        if(loadProgramBinary(shaderProgram, cacheKey)) {
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        submitProgram(shaderProgram, vertexShaderSource, fragmentShaderSource, vertexShader, fragmentShader);
+
+        buildMs = elapsedMs(start);
+    }
+
+    ShaderFile reloadVertexFile;
+    ShaderFile reloadFragmentFile;
+    std::string reloadVertexCode;
+    std::string reloadFragmentCode;
+    ShaderSourceInfo reloadVertexInfo;
+    ShaderSourceInfo reloadFragmentInfo;
+    GLuint reloadProgram = 0;
+    GLuint reloadVertexShader = 0;
+    GLuint reloadFragmentShader = 0;
+    // like buildMs
+    double reloadBuildMs = 0.0;
+
+    void discardReload() {
+        if(reloadProgram == 0) {
+            return;
+        }
+
+        glDeleteShader(reloadVertexShader);
+        glDeleteShader(reloadFragmentShader);
+        glDeleteProgram(reloadProgram);
+        reloadProgram = 0;
+        reloadVertexShader = 0;
+        reloadFragmentShader = 0;
+    }
+
+    void preprocess(const ShaderFile& vertex, const ShaderFile& fragment) {
+        vertexCode = preprocessShader(vertex, defines, vertexInfo);
+        fragmentCode = preprocessShader(fragment, defines, fragmentInfo);
+        vertexShaderSource = vertexCode.c_str();
+        fragmentShaderSource = fragmentCode.c_str();
+
+        cacheKey = programCacheKey(vertexCode, fragmentCode, shaderDefineBlock(defines));
+    }
+
+    // compile and link without reading back any status
+    static void submitProgram(GLuint program, const char* vertexSource, const char* fragmentSource, GLuint& vertex, GLuint& fragment) {
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vertexSource, NULL);
+        glCompileShader(vertex);
+
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fragmentSource, NULL);
+        glCompileShader(fragment);
+
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        hintProgramBinaryRetrievable(program);
+        glLinkProgram(program);
+    }
+
+    // Only GL_KHR_parallel_shader_compile can answer this without blocking. Without it
+    // this reports done at once, and the status queries in finishBuild() or
+    // finishReload() then block until the driver has compiled and linked.
+    static bool programCompleted(GLuint program) {
+        if(!parallelShaderCompileAvailable()) {
+            return true;
+        }
+
+        GLint done = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+
+        return done == GL_TRUE;
+    }
+
+    // enumerate GL_ACTIVE_UNIFORMS and cache their locations so nothing after
+    // this point has to go through glGetUniformLocation
+    void reflectUniforms() {
+        uniforms.clear();
+
+        GLint count = 0;
+        glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &count);
+
+        GLchar name[256];
+
+        for(GLint i = 0; i < count; ++i) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(shaderProgram, (GLuint)i, sizeof(name), &length, &size, &type, name);
+
+            // uniforms inside blocks report no location and are set through their buffer
+            GLint location = glGetUniformLocation(shaderProgram, name);
+            ++uniformLocationQueries;
+
+            if(location < 0) {
+                continue;
+            }
+
+            std::string uniformName(name, length);
+
+            // arrays are reported as "name[0]"; register the bare name as well
+            if(uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+                addUniform(uniformName.substr(0, uniformName.size() - 3), location, type, size);
+            }
+
+            addUniform(uniformName, location, type, size);
+        }
+
+        // block bindings are program state too, so they're set up with the reflection
+        bindUniformBlocks();
+    }
+
+    void bindUniformBlocks() {
+        GLint count = 0;
+        glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+
+        GLchar name[256];
+
+        for(GLint i = 0; i < count; ++i) {
+            glGetActiveUniformBlockName(shaderProgram, (GLuint)i, sizeof(name), NULL, name);
+
+            GLint binding = uniformBlockBinding(name);
+
+            if(binding >= 0) {
+                glUniformBlockBinding(shaderProgram, (GLuint)i, (GLuint)binding);
+            }
+        }
+
+        if(!storageBlocksAvailable()) {
+            return;
+        }
+
+        glGetProgramInterfaceiv(shaderProgram, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &count);
+
+        for(GLint i = 0; i < count; ++i) {
+            glGetProgramResourceName(shaderProgram, GL_SHADER_STORAGE_BLOCK, (GLuint)i, sizeof(name), NULL, name);
+
+            GLint binding = storageBlockBinding(name);
+
+            if(binding >= 0) {
+                glShaderStorageBlockBinding(shaderProgram, (GLuint)i, (GLuint)binding);
+            }
+        }
+    }
+
+    void addUniform(const std::string& name, GLint location, GLenum type, GLint size) {
+        unsigned int hash = hashUniformName(name.c_str());
+        auto it = uniforms.find(hash);
+
+        if(it != uniforms.end() && it->second.name != name) {
+            std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION: " << name << " / " << it->second.name << std::endl;
+            return;
+        }
+
+        uniforms[hash] = UniformInfo{name, location, type, size};
+    }
+
     // utility function for checking shader compilation/linking errors.
-    void checkCompileErrors(GLuint shader, const char* type) {
+    bool checkCompileErrors(GLuint shader, const char* type) {
         GLint success;
         GLchar infoLog[1024];
 
-        if (type != "PROGRAM") {
+        if (strcmp(type, "PROGRAM") != 0) {
             glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
             if (!success) {
                 glGetShaderInfoLog(shader, 1024, NULL, infoLog);
@@ -89,6 +520,8 @@ class Shader {
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+
+        return success;
     }
 };
 
@@ -0,0 +1,95 @@
+#ifndef SHADER_FILE_H
+#define SHADER_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+
+// Shader source loaded with a single fread into a buffer sized up front, so the
+// text is copied once from the OS and then owned by whoever holds the ShaderFile.
+
+struct ShaderFile {
+    std::string path;
+    std::string source;
+    double loadMs = 0.0;
+    bool loaded = false;
+};
+
+struct ShaderLoadStats {
+    unsigned int files = 0;
+    size_t bytes = 0;
+    double loadMs = 0.0;
+};
+
+inline ShaderLoadStats shaderLoadStats;
+
+inline bool readShaderFile(ShaderFile& file) {
+    auto start = std::chrono::steady_clock::now();
+
+    file.loaded = false;
+    file.source.clear();
+
+    // binary mode so the byte count from ftell matches what fread returns on Windows
+    FILE* handle = fopen(file.path.c_str(), "rb");
+
+    if(!handle) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << file.path << std::endl;
+        return false;
+    }
+
+    fseek(handle, 0, SEEK_END);
+    long size = ftell(handle);
+    fseek(handle, 0, SEEK_SET);
+
+    if(size > 0) {
+        file.source.resize((size_t)size);
+        file.loaded = fread(&file.source[0], 1, (size_t)size, handle) == (size_t)size;
+    }
+    else {
+        file.loaded = size == 0;
+    }
+
+    fclose(handle);
+
+    if(!file.loaded) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << file.path << std::endl;
+        file.source.clear();
+    }
+
+    file.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    shaderLoadStats.files++;
+    shaderLoadStats.bytes += file.source.size();
+    shaderLoadStats.loadMs += file.loadMs;
+
+    return file.loaded;
+}
+
+inline ShaderFile loadShaderFile(const std::string& path) {
+    ShaderFile file;
+    file.path = path;
+    readShaderFile(file);
+
+    return file;
+}
+
+// load a whole set of shader files in one pass
+inline std::vector<ShaderFile> loadShaderFiles(const std::vector<std::string>& paths) {
+    std::vector<ShaderFile> files(paths.size());
+
+    for(size_t i = 0; i < paths.size(); ++i) {
+        files[i].path = paths[i];
+        readShaderFile(files[i]);
+    }
+
+    return files;
+}
+
+inline void printShaderLoadStats() {
+    std::cout << "SHADER::LOAD: " << shaderLoadStats.files << " file(s), " << shaderLoadStats.bytes << " bytes in "
+              << shaderLoadStats.loadMs << " ms" << std::endl;
+}
+
+#endif
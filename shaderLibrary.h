@@ -0,0 +1,152 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+#include "shader.h"
+
+// Owns a set of named Shader programs and builds them together. Every compile and
+// link is submitted up front; with GL_KHR_parallel_shader_compile the driver works
+// on them concurrently and status/logs are only read back when a program is first
+// used, so loading N programs costs roughly the slowest one instead of the sum.
+// Without the extension each program is built synchronously as it is added.
+class ShaderLibrary {
+    public:
+    std::unordered_map<std::string, std::unique_ptr<Shader>> programs;
+
+    // variant() requests served from an already built permutation vs. ones that compiled
+    unsigned int permutationHits = 0;
+    unsigned int permutationMisses = 0;
+
+    ShaderLibrary() {
+        parallel = parallelShaderCompileAvailable();
+
+        if(parallel) {
+            // let the driver pick as many compiler threads as it likes
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+    }
+
+    // Submit a program for building; returns immediately when the driver compiles in
+    // parallel. Names are unique: adding one again logs and returns the first program,
+    // since callers and ShaderWatcher may already hold a reference to it.
+    Shader& add(const std::string& name, const char* vertexShaderPath, const char* fragmentShaderPath) {
+        if(Shader* shader = duplicate(name)) {
+            return *shader;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::unique_ptr<Shader>& shader = programs[name];
+        shader = std::make_unique<Shader>(vertexShaderPath, fragmentShaderPath, parallel);
+
+        submitMs += elapsedMs(start);
+
+        return *shader;
+    }
+
+    // same as above for sources already loaded, e.g. in one loadShaderFiles() batch
+    Shader& add(const std::string& name, ShaderFile vertex, ShaderFile fragment, const ShaderDefines& defines = {}) {
+        if(Shader* shader = duplicate(name)) {
+            return *shader;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::unique_ptr<Shader>& shader = programs[name];
+        shader = std::make_unique<Shader>(std::move(vertex), std::move(fragment), parallel, defines);
+
+        submitMs += elapsedMs(start);
+
+        return *shader;
+    }
+
+    // A permutation of an uber-shader pair. Each distinct define set is built once, the
+    // first time it's requested, from source files that are only read from disk once.
+    Shader& variant(const char* vertexShaderPath, const char* fragmentShaderPath, const ShaderDefines& defines = {}) {
+        std::string key = std::string(vertexShaderPath) + "|" + fragmentShaderPath + "|" + shaderDefineBlock(defines);
+        auto it = programs.find(key);
+
+        if(it != programs.end()) {
+            permutationHits++;
+            return *it->second;
+        }
+
+        permutationMisses++;
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::unique_ptr<Shader>& shader = programs[key];
+        shader = std::make_unique<Shader>(source(vertexShaderPath), source(fragmentShaderPath), parallel, defines);
+
+        submitMs += elapsedMs(start);
+
+        return *shader;
+    }
+
+    // look up a program, finishing its build if this is the first time it's used
+    Shader& get(const std::string& name) {
+        Shader& shader = *programs.at(name);
+        shader.finishBuild();
+
+        return shader;
+    }
+
+    // true when every program has finished compiling, without blocking
+    bool ready() const {
+        for(const auto& program : programs) {
+            if(!program.second->isReady()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // block until everything is built and report how long the batch took
+    void finishAll() {
+        auto start = std::chrono::steady_clock::now();
+
+        for(auto& program : programs) {
+            program.second->finishBuild();
+        }
+
+        std::cout << "SHADER::LIBRARY: " << programs.size() << " program(s) " << (parallel ? "compiled in parallel" : "compiled synchronously")
+                  << ", " << submitMs << " ms submitting, " << elapsedMs(start) << " ms waiting, "
+                  << permutationHits << " permutation hit(s) / " << permutationMisses << " miss(es)" << std::endl;
+    }
+
+    private:
+    bool parallel = false;
+    double submitMs = 0.0;
+
+    Shader* duplicate(const std::string& name) {
+        auto it = programs.find(name);
+
+        if(it == programs.end()) {
+            return nullptr;
+        }
+
+        std::cout << "ERROR::SHADER::LIBRARY::DUPLICATE_NAME: " << name << ", keeping the program added first" << std::endl;
+
+        return it->second.get();
+    }
+
+    // raw source files shared by every permutation built from them
+    std::unordered_map<std::string, ShaderFile> sources;
+
+    const ShaderFile& source(const char* path) {
+        auto it = sources.find(path);
+
+        if(it == sources.end()) {
+            it = sources.emplace(path, loadShaderFile(path)).first;
+        }
+
+        return it->second;
+    }
+};
+
+#endif
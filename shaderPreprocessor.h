@@ -0,0 +1,151 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+#include "shaderFile.h"
+
+// Minimal GLSL preprocessing done before the source reaches the driver:
+//  - #include "file" is resolved relative to the including file, each file at most once
+//  - per-variant #defines are injected right after the #version line
+//  - #line directives keep driver error messages pointing at the right file and line;
+//    the file number in a log maps to ShaderSourceInfo::files
+
+// name/value pairs; a define with an empty value is emitted as "#define NAME"
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
+struct ShaderSourceInfo {
+    // every file the output was built from, in #line file-number order
+    std::vector<std::string> files;
+};
+
+// sorted "#define" block, also used as the permutation / cache key for a define set
+inline std::string shaderDefineBlock(ShaderDefines defines) {
+    std::sort(defines.begin(), defines.end());
+
+    std::string block;
+
+    for(const auto& define : defines) {
+        block += "#define " + define.first;
+
+        if(!define.second.empty()) {
+            block += " " + define.second;
+        }
+
+        block += "\n";
+    }
+
+    return block;
+}
+
+inline bool expandShaderIncludes(const std::string& source, const std::string& path, int firstLine, ShaderSourceInfo& info, std::vector<std::string>& stack, std::string& output) {
+    int fileNumber = (int)info.files.size();
+    info.files.push_back(path);
+    stack.push_back(path);
+
+    size_t lineStart = 0;
+    int lineNumber = firstLine;
+
+    while(lineStart < source.size()) {
+        size_t lineEnd = source.find('\n', lineStart);
+
+        if(lineEnd == std::string::npos) {
+            lineEnd = source.size();
+        }
+
+        std::string line = source.substr(lineStart, lineEnd - lineStart);
+        size_t first = line.find_first_not_of(" \t");
+
+        if(first != std::string::npos && line.compare(first, 8, "#include") == 0) {
+            size_t open = line.find('"', first + 8);
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+
+            if(close == std::string::npos) {
+                std::cout << "ERROR::SHADER::PREPROCESSOR: malformed #include at " << path << ":" << lineNumber << std::endl;
+                stack.pop_back();
+                return false;
+            }
+
+            std::filesystem::path includePath = std::filesystem::path(path).parent_path() / line.substr(open + 1, close - open - 1);
+            std::string includeName = includePath.lexically_normal().generic_string();
+
+            if(std::find(stack.begin(), stack.end(), includeName) != stack.end()) {
+                std::cout << "ERROR::SHADER::PREPROCESSOR: recursive #include of " << includeName << " at " << path << ":" << lineNumber << std::endl;
+                stack.pop_back();
+                return false;
+            }
+
+            // include-once: a file already pasted in is skipped
+            if(std::find(info.files.begin(), info.files.end(), includeName) == info.files.end()) {
+                ShaderFile include = loadShaderFile(includeName);
+
+                if(!include.loaded) {
+                    stack.pop_back();
+                    return false;
+                }
+
+                output += "#line 1 " + std::to_string(info.files.size()) + "\n";
+
+                if(!expandShaderIncludes(include.source, includeName, 1, info, stack, output)) {
+                    stack.pop_back();
+                    return false;
+                }
+
+                output += "\n#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileNumber) + "\n";
+            }
+            else {
+                output += "\n";
+            }
+        }
+        else {
+            output.append(line);
+            output += "\n";
+        }
+
+        lineStart = lineEnd + 1;
+        lineNumber++;
+    }
+
+    stack.pop_back();
+
+    return true;
+}
+
+// expand a loaded shader into the text handed to glShaderSource
+inline std::string preprocessShader(const ShaderFile& file, const ShaderDefines& defines, ShaderSourceInfo& info) {
+    info.files.clear();
+
+    const std::string& source = file.source;
+    std::string output;
+    output.reserve(source.size() + 256);
+
+    // #version must stay the first statement, so defines go right after it
+    size_t body = 0;
+    size_t version = source.find("#version");
+
+    if(version != std::string::npos && source.find_first_not_of(" \t\r\n", 0) == version) {
+        body = source.find('\n', version);
+        body = body == std::string::npos ? source.size() : body + 1;
+        output.append(source, 0, body);
+    }
+
+    int bodyLine = 1 + (int)std::count(source.begin(), source.begin() + body, '\n');
+
+    output += shaderDefineBlock(defines);
+    output += "#line " + std::to_string(bodyLine) + " 0\n";
+
+    std::vector<std::string> stack;
+    std::string path = std::filesystem::path(file.path).lexically_normal().generic_string();
+
+    if(!expandShaderIncludes(source.substr(body), path, bodyLine, info, stack, output)) {
+        std::cout << "ERROR::SHADER::PREPROCESSOR: failed to expand " << file.path << std::endl;
+    }
+
+    return output;
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <filesystem>
+#include <unordered_map>
+#include "shader.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+// Watches the source files (and #includes) of registered Shaders and hot reloads
+// them. Call update() once per frame: it never blocks on the file system, and only
+// blocks on the driver when GL_KHR_parallel_shader_compile is missing.
+//
+//  - file changes come from inotify on Linux and from polling modification times
+//    elsewhere; the containing directory is watched so editors that save through a
+//    rename are still picked up
+//  - a changed Shader waits until its files have been quiet for settleMs, then
+//    submits the new program with Shader::beginReload()
+//  - the swap happens on a later frame once the driver reports the link done, so the
+//    old program keeps drawing until the new one is known to be good
+//  - without GL_KHR_parallel_shader_compile the driver can't be asked whether the
+//    link is done, so the frame after the submit waits in finishReload() for the
+//    whole compile and link; that frame hitches, the ones before and after don't
+class ShaderWatcher {
+    public:
+    // how long a file must go without further writes before it's recompiled
+    double settleMs = 100.0;
+
+    // how often modification times are checked when inotify isn't available
+    double pollIntervalMs = 250.0;
+
+    ShaderWatcher() {
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+        if(inotifyFd < 0) {
+            std::cout << "ERROR::SHADER::WATCHER: inotify unavailable, falling back to polling" << std::endl;
+        }
+#endif
+        lastPoll = std::chrono::steady_clock::now();
+    }
+
+    ~ShaderWatcher() {
+#ifdef __linux__
+        if(inotifyFd >= 0) {
+            close(inotifyFd);
+        }
+#endif
+    }
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    void watch(Shader& shader) {
+        entries.push_back(Entry{&shader, false, false, {}});
+
+        watchDependencies(shader);
+    }
+
+    // returns true if any Shader swapped in a new program this frame
+    bool update() {
+        collectChanges();
+
+        bool swapped = false;
+        auto now = std::chrono::steady_clock::now();
+
+        for(Entry& entry : entries) {
+            Shader& shader = *entry.shader;
+
+            // submitted last frame or earlier; swap once the driver says it's done
+            // (or right away, blocking, when it can't say)
+            if(entry.submitted && shader.reloadReady()) {
+                entry.submitted = false;
+
+                if(shader.finishReload()) {
+                    // the edit may have added #includes
+                    watchDependencies(shader);
+                    swapped = true;
+                }
+            }
+
+            if(entry.dirty && std::chrono::duration<double, std::milli>(now - entry.changedAt).count() >= settleMs) {
+                entry.dirty = false;
+                entry.submitted = true;
+                shader.beginReload();
+            }
+        }
+
+        return swapped;
+    }
+
+    private:
+    struct Entry {
+        Shader* shader;
+        bool dirty;
+        bool submitted;
+        std::chrono::steady_clock::time_point changedAt;
+    };
+
+    std::vector<Entry> entries;
+
+    // canonical path -> last seen modification time (used by the polling fallback)
+    std::unordered_map<std::string, std::filesystem::file_time_type> files;
+    std::chrono::steady_clock::time_point lastPoll;
+
+#ifdef __linux__
+    int inotifyFd = -1;
+
+    // watch descriptor -> watched directory
+    std::unordered_map<int, std::string> directories;
+#endif
+
+    static std::string canonicalPath(const std::string& path) {
+        std::error_code error;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+
+        return error ? path : canonical.string();
+    }
+
+    void watchFile(const std::string& path) {
+        std::string canonical = canonicalPath(path);
+        std::error_code error;
+
+        files[canonical] = std::filesystem::last_write_time(canonical, error);
+
+#ifdef __linux__
+        if(inotifyFd < 0) {
+            return;
+        }
+
+        std::string directory = std::filesystem::path(canonical).parent_path().string();
+
+        for(const auto& watched : directories) {
+            if(watched.second == directory) {
+                return;
+            }
+        }
+
+        int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+        if(wd >= 0) {
+            directories[wd] = directory;
+        }
+#endif
+    }
+
+    void watchDependencies(const Shader& shader) {
+        for(const std::string& file : shader.dependencies()) {
+            if(!files.count(canonicalPath(file))) {
+                watchFile(file);
+            }
+        }
+    }
+
+    void markChanged(const std::string& canonical) {
+        auto now = std::chrono::steady_clock::now();
+
+        for(Entry& entry : entries) {
+            for(const std::string& file : entry.shader->dependencies()) {
+                if(canonicalPath(file) == canonical) {
+                    entry.dirty = true;
+                    entry.changedAt = now;
+                    break;
+                }
+            }
+        }
+    }
+
+    void collectChanges() {
+#ifdef __linux__
+        if(inotifyFd >= 0) {
+            alignas(inotify_event) char buffer[4096];
+            ssize_t length;
+
+            while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for(char* cursor = buffer; cursor < buffer + length; ) {
+                    inotify_event* event = (inotify_event*)cursor;
+                    cursor += sizeof(inotify_event) + event->len;
+
+                    auto directory = directories.find(event->wd);
+
+                    if(event->len == 0 || directory == directories.end()) {
+                        continue;
+                    }
+
+                    std::string path = directory->second + "/" + event->name;
+
+                    if(files.count(path)) {
+                        markChanged(path);
+                    }
+                }
+            }
+
+            return;
+        }
+#endif
+        auto now = std::chrono::steady_clock::now();
+
+        if(std::chrono::duration<double, std::milli>(now - lastPoll).count() < pollIntervalMs) {
+            return;
+        }
+
+        lastPoll = now;
+
+        for(auto& file : files) {
+            std::error_code error;
+            std::filesystem::file_time_type modified = std::filesystem::last_write_time(file.first, error);
+
+            if(!error && modified != file.second) {
+                file.second = modified;
+                markChanged(file.first);
+            }
+        }
+    }
+};
+
+#endif
@@ -141,6 +141,8 @@ int main() {
 
     transformationMatrix = glm::translate(transformationMatrix, glm::vec3(0.3f, 0.0f, 0.0f));
 
+    GLint transformLocation = myShader.uniform("transform");
+
     while(!glfwWindowShouldClose(window)) {
         glClearColor(0.3f, 0.4f, 0.6f, 1.0f);
 
@@ -154,7 +156,7 @@ int main() {
 
         // transformationMatrix = glm::scale(transformationMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
 
-        glUniformMatrix4fv(glGetUniformLocation(myShader.shaderProgram, "transform"), 1, GL_FALSE, glm::value_ptr(transformationMatrix));
+        myShader.setMat4(transformLocation, transformationMatrix);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBindTexture(GL_TEXTURE_2D, TBO);
@@ -6,98 +6,23 @@
 #include <string>
 #include <cstring>
 #include <filesystem>
+#include "shaderLibrary.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "textureStreamer.h"
+#include "glState.h"
 
 using std::vector;
 using std::array;
 using std::string;
 
-const char *vertexShaderSource = R"(
-    #version 330 core
-
-    layout (location = 0) in vec3 aPos;
-    layout (location = 1) in vec3 aColor;
-    layout (location = 2) in vec2 aTexCoord;
-
-    uniform vec3 npos;
-    uniform float scale;
-
-    out vec3 myColor;
-    out vec2 textureCoord;
-
-    void main() {
-        gl_Position = vec4((aPos.x * scale) + npos.x, (aPos.y * scale) + npos.y, aPos.z + npos.z, 1.0);
-        // gl_Position = vec4(npos, 1.0);
-        myColor = aColor;
-        textureCoord = aTexCoord;
-    }
-)";
-
-const char *fragmentShaderSource = R"(
-    #version 330 core
-    
-    out vec4 FragColor;
-
-    in vec3 myColor;
-    in vec2 textureCoord;
-
-    uniform sampler2D myTexture;
-
-    void main() {
-        // FragColor = vec4(1.0f, 0.5f, 0.2f, 1.0f);
-        // FragColor = vec4(myColor, 1.0f);
-        FragColor = texture(myTexture, textureCoord) * vec4(myColor, 1.0f);
-    }
-)";
-
 void processInput(GLFWwindow *window) {
     if(glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
 }
 
-unsigned int initVertexShader() {
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-
-    // Attach the shader source code to the shader object
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-
-    // compile the shader:
-    glCompileShader(vertexShader);
-
-    return vertexShader;
-}
-
-unsigned int initFragmentShader() {
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-
-    glCompileShader(fragmentShader);
-
-    return fragmentShader;
-}
-
-void shaderCheckSuccess(unsigned int shader, string type, int success, char infoLog[512]) {
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-
-    if(!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::" << type << "::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-}
-
-void checkLinkSuccess(unsigned int shaderProgram, int success, char infoLog[512]) {
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-}
-
 float xOffset = 0.0f;
 float yOffset = 0.0f;
 
@@ -146,32 +71,11 @@ int main() {
     glfwSetCursorPosCallback(window, cursor_callback);
 
     // SHADERS
-    int success = 0;
-    char infoLog[512];
-
-    // VERTEX SHADER
-    unsigned int vertexShader = initVertexShader();
-
-    shaderCheckSuccess(vertexShader, "VERTEX", success, infoLog);
-
-    // FRAGMENT SHADER
-    unsigned int fragmentShader = initFragmentShader();
-
-    shaderCheckSuccess(fragmentShader, "FRAGMENT", success, infoLog);
+    // quadVertexShader.glsl/quadFragmentShader.glsl are shared with main.cpp; this is the TEXTURED permutation
+    ShaderLibrary shaders;
+    Shader& quadShader = shaders.variant("quadVertexShader.glsl", "quadFragmentShader.glsl", {{"TEXTURED", ""}});
 
-    // link shaders
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // check for linking errors
-    checkLinkSuccess(shaderProgram, success, infoLog);
-
-    glUseProgram(shaderProgram);
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    quadShader.use();
 
     /* float vertices[] = {
         -0.5f, -0.5f, 0.0f, 0.3f, 0.5f, 0.7f,
@@ -242,39 +146,35 @@ int main() {
     };
 
     /*
-        The function first takes as input the location of an image file. It then expects you to give three ints as its second, 
-        third and fourth argument that stb_image.h will fill with the resulting image's width, height and number of color channels. 
-        We need the image's width and height for generating textures later on.
+        stb_image decodes wall.jpg on a worker thread while the window is already drawing, and the same worker
+        filters the mip chain (sRGB-correct, see mipmapGenerator.h). request() returns the texture name right away,
+        bound to a small placeholder, and update() uploads every level through a pixel buffer object a few
+        megabytes per frame.
     */
-    int texWidth, texHeight, nrChannels;
-    unsigned char* data = stbi_load("wall.jpg", &texWidth, &texHeight, &nrChannels, 0);
-
-    // gen a texture buffer
-    unsigned int texture;
-    glGenTextures(1, &texture);
-
-    // Just like other objects we need to bind it so any subsequent texture commands will configure the currently bound texture:
-    glBindTexture(GL_TEXTURE_2D, texture);
+    TextureStreamer textures;
+    textures.start();
+    unsigned int texture = textures.request("wall.jpg");
 
     // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    /* 
-        Now that the texture is bound, we can start generating a texture using the previously loaded image data. 
-        Textures are generated with glTexImage2D: 
-    */
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texWidth, texHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
 
-    // After we're done generating the texture and its corresponding mipmaps, it is good practice to free the image memory:
-    stbi_image_free(data);
+    // uniform locations don't change after linking, so look them up once instead of every frame
+    int positionLocation = quadShader.uniform("npos");
+    int scaleLocation = quadShader.uniform("scale");
 
+    // the loop below sets the same program, texture and VAO every frame; GLState only lets
+    // the ones that change through (the element buffer is already part of the VAO)
+    GLState glState;
 
     // Loop until the user closes the window
     while (!glfwWindowShouldClose(window)) {
+        glState.beginFrame();
+
         // Render here
+        textures.update();
 
         // clear
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -285,10 +185,8 @@ int main() {
 
         // printf("xoff: %f, yoff: %f\n", xOffset, yOffset);
 
-        int positionLocation = glGetUniformLocation(shaderProgram, "npos");
+        glState.useProgram(quadShader);
         glUniform3f(positionLocation, xOffset, yOffset, 0.0f);
-
-        int scaleLocation = glGetUniformLocation(shaderProgram, "scale");
         glUniform1f(scaleLocation, 0.5f);
 
         // Draw a triangle
@@ -301,11 +199,13 @@ int main() {
         // glVertex2f(0.0f, 0.5f);
         // glEnd();
 
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glBindVertexArray(VAO);
+        glState.bindTexture(0, GL_TEXTURE_2D, texture);
+        glState.bindVertexArray(VAO);
         // glDrawArrays(GL_TRIANGLES, 0, 3);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
+        glState.endFrame();
+
         processInput(window);
 
         // last
@@ -317,8 +217,13 @@ int main() {
         glfwPollEvents();
     }
 
+    printGLStateStats(glState);
+
+    textures.stop();
+    glDeleteTextures(1, &texture);
     glDeleteBuffers(1, &VBO);
     glDeleteVertexArrays(1, &VAO);
+    glDeleteProgram(quadShader.shaderProgram);
 
     // Clean up
     glfwDestroyWindow(window);
@@ -0,0 +1,628 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <vector>
+#include <string>
+#include <climits>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "mappedFile.h"
+#include "mipmapGenerator.h"
+#include "shader.h"
+
+// Packs many images into the layers of one GL_TEXTURE_2D_ARRAY, so objects with
+// different textures still share a texture binding and can go into one instanced draw.
+//
+// Images are placed with a skyline bottom-left packer, several per layer. Each gets a
+// border of repeated edge texels, and positions and padded sizes are multiples of the
+// padding, so mip levels up to log2(padding) never blend neighbours together. An image
+// exactly the layer size takes a whole layer without a border, which makes a plain
+// texture array a special case of the same thing.
+//
+// Every packed image is a material: its layer and a uv scale / offset, uploaded to the
+// Materials uniform block. The TEXTURE_ATLAS permutation of vertexShader.glsl reads
+// it through a per-instance material index (InstanceBuffer::upload with materials)
+// and rewrites the mesh's 0-1 uvs. Repeating uvs don't survive atlasing; tiled
+// surfaces need a whole layer.
+//
+// Packing can happen at run time (TextureAtlas::build) or offline with atlasPack,
+// which writes an .atlas file that TextureAtlas::load maps and uploads as is:
+//
+//   AtlasFileHeader    magic, version, layer size, counts and blob offsets
+//   regions            AtlasFileRegion per material
+//   names              material names, not terminated
+//   pixels             RGBA8 layers, level 0 only
+
+const uint32_t ATLAS_FILE_MAGIC = 0x534C5441; // "ATLS"
+const uint32_t ATLAS_FILE_VERSION = 1;
+
+// array size of the Materials block in vertexShader.glsl
+const unsigned int ATLAS_MAX_MATERIALS = 512;
+
+class SkylinePacker {
+    public:
+    void reset(int packWidth, int packHeight) {
+        width = packWidth;
+        height = packHeight;
+        skyline.assign(1, Segment{0, 0, packWidth});
+    }
+
+    // bottom-left: the placement with the lowest top edge, then the leftmost
+    bool pack(int rectWidth, int rectHeight, int& x, int& y) {
+        int bestIndex = -1, bestTop = INT_MAX, bestX = 0, bestY = 0;
+
+        for(size_t i = 0; i < skyline.size(); ++i) {
+            int restY;
+
+            if(!fits(i, rectWidth, rectHeight, restY)) {
+                continue;
+            }
+
+            if(restY + rectHeight < bestTop || (restY + rectHeight == bestTop && skyline[i].x < bestX)) {
+                bestIndex = (int)i;
+                bestTop = restY + rectHeight;
+                bestX = skyline[i].x;
+                bestY = restY;
+            }
+        }
+
+        if(bestIndex < 0) {
+            return false;
+        }
+
+        place(bestIndex, bestX, bestTop, rectWidth);
+
+        x = bestX;
+        y = bestY;
+
+        return true;
+    }
+
+    private:
+    struct Segment {
+        int x, y, width;
+    };
+
+    int width = 0, height = 0;
+    std::vector<Segment> skyline;
+
+    // the height the rectangle rests at with its left edge on segment index
+    bool fits(size_t index, int rectWidth, int rectHeight, int& restY) const {
+        if(skyline[index].x + rectWidth > width) {
+            return false;
+        }
+
+        int widthLeft = rectWidth;
+        restY = 0;
+
+        for(size_t i = index; widthLeft > 0; ++i) {
+            restY = std::max(restY, skyline[i].y);
+
+            if(restY + rectHeight > height) {
+                return false;
+            }
+
+            widthLeft -= skyline[i].width;
+        }
+
+        return true;
+    }
+
+    void place(size_t index, int x, int top, int rectWidth) {
+        skyline.insert(skyline.begin() + index, Segment{x, top, rectWidth});
+
+        // cut away what the new segment now covers
+        for(size_t i = index + 1; i < skyline.size();) {
+            int covered = x + rectWidth - skyline[i].x;
+
+            if(covered <= 0) {
+                break;
+            }
+
+            skyline[i].x += covered;
+            skyline[i].width -= covered;
+
+            if(skyline[i].width > 0) {
+                break;
+            }
+
+            skyline.erase(skyline.begin() + i);
+        }
+
+        for(size_t i = 0; i + 1 < skyline.size();) {
+            if(skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else {
+                ++i;
+            }
+        }
+    }
+};
+
+struct AtlasRegion {
+    int layer = 0;
+    // texels inside the layer, border excluded
+    int x = 0, y = 0, width = 0, height = 0;
+    int border = 0;
+    // atlas uv = uv * xy + zw
+    glm::vec4 uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+};
+
+struct AtlasLayout {
+    int layerWidth = 0, layerHeight = 0, padding = 0;
+    int layerCount = 0;
+    // in the order the sizes were given
+    std::vector<AtlasRegion> regions;
+};
+
+// fewest layers that hold every size; false if one doesn't fit an empty layer
+inline bool packAtlas(const std::vector<glm::ivec2>& sizes, int layerWidth, int layerHeight, int padding, AtlasLayout& layout) {
+    // everything is placed on a grid of padding-sized cells
+    int cell = padding > 0 ? padding : 1;
+
+    layout.layerWidth = layerWidth;
+    layout.layerHeight = layerHeight;
+    layout.padding = padding;
+    layout.layerCount = 0;
+    layout.regions.assign(sizes.size(), AtlasRegion());
+
+    std::vector<SkylinePacker> packers;
+    std::vector<int> cellWidths(sizes.size()), cellHeights(sizes.size()), order;
+
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        if(sizes[i].x == layerWidth && sizes[i].y == layerHeight) {
+            // a layer of its own, no border needed
+            AtlasRegion& region = layout.regions[i];
+            region.layer = layout.layerCount++;
+            region.width = layerWidth;
+            region.height = layerHeight;
+            packers.emplace_back();
+            packers.back().reset(0, 0);
+            continue;
+        }
+
+        cellWidths[i] = (sizes[i].x + 2 * padding + cell - 1) / cell;
+        cellHeights[i] = (sizes[i].y + 2 * padding + cell - 1) / cell;
+        order.push_back((int)i);
+    }
+
+    // tallest first packs tightest on a skyline
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return cellHeights[a] != cellHeights[b] ? cellHeights[a] > cellHeights[b] : cellWidths[a] > cellWidths[b];
+    });
+
+    for(int i : order) {
+        int cellX = 0, cellY = 0, layer = 0;
+
+        while(layer < (int)packers.size() && !packers[layer].pack(cellWidths[i], cellHeights[i], cellX, cellY)) {
+            ++layer;
+        }
+
+        if(layer == (int)packers.size()) {
+            packers.emplace_back();
+            packers.back().reset(layerWidth / cell, layerHeight / cell);
+            layout.layerCount++;
+
+            if(!packers.back().pack(cellWidths[i], cellHeights[i], cellX, cellY)) {
+                std::cout << "ERROR::TEXTURE_ATLAS::IMAGE_TOO_LARGE: " << sizes[i].x << "x" << sizes[i].y << " with padding " << padding
+                          << " in a " << layerWidth << "x" << layerHeight << " layer" << std::endl;
+                return false;
+            }
+        }
+
+        AtlasRegion& region = layout.regions[i];
+        region.layer = layer;
+        region.x = cellX * cell + padding;
+        region.y = cellY * cell + padding;
+        region.width = sizes[i].x;
+        region.height = sizes[i].y;
+        region.border = padding;
+    }
+
+    for(AtlasRegion& region : layout.regions) {
+        region.uvTransform = glm::vec4((float)region.width / layerWidth, (float)region.height / layerHeight,
+                                       (float)region.x / layerWidth, (float)region.y / layerHeight);
+    }
+
+    return true;
+}
+
+// RGBA8 layers with every image and its border copied in
+inline std::vector<unsigned char> composeAtlas(const AtlasLayout& layout, const std::vector<const unsigned char*>& images) {
+    size_t layerBytes = (size_t)layout.layerWidth * layout.layerHeight * 4;
+    std::vector<unsigned char> pixels(layerBytes * layout.layerCount, 0);
+
+    for(size_t i = 0; i < layout.regions.size(); ++i) {
+        const AtlasRegion& region = layout.regions[i];
+        unsigned char* layer = pixels.data() + layerBytes * region.layer;
+
+        for(int y = -region.border; y < region.height + region.border; ++y) {
+            int sourceY = y < 0 ? 0 : y >= region.height ? region.height - 1 : y;
+            unsigned char* row = layer + ((size_t)(region.y + y) * layout.layerWidth + region.x) * 4;
+            const unsigned char* sourceRow = images[i] + (size_t)sourceY * region.width * 4;
+
+            memcpy(row, sourceRow, (size_t)region.width * 4);
+
+            for(int x = 1; x <= region.border; ++x) {
+                memcpy(row - x * 4, sourceRow, 4);
+                memcpy(row + (region.width - 1 + x) * 4, sourceRow + (region.width - 1) * 4, 4);
+            }
+        }
+    }
+
+    return pixels;
+}
+
+// for meshes baked against one material instead of indexing the Materials block
+inline void rewriteAtlasUvs(float* vertices, size_t vertexCount, int floatsPerVertex, int uvOffset, const AtlasRegion& region) {
+    for(size_t i = 0; i < vertexCount; ++i) {
+        float* uv = vertices + i * floatsPerVertex + uvOffset;
+        uv[0] = uv[0] * region.uvTransform.x + region.uvTransform.z;
+        uv[1] = uv[1] * region.uvTransform.y + region.uvTransform.w;
+    }
+}
+
+// ---- .atlas files ----
+
+struct AtlasFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layerWidth;
+    uint32_t layerHeight;
+    uint32_t layerCount;
+    uint32_t padding;
+    uint32_t regionCount;
+    uint32_t reserved;
+
+    uint64_t regionsOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint64_t pixelsOffset;
+};
+
+struct AtlasFileRegion {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t layer;
+    uint32_t x, y, width, height;
+    uint32_t border;
+};
+
+inline bool writeAtlasFile(const char* path, const AtlasLayout& layout, const std::vector<std::string>& names, const std::vector<unsigned char>& pixels) {
+    std::vector<AtlasFileRegion> regions;
+    std::string nameBlob;
+
+    for(size_t i = 0; i < layout.regions.size(); ++i) {
+        const AtlasRegion& region = layout.regions[i];
+        AtlasFileRegion fileRegion = {(uint32_t)nameBlob.size(), (uint32_t)names[i].size(), (uint32_t)region.layer,
+                                      (uint32_t)region.x, (uint32_t)region.y, (uint32_t)region.width, (uint32_t)region.height, (uint32_t)region.border};
+        regions.push_back(fileRegion);
+        nameBlob += names[i];
+    }
+
+    AtlasFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ATLAS_FILE_MAGIC;
+    header.version = ATLAS_FILE_VERSION;
+    header.layerWidth = layout.layerWidth;
+    header.layerHeight = layout.layerHeight;
+    header.layerCount = layout.layerCount;
+    header.padding = layout.padding;
+    header.regionCount = (uint32_t)regions.size();
+    header.regionsOffset = sizeof(header);
+    header.namesOffset = header.regionsOffset + regions.size() * sizeof(AtlasFileRegion);
+    header.namesSize = nameBlob.size();
+    // pixels on a 64 byte boundary, like the .mesh blobs
+    header.pixelsOffset = (header.namesOffset + header.namesSize + 63) / 64 * 64;
+
+    FILE* file = fopen(path, "wb");
+
+    if(!file) {
+        std::cout << "ERROR::ATLAS_FILE::WRITE_FAILED: " << path << std::endl;
+        return false;
+    }
+
+    static const char padding[64] = {};
+    size_t gap = header.pixelsOffset - header.namesOffset - header.namesSize;
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(regions.data(), sizeof(AtlasFileRegion), regions.size(), file) == regions.size();
+    ok = ok && fwrite(nameBlob.data(), 1, nameBlob.size(), file) == nameBlob.size();
+    ok = ok && fwrite(padding, 1, gap, file) == gap;
+    ok = ok && fwrite(pixels.data(), 1, pixels.size(), file) == pixels.size();
+
+    fclose(file);
+
+    if(!ok) {
+        std::cout << "ERROR::ATLAS_FILE::WRITE_FAILED: " << path << std::endl;
+    }
+
+    return ok;
+}
+
+class AtlasFile {
+    public:
+    MappedFile file;
+    const AtlasFileHeader* header = nullptr;
+    const AtlasFileRegion* regions = nullptr;
+    const char* names = nullptr;
+    const unsigned char* pixels = nullptr;
+
+    bool open(const char* path) {
+        header = nullptr;
+
+        if(!file.open(path)) {
+            return false;
+        }
+
+        if(file.size < sizeof(AtlasFileHeader)) {
+            std::cout << "ERROR::ATLAS_FILE::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+
+        const AtlasFileHeader* candidate = (const AtlasFileHeader*)file.data;
+
+        if(candidate->magic != ATLAS_FILE_MAGIC || candidate->version != ATLAS_FILE_VERSION) {
+            std::cout << "ERROR::ATLAS_FILE::BAD_HEADER: " << path << " (version " << candidate->version << ", expected " << ATLAS_FILE_VERSION << ")" << std::endl;
+            return false;
+        }
+
+        // GL texture limits are far below this; it keeps the pixel size from overflowing
+        if(candidate->layerWidth > 65536 || candidate->layerHeight > 65536 || candidate->layerCount > 65536) {
+            std::cout << "ERROR::ATLAS_FILE::BAD_HEADER: " << path << " (" << candidate->layerWidth << "x" << candidate->layerHeight << "x" << candidate->layerCount << ")" << std::endl;
+            return false;
+        }
+
+        uint64_t pixelsSize = (uint64_t)candidate->layerWidth * candidate->layerHeight * 4 * candidate->layerCount;
+
+        if(!blobInFile(candidate->regionsOffset, (uint64_t)candidate->regionCount * sizeof(AtlasFileRegion))
+            || !blobInFile(candidate->namesOffset, candidate->namesSize)
+            || !blobInFile(candidate->pixelsOffset, pixelsSize)) {
+            std::cout << "ERROR::ATLAS_FILE::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+
+        // TextureAtlas::load() builds names and uv transforms straight from these
+        const AtlasFileRegion* candidateRegions = (const AtlasFileRegion*)(file.data + candidate->regionsOffset);
+
+        for(uint32_t i = 0; i < candidate->regionCount; ++i) {
+            if(!regionFits(*candidate, candidateRegions[i])) {
+                std::cout << "ERROR::ATLAS_FILE::BAD_REGION: " << path << " region " << i << std::endl;
+                return false;
+            }
+        }
+
+        header = candidate;
+        regions = (const AtlasFileRegion*)(file.data + header->regionsOffset);
+        names = (const char*)(file.data + header->namesOffset);
+        pixels = file.data + header->pixelsOffset;
+
+        return true;
+    }
+
+    void close() {
+        file.close();
+        header = nullptr;
+    }
+
+    private:
+    bool blobInFile(uint64_t offset, uint64_t size) const {
+        return offset <= file.size && size <= file.size - offset;
+    }
+
+    static bool regionFits(const AtlasFileHeader& header, const AtlasFileRegion& region) {
+        if((uint64_t)region.nameOffset + region.nameLength > header.namesSize || region.layer >= header.layerCount) {
+            return false;
+        }
+
+        // the border around the texels has to be inside the layer too
+        return (uint64_t)region.x >= region.border && (uint64_t)region.y >= region.border
+            && (uint64_t)region.x + region.width + region.border <= header.layerWidth
+            && (uint64_t)region.y + region.height + region.border <= header.layerHeight;
+    }
+};
+
+// ---- GPU side ----
+
+// std140 element of the Materials block
+struct AtlasMaterial {
+    glm::vec4 uvTransform;
+    // x is the layer
+    glm::vec4 layer;
+};
+
+static_assert(sizeof(AtlasMaterial) == 32, "AtlasMaterial must match the std140 layout of vertexShader.glsl");
+
+struct AtlasImage {
+    std::string name;
+    // RGBA8
+    const unsigned char* pixels = nullptr;
+    int width = 0, height = 0;
+};
+
+class TextureAtlas {
+    public:
+    // GL_TEXTURE_2D_ARRAY
+    unsigned int texture = 0;
+    // the Materials block, bound at MATERIAL_BLOCK_BINDING
+    unsigned int UBO = 0;
+    AtlasLayout layout;
+    // material name -> index into layout.regions and the Materials block
+    std::unordered_map<std::string, unsigned int> materials;
+
+    // pack and upload at run time
+    bool build(const std::vector<AtlasImage>& images, int layerWidth = 2048, int layerHeight = 2048, int padding = 8) {
+        std::vector<glm::ivec2> sizes;
+        std::vector<const unsigned char*> pixels;
+        std::vector<std::string> names;
+
+        for(const AtlasImage& image : images) {
+            sizes.push_back(glm::ivec2(image.width, image.height));
+            pixels.push_back(image.pixels);
+            names.push_back(image.name);
+        }
+
+        if(!packAtlas(sizes, layerWidth, layerHeight, padding, layout)) {
+            return false;
+        }
+
+        return upload(composeAtlas(layout, pixels).data(), names);
+    }
+
+    // an atlas packed offline by atlasPack
+    bool load(const char* path) {
+        AtlasFile file;
+
+        if(!file.open(path)) {
+            return false;
+        }
+
+        layout = AtlasLayout();
+        layout.layerWidth = file.header->layerWidth;
+        layout.layerHeight = file.header->layerHeight;
+        layout.layerCount = file.header->layerCount;
+        layout.padding = file.header->padding;
+
+        std::vector<std::string> names;
+
+        for(uint32_t i = 0; i < file.header->regionCount; ++i) {
+            const AtlasFileRegion& fileRegion = file.regions[i];
+
+            AtlasRegion region;
+            region.layer = fileRegion.layer;
+            region.x = fileRegion.x;
+            region.y = fileRegion.y;
+            region.width = fileRegion.width;
+            region.height = fileRegion.height;
+            region.border = fileRegion.border;
+            region.uvTransform = glm::vec4((float)region.width / layout.layerWidth, (float)region.height / layout.layerHeight,
+                                           (float)region.x / layout.layerWidth, (float)region.y / layout.layerHeight);
+
+            layout.regions.push_back(region);
+            names.push_back(std::string(file.names + fileRegion.nameOffset, fileRegion.nameLength));
+        }
+
+        bool ok = upload(file.pixels, names);
+        file.close();
+
+        return ok;
+    }
+
+    // index for InstanceBuffer's material stream
+    unsigned int material(const std::string& name) const {
+        auto found = materials.find(name);
+
+        if(found == materials.end()) {
+            std::cout << "ERROR::TEXTURE_ATLAS::UNKNOWN_MATERIAL: " << name << std::endl;
+            return 0;
+        }
+
+        return found->second;
+    }
+
+    void bind(unsigned int unit = 0) const {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, UBO);
+    }
+
+    void destroy() {
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &UBO);
+        texture = 0;
+        UBO = 0;
+        materials.clear();
+    }
+
+    private:
+    bool upload(const unsigned char* pixels, const std::vector<std::string>& names) {
+        if(layout.regions.size() > ATLAS_MAX_MATERIALS) {
+            std::cout << "ERROR::TEXTURE_ATLAS::TOO_MANY_MATERIALS: " << layout.regions.size() << " (max " << ATLAS_MAX_MATERIALS << ")" << std::endl;
+            return false;
+        }
+
+        // borders keep levels up to log2(padding) clean; whole-layer images allow the full chain
+        bool bordered = false;
+
+        for(const AtlasRegion& region : layout.regions) {
+            bordered = bordered || region.width != layout.layerWidth || region.height != layout.layerHeight;
+        }
+
+        int maxLevel = 0;
+
+        while((bordered ? (2 << maxLevel) <= layout.padding : true) && ((layout.layerWidth | layout.layerHeight) >> (maxLevel + 1)) > 0) {
+            ++maxLevel;
+        }
+
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previous);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+        for(int level = 0; level <= maxLevel; ++level) {
+            int width = std::max(1, layout.layerWidth >> level), height = std::max(1, layout.layerHeight >> level);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, width, height, layout.layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+
+        size_t layerBytes = (size_t)layout.layerWidth * layout.layerHeight * 4;
+
+        for(int layer = 0; layer < layout.layerCount; ++layer) {
+            const unsigned char* layerPixels = pixels + layerBytes * layer;
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, layout.layerWidth, layout.layerHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, layerPixels);
+
+            // box filtered so a level never reaches past the border
+            MipChain chain = generateMipChain(layerPixels, layout.layerWidth, layout.layerHeight, 4);
+
+            for(int level = 1; level <= maxLevel; ++level) {
+                const MipLevel& info = chain.levels[level - 1];
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, info.width, info.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, chain.data.data() + info.offset);
+            }
+        }
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, maxLevel);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, (GLuint)previous);
+
+        std::vector<AtlasMaterial> table(ATLAS_MAX_MATERIALS);
+        materials.clear();
+
+        for(size_t i = 0; i < layout.regions.size(); ++i) {
+            table[i].uvTransform = layout.regions[i].uvTransform;
+            table[i].layer = glm::vec4((float)layout.regions[i].layer, 0.0f, 0.0f, 0.0f);
+            materials[names[i]] = (unsigned int)i;
+        }
+
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, table.size() * sizeof(AtlasMaterial), table.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        return true;
+    }
+};
+
+inline void printAtlasStats(const TextureAtlas& atlas) {
+    size_t used = 0;
+
+    for(const AtlasRegion& region : atlas.layout.regions) {
+        used += (size_t)region.width * region.height;
+    }
+
+    size_t total = (size_t)atlas.layout.layerWidth * atlas.layout.layerHeight * atlas.layout.layerCount;
+
+    std::cout << "TEXTURE::ATLAS: " << atlas.layout.regions.size() << " material(s) in " << atlas.layout.layerCount << " layer(s) of "
+              << atlas.layout.layerWidth << "x" << atlas.layout.layerHeight << ", " << (total ? 100.0 * used / total : 0.0) << "% covered" << std::endl;
+}
+
+#endif
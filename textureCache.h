@@ -0,0 +1,236 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <list>
+#include <string>
+#include <iostream>
+#include <filesystem>
+#include <unordered_map>
+#include "textureStreamer.h"
+
+// Shares textures between everything that asks for the same file with the same load
+// parameters and streamer settings (compression, mip filter), so a texture used by
+// many materials is decoded and uploaded once.
+//
+// acquire() returns the GL texture name and takes a reference; release() gives it back.
+// Textures nobody references stay resident (a later acquire() is a hit) until the
+// resident total exceeds vramBudget; then the least recently released ones are
+// deleted. Referenced textures and textures still streaming in are never evicted.
+// A texture that fails to load is forgotten: a later acquire() of the file is a miss
+// and tries again, and the placeholder is deleted once nobody references it.
+
+struct TextureParams {
+    bool mipmaps = true;
+};
+
+struct TextureCacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    unsigned int evictions = 0;
+    size_t residentBytes = 0;
+    size_t peakResidentBytes = 0;
+};
+
+class TextureCache {
+    public:
+    size_t vramBudget;
+    TextureCacheStats stats;
+
+    explicit TextureCache(TextureStreamer& textureStreamer, size_t budgetBytes = 256 * 1024 * 1024)
+        : vramBudget(budgetBytes), streamer(textureStreamer) {
+        streamer.onUploaded = [this](unsigned int texture, size_t bytes) {
+            uploaded(texture, bytes);
+        };
+        streamer.onFailed = [this](unsigned int texture) {
+            failed(texture);
+        };
+    }
+
+    ~TextureCache() {
+        streamer.onUploaded = nullptr;
+        streamer.onFailed = nullptr;
+    }
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    unsigned int acquire(const std::string& path, const TextureParams& params = TextureParams()) {
+        std::string key = cacheKey(path, params);
+        auto found = byKey.find(key);
+
+        if(found != byKey.end()) {
+            Entry& entry = entries[found->second];
+
+            if(entry.refCount++ == 0) {
+                unused.erase(entry.lruPosition);
+            }
+
+            stats.hits++;
+
+            return entry.texture;
+        }
+
+        stats.misses++;
+
+        Entry entry;
+        entry.key = key;
+        entry.texture = streamer.request(path, params.mipmaps);
+        entry.refCount = 1;
+
+        byKey[key] = entry.texture;
+        entries[entry.texture] = entry;
+
+        return entry.texture;
+    }
+
+    void release(unsigned int texture) {
+        auto found = entries.find(texture);
+
+        if(found == entries.end() || found->second.refCount == 0) {
+            std::cout << "ERROR::TEXTURE_CACHE::RELEASE_WITHOUT_ACQUIRE: " << texture << std::endl;
+            return;
+        }
+
+        Entry& entry = found->second;
+
+        if(--entry.refCount == 0 && entry.failed) {
+            glDeleteTextures(1, &entry.texture);
+            entries.erase(found);
+        }
+        else if(entry.refCount == 0) {
+            // most recently released at the back, evicted from the front
+            entry.lruPosition = unused.insert(unused.end(), texture);
+            evict();
+        }
+    }
+
+    // GL thread, once per frame: streams textures in and keeps the budget
+    void update() {
+        streamer.update();
+        evict();
+    }
+
+    // delete every unreferenced texture, e.g. on a level change
+    void trim() {
+        size_t budget = vramBudget;
+        vramBudget = 0;
+        evict();
+        vramBudget = budget;
+    }
+
+    // delete everything, referenced or not; stop the streamer first
+    void destroy() {
+        for(auto& entry : entries) {
+            glDeleteTextures(1, &entry.second.texture);
+        }
+
+        entries.clear();
+        byKey.clear();
+        unused.clear();
+        stats.residentBytes = 0;
+    }
+
+    private:
+    struct Entry {
+        std::string key;
+        unsigned int texture = 0;
+        unsigned int refCount = 0;
+        // 0 until the streamer has uploaded the real contents
+        size_t bytes = 0;
+        // the load failed; only the placeholder is left and byKey no longer has it
+        bool failed = false;
+        std::list<unsigned int>::iterator lruPosition;
+    };
+
+    TextureStreamer& streamer;
+    std::unordered_map<std::string, unsigned int> byKey;
+    std::unordered_map<unsigned int, Entry> entries;
+    // unreferenced textures, least recently released first
+    std::list<unsigned int> unused;
+
+    // the streamer's settings at request time are part of the key: changing its
+    // compression or mip filter must not hand back a texture built the old way
+    std::string cacheKey(const std::string& path, const TextureParams& params) const {
+        // "wall.jpg", "./wall.jpg" and an absolute path are the same file
+        std::error_code error;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        std::string key = (error ? path : canonical.string()) + "|" + compressionName(streamer.compression);
+
+        if(!params.mipmaps) {
+            return key + "|base";
+        }
+
+        // compressed textures always get their mips on the CPU; the SIMD choice doesn't change them
+        if(streamer.compression == TEXTURE_UNCOMPRESSED && !streamer.cpuMipmaps) {
+            return key + "|glmipmaps";
+        }
+
+        return key + (streamer.mipSettings.filter == MIP_FILTER_KAISER ? "|kaiser" : "|box") + (streamer.mipSettings.srgb ? "|srgb" : "|linear");
+    }
+
+    void uploaded(unsigned int texture, size_t bytes) {
+        auto found = entries.find(texture);
+
+        if(found == entries.end()) {
+            return;
+        }
+
+        found->second.bytes = bytes;
+        stats.residentBytes += bytes;
+        stats.peakResidentBytes = stats.residentBytes > stats.peakResidentBytes ? stats.residentBytes : stats.peakResidentBytes;
+    }
+
+    void failed(unsigned int texture) {
+        auto found = entries.find(texture);
+
+        if(found == entries.end()) {
+            return;
+        }
+
+        Entry& entry = found->second;
+        auto key = byKey.find(entry.key);
+
+        if(key != byKey.end() && key->second == texture) {
+            byKey.erase(key);
+        }
+
+        if(entry.refCount > 0) {
+            entry.failed = true;
+            return;
+        }
+
+        unused.erase(entry.lruPosition);
+        glDeleteTextures(1, &entry.texture);
+        entries.erase(found);
+    }
+
+    void evict() {
+        auto it = unused.begin();
+
+        while(stats.residentBytes > vramBudget && it != unused.end()) {
+            Entry& entry = entries[*it];
+
+            // still streaming in: the streamer owns the name until the upload is done
+            if(entry.bytes == 0) {
+                ++it;
+                continue;
+            }
+
+            glDeleteTextures(1, &entry.texture);
+
+            stats.residentBytes -= entry.bytes;
+            stats.evictions++;
+
+            byKey.erase(entry.key);
+            entries.erase(*it);
+            it = unused.erase(it);
+        }
+    }
+};
+
+inline void printTextureCacheStats(const TextureCacheStats& stats) {
+    std::cout << "TEXTURE::CACHE: " << stats.hits << " hit(s), " << stats.misses << " miss(es), " << stats.evictions << " eviction(s), "
+              << stats.residentBytes / 1024 << " KB resident (peak " << stats.peakResidentBytes / 1024 << " KB)" << std::endl;
+}
+
+#endif
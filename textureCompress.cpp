@@ -0,0 +1,243 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <GL/glew.h>
+#include "textureCompression.h"
+
+// Offline BCn compressor to KTX2 (see textureCompression.h). No GL context is needed.
+//
+//   textureCompress image.jpg out.ktx2 --bc1|--bc3|--bc7 [--no-mips]
+//   textureCompress image.jpg             compare all formats, scalar against SIMD
+//
+// The comparison decodes the blocks again on the CPU to report PSNR against the
+// source, and checks that the scalar and SIMD kernels wrote the same bytes.
+
+void printUsage() {
+    std::cout << "usage: textureCompress image out.ktx2 --bc1|--bc3|--bc7 [--no-mips]" << std::endl;
+    std::cout << "       textureCompress image" << std::endl;
+}
+
+// ---- reference decoders ----
+
+void decodeColorBlock(const uint8_t* block, uint8_t* texels) {
+    uint16_t color0, color1;
+    uint32_t indices;
+    memcpy(&color0, block, 2);
+    memcpy(&color1, block + 2, 2);
+    memcpy(&indices, block + 4, 4);
+
+    int palette[4][4];
+    unpackRGB565(color0, palette[0]);
+    unpackRGB565(color1, palette[1]);
+
+    for(int c = 0; c < 3; ++c) {
+        if(color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+
+    for(int i = 0; i < 16; ++i) {
+        int index = (indices >> (i * 2)) & 3;
+
+        for(int c = 0; c < 3; ++c) {
+            texels[i * 4 + c] = (uint8_t)palette[index][c];
+        }
+
+        texels[i * 4 + 3] = 255;
+    }
+}
+
+void decodeAlphaBlock(const uint8_t* block, uint8_t* texels) {
+    int alpha[8] = {block[0], block[1]};
+
+    for(int i = 1; i < 7; ++i) {
+        alpha[i + 1] = alpha[0] > alpha[1] ? ((7 - i) * alpha[0] + i * alpha[1]) / 7 : 0;
+    }
+
+    if(alpha[0] <= alpha[1]) {
+        for(int i = 1; i < 5; ++i) {
+            alpha[i + 1] = ((5 - i) * alpha[0] + i * alpha[1]) / 5;
+        }
+
+        alpha[6] = 0;
+        alpha[7] = 255;
+    }
+
+    uint64_t bits = 0;
+
+    for(int i = 0; i < 6; ++i) {
+        bits |= (uint64_t)block[2 + i] << (i * 8);
+    }
+
+    for(int i = 0; i < 16; ++i) {
+        texels[i * 4 + 3] = (uint8_t)alpha[(bits >> (i * 3)) & 7];
+    }
+}
+
+// mode 6 only, which is all the encoder writes
+void decodeBlockBC7(const uint8_t* block, uint8_t* texels) {
+    int position = 0;
+    auto read = [&](int count) {
+        int value = 0;
+
+        for(int i = 0; i < count; ++i, ++position) {
+            value |= ((block[position >> 3] >> (position & 7)) & 1) << i;
+        }
+
+        return value;
+    };
+
+    if(read(7) != (1 << 6)) {
+        memset(texels, 0, 64);
+        return;
+    }
+
+    int endpoints[2][4];
+
+    for(int c = 0; c < 4; ++c) {
+        endpoints[0][c] = read(7) << 1;
+        endpoints[1][c] = read(7) << 1;
+    }
+
+    int p0 = read(1), p1 = read(1);
+
+    for(int c = 0; c < 4; ++c) {
+        endpoints[0][c] |= p0;
+        endpoints[1][c] |= p1;
+    }
+
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    for(int i = 0; i < 16; ++i) {
+        int index = read(i == 0 ? 3 : 4);
+
+        for(int c = 0; c < 4; ++c) {
+            texels[i * 4 + c] = (uint8_t)((endpoints[0][c] * (64 - weights[index]) + endpoints[1][c] * weights[index] + 32) >> 6);
+        }
+    }
+}
+
+// PSNR of level 0 over the channels the format stores
+double levelPsnr(const uint8_t* rgba, const CompressedTexture& texture) {
+    size_t blockBytes = compressedBlockBytes(texture.compression);
+    int blocksWide = (texture.width + 3) / 4, blocksHigh = (texture.height + 3) / 4;
+    int channels = texture.compression == TEXTURE_BC1 ? 3 : 4;
+
+    double squaredError = 0.0;
+    uint8_t texels[64];
+
+    for(int by = 0; by < blocksHigh; ++by) {
+        for(int bx = 0; bx < blocksWide; ++bx) {
+            const uint8_t* block = texture.data.data() + ((size_t)by * blocksWide + bx) * blockBytes;
+
+            switch(texture.compression) {
+                case TEXTURE_BC1: decodeColorBlock(block, texels); break;
+                case TEXTURE_BC3: decodeColorBlock(block + 8, texels); decodeAlphaBlock(block, texels); break;
+                default: decodeBlockBC7(block, texels); break;
+            }
+
+            for(int y = 0; y < 4 && by * 4 + y < texture.height; ++y) {
+                for(int x = 0; x < 4 && bx * 4 + x < texture.width; ++x) {
+                    const uint8_t* source = rgba + ((size_t)(by * 4 + y) * texture.width + bx * 4 + x) * 4;
+
+                    for(int c = 0; c < channels; ++c) {
+                        double difference = (double)source[c] - texels[(y * 4 + x) * 4 + c];
+                        squaredError += difference * difference;
+                    }
+                }
+            }
+        }
+    }
+
+    double meanSquaredError = squaredError / ((double)texture.width * texture.height * channels);
+
+    return meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+}
+
+double compressMs(const uint8_t* rgba, int width, int height, TextureCompression compression, bool mipmaps, bool forceScalar, CompressedTexture& texture) {
+    auto start = std::chrono::steady_clock::now();
+    texture = compressTexture(rgba, width, height, compression, mipmaps, forceScalar);
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int compareFormats(const uint8_t* rgba, int width, int height) {
+    size_t rgbaBytes = (size_t)width * height * 4 * 4 / 3;
+
+    std::cout << width << "x" << height << ", rgba8 with mips " << rgbaBytes / 1024 << " KB" << std::endl;
+    std::cout << "format   KB       ratio   scalar ms   simd ms   speedup   PSNR dB   identical" << std::endl;
+
+    for(TextureCompression compression : {TEXTURE_BC1, TEXTURE_BC3, TEXTURE_BC7}) {
+        CompressedTexture scalar, simd;
+        double scalarMs = compressMs(rgba, width, height, compression, true, true, scalar);
+        double simdMs = compressMs(rgba, width, height, compression, true, false, simd);
+
+        printf("%-8s %-8zu %-7.1f %-11.1f %-9.1f %-9.2f %-9.2f %s\n", compressionName(compression), simd.data.size() / 1024,
+               (double)rgbaBytes / simd.data.size(), scalarMs, simdMs, scalarMs / simdMs, levelPsnr(rgba, simd),
+               scalar.data == simd.data ? "yes" : "NO");
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(argv[1], &width, &height, &channels, 4);
+
+    if(!pixels) {
+        std::cout << "ERROR::TEXTURE_COMPRESS::DECODE_FAILED: " << argv[1] << " (" << stbi_failure_reason() << ")" << std::endl;
+        return 1;
+    }
+
+    if(argc == 2) {
+        int result = compareFormats(pixels, width, height);
+        stbi_image_free(pixels);
+        return result;
+    }
+
+    TextureCompression compression = TEXTURE_UNCOMPRESSED;
+    bool mipmaps = true;
+
+    for(int i = 3; i < argc; ++i) {
+        if(strcmp(argv[i], "--bc1") == 0) compression = TEXTURE_BC1;
+        else if(strcmp(argv[i], "--bc3") == 0) compression = TEXTURE_BC3;
+        else if(strcmp(argv[i], "--bc7") == 0) compression = TEXTURE_BC7;
+        else if(strcmp(argv[i], "--no-mips") == 0) mipmaps = false;
+    }
+
+    if(compression == TEXTURE_UNCOMPRESSED) {
+        printUsage();
+        stbi_image_free(pixels);
+        return 1;
+    }
+
+    CompressedTexture texture;
+    double ms = compressMs(pixels, width, height, compression, mipmaps, false, texture);
+    double psnr = levelPsnr(pixels, texture);
+    stbi_image_free(pixels);
+
+    if(!writeKtx2(argv[2], texture)) {
+        return 1;
+    }
+
+    std::cout << argv[2] << ": " << compressionName(compression) << ", " << texture.levels.size() << " level(s), " << texture.data.size() / 1024
+              << " KB, " << ms << " ms, PSNR " << psnr << " dB" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,775 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <thread>
+#include <functional>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <filesystem>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TEXTURE_COMPRESSION_X86 1
+#include <immintrin.h>
+#endif
+
+#include "mipmapGenerator.h"
+
+// CPU block compression to BC1 / BC3 / BC7 and a KTX2 container holding the whole
+// mip chain, so a texture is decoded, filtered and compressed once and every later
+// run just reads the blocks and hands them to glCompressedTexImage2D.
+//
+// The encoders are the fast kind (bounding box endpoints with an inset, indices by
+// projection onto the endpoint axis), in the spirit of J.M.P. van Waveren's real-time
+// DXT compression. The per-block hot loops, channel min/max and index projection,
+// have SSE2 kernels chosen at run time like frustumCulling.h; both kernels round the
+// same way, so output is identical. BC7 uses mode 6 only (one subset, RGBA with
+// 7 bit endpoints plus p-bits and 4 bit indices), which suits smooth photographic
+// textures and needs no partition search.
+
+enum TextureCompression { TEXTURE_UNCOMPRESSED, TEXTURE_BC1, TEXTURE_BC3, TEXTURE_BC7 };
+
+// Vulkan format numbers, as KTX2 stores them
+const uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+const uint32_t VK_FORMAT_BC3_UNORM_BLOCK = 137;
+const uint32_t VK_FORMAT_BC7_UNORM_BLOCK = 145;
+
+#define COMPRESSED_TEXTURE_DIR "textureCache"
+
+inline size_t compressedBlockBytes(TextureCompression compression) {
+    return compression == TEXTURE_BC1 ? 8 : 16;
+}
+
+inline GLenum compressedGLFormat(TextureCompression compression) {
+    switch(compression) {
+        case TEXTURE_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case TEXTURE_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case TEXTURE_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default: return 0;
+    }
+}
+
+inline uint32_t compressedVkFormat(TextureCompression compression) {
+    switch(compression) {
+        case TEXTURE_BC1: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case TEXTURE_BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case TEXTURE_BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+        default: return 0;
+    }
+}
+
+inline const char* compressionName(TextureCompression compression) {
+    switch(compression) {
+        case TEXTURE_BC1: return "bc1";
+        case TEXTURE_BC3: return "bc3";
+        case TEXTURE_BC7: return "bc7";
+        default: return "rgba8";
+    }
+}
+
+// needs a GL context
+inline bool compressionSupported(TextureCompression compression) {
+    switch(compression) {
+        case TEXTURE_BC1:
+        case TEXTURE_BC3:
+            return GLEW_EXT_texture_compression_s3tc;
+        case TEXTURE_BC7:
+            return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+        default:
+            return true;
+    }
+}
+
+// ---- block kernels ----
+
+struct BlockBounds {
+    uint8_t min[4];
+    uint8_t max[4];
+};
+
+// 4x4 RGBA8 texels, rows packed, 64 bytes
+inline void blockBoundsScalar(const uint8_t* block, BlockBounds& bounds) {
+    for(int c = 0; c < 4; ++c) {
+        bounds.min[c] = 255;
+        bounds.max[c] = 0;
+    }
+
+    for(int i = 0; i < 16; ++i) {
+        for(int c = 0; c < 4; ++c) {
+            uint8_t value = block[i * 4 + c];
+            bounds.min[c] = value < bounds.min[c] ? value : bounds.min[c];
+            bounds.max[c] = value > bounds.max[c] ? value : bounds.max[c];
+        }
+    }
+}
+
+// q[i] = round(dot(texel - from, to - from) / |to - from|^2 * steps), clamped to [0, steps].
+// Channels where from and to agree don't contribute, so BC1 passes alpha equal and the
+// BC3 alpha block passes the colour channels equal.
+inline void projectBlockScalar(const uint8_t* block, const int from[4], const int to[4], int steps, uint8_t q[16]) {
+    int axis[4] = {to[0] - from[0], to[1] - from[1], to[2] - from[2], to[3] - from[3]};
+    int lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+
+    if(lengthSquared == 0) {
+        memset(q, 0, 16);
+        return;
+    }
+
+    float scale = (float)steps / (float)lengthSquared;
+
+    for(int i = 0; i < 16; ++i) {
+        int dot = 0;
+
+        for(int c = 0; c < 4; ++c) {
+            dot += (block[i * 4 + c] - from[c]) * axis[c];
+        }
+
+        int value = (int)std::nearbyint((float)dot * scale);
+        q[i] = (uint8_t)(value < 0 ? 0 : value > steps ? steps : value);
+    }
+}
+
+#ifdef TEXTURE_COMPRESSION_X86
+
+__attribute__((target("sse2")))
+inline void blockBoundsSSE2(const uint8_t* block, BlockBounds& bounds) {
+    __m128i rows[4];
+
+    for(int r = 0; r < 4; ++r) {
+        rows[r] = _mm_loadu_si128((const __m128i*)(block + r * 16));
+    }
+
+    __m128i low = _mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3]));
+    __m128i high = _mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3]));
+
+    // fold the four texels in each register down to one
+    low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+    low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+    high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+    high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    uint32_t minimum = (uint32_t)_mm_cvtsi128_si32(low);
+    uint32_t maximum = (uint32_t)_mm_cvtsi128_si32(high);
+
+    memcpy(bounds.min, &minimum, 4);
+    memcpy(bounds.max, &maximum, 4);
+}
+
+__attribute__((target("sse2")))
+inline void projectBlockSSE2(const uint8_t* block, const int from[4], const int to[4], int steps, uint8_t q[16]) {
+    int axis[4] = {to[0] - from[0], to[1] - from[1], to[2] - from[2], to[3] - from[3]};
+    int lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+
+    if(lengthSquared == 0) {
+        memset(q, 0, 16);
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i origin = _mm_setr_epi16((short)from[0], (short)from[1], (short)from[2], (short)from[3], (short)from[0], (short)from[1], (short)from[2], (short)from[3]);
+    const __m128i direction = _mm_setr_epi16((short)axis[0], (short)axis[1], (short)axis[2], (short)axis[3], (short)axis[0], (short)axis[1], (short)axis[2], (short)axis[3]);
+    const __m128 scale = _mm_set1_ps((float)steps / (float)lengthSquared);
+
+    __m128i projected[4];
+
+    for(int r = 0; r < 4; ++r) {
+        __m128i row = _mm_loadu_si128((const __m128i*)(block + r * 16));
+
+        // texels 0-1 and 2-3 widened to int16, then r*dr + g*dg and b*db + a*da per texel
+        __m128i first = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(row, zero), origin), direction);
+        __m128i second = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(row, zero), origin), direction);
+
+        __m128 evens = _mm_shuffle_ps(_mm_castsi128_ps(first), _mm_castsi128_ps(second), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 odds = _mm_shuffle_ps(_mm_castsi128_ps(first), _mm_castsi128_ps(second), _MM_SHUFFLE(3, 1, 3, 1));
+        __m128i dots = _mm_add_epi32(_mm_castps_si128(evens), _mm_castps_si128(odds));
+
+        // cvtps rounds to nearest even, like nearbyint in the scalar kernel
+        projected[r] = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(dots), scale));
+    }
+
+    __m128i packed = _mm_packs_epi32(projected[0], projected[1]);
+    __m128i packedHigh = _mm_packs_epi32(projected[2], projected[3]);
+
+    packed = _mm_min_epi16(_mm_max_epi16(packed, zero), _mm_set1_epi16((short)steps));
+    packedHigh = _mm_min_epi16(_mm_max_epi16(packedHigh, zero), _mm_set1_epi16((short)steps));
+
+    _mm_storeu_si128((__m128i*)q, _mm_packus_epi16(packed, packedHigh));
+}
+
+inline bool compressionHasSSE2() {
+    static const bool supported = __builtin_cpu_supports("sse2");
+    return supported;
+}
+
+#endif
+
+struct BlockKernels {
+    void (*bounds)(const uint8_t*, BlockBounds&);
+    void (*project)(const uint8_t*, const int*, const int*, int, uint8_t*);
+};
+
+// best kernels on this CPU, or the scalar ones when forced
+inline BlockKernels blockKernels(bool forceScalar = false) {
+#ifdef TEXTURE_COMPRESSION_X86
+    if(!forceScalar && compressionHasSSE2()) {
+        return {blockBoundsSSE2, projectBlockSSE2};
+    }
+#endif
+    (void)forceScalar;
+    return {blockBoundsScalar, projectBlockScalar};
+}
+
+// ---- block encoders ----
+
+inline uint16_t packRGB565(const int color[3]) {
+    int r = (color[0] * 31 + 127) / 255;
+    int g = (color[1] * 63 + 127) / 255;
+    int b = (color[2] * 31 + 127) / 255;
+
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRGB565(uint16_t packed, int color[4]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+    color[3] = 0;
+}
+
+// shrink the box by 1/16 of its size per side; the endpoints then sit closer to
+// where most texels are instead of on the outliers
+inline void insetBounds(BlockBounds& bounds, int channels, int low[4], int high[4]) {
+    for(int c = 0; c < 4; ++c) {
+        low[c] = bounds.min[c];
+        high[c] = bounds.max[c];
+
+        if(c < channels) {
+            int inset = (high[c] - low[c]) >> 4;
+            low[c] += inset;
+            high[c] -= inset;
+        }
+    }
+}
+
+inline void encodeColorBlock(const uint8_t* block, const BlockKernels& kernels, uint8_t* out) {
+    BlockBounds bounds;
+    kernels.bounds(block, bounds);
+
+    int low[4], high[4];
+    insetBounds(bounds, 3, low, high);
+
+    uint16_t color0 = packRGB565(high);
+    uint16_t color1 = packRGB565(low);
+    uint32_t indices = 0;
+
+    if(color0 != color1) {
+        // project from color1 towards color0, as decoded, with alpha left out
+        int from[4], to[4];
+        unpackRGB565(color1, from);
+        unpackRGB565(color0, to);
+
+        uint8_t q[16];
+        kernels.project(block, from, to, 3, q);
+
+        // position along the axis -> palette entry (color0, color1, 2/3 0 + 1/3 1, 1/3 0 + 2/3 1)
+        static const uint32_t paletteIndex[4] = {1, 3, 2, 0};
+
+        for(int i = 0; i < 16; ++i) {
+            indices |= paletteIndex[q[i]] << (i * 2);
+        }
+    }
+
+    // color0 > color1 selects the four colour mode, and color0 >= color1 always holds here
+    memcpy(out, &color0, 2);
+    memcpy(out + 2, &color1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+inline void encodeAlphaBlock(const uint8_t* block, const BlockKernels& kernels, uint8_t* out) {
+    BlockBounds bounds;
+    kernels.bounds(block, bounds);
+
+    uint8_t alpha0 = bounds.max[3];
+    uint8_t alpha1 = bounds.min[3];
+    uint64_t bits = 0;
+
+    if(alpha0 != alpha1) {
+        int from[4] = {0, 0, 0, alpha1};
+        int to[4] = {0, 0, 0, alpha0};
+
+        uint8_t q[16];
+        kernels.project(block, from, to, 7, q);
+
+        // alpha0 > alpha1 is the eight value mode: 0 is alpha0, 1 is alpha1 and 2-7 step
+        // from alpha0 towards alpha1
+        for(int i = 0; i < 16; ++i) {
+            uint64_t index = q[i] == 7 ? 0 : q[i] == 0 ? 1 : 8 - q[i];
+            bits |= index << (i * 3);
+        }
+    }
+
+    out[0] = alpha0;
+    out[1] = alpha1;
+
+    for(int i = 0; i < 6; ++i) {
+        out[2 + i] = (uint8_t)(bits >> (i * 8));
+    }
+}
+
+inline void encodeBlockBC1(const uint8_t* block, const BlockKernels& kernels, uint8_t* out) {
+    encodeColorBlock(block, kernels, out);
+}
+
+inline void encodeBlockBC3(const uint8_t* block, const BlockKernels& kernels, uint8_t* out) {
+    encodeAlphaBlock(block, kernels, out);
+    encodeColorBlock(block, kernels, out + 8);
+}
+
+// little endian bit stream over one 128 bit block
+struct BlockBitWriter {
+    uint8_t* out;
+    int position = 0;
+
+    void write(uint32_t value, int count) {
+        for(int i = 0; i < count; ++i, ++position) {
+            if(value & (1u << i)) {
+                out[position >> 3] |= (uint8_t)(1 << (position & 7));
+            }
+        }
+    }
+};
+
+// the 7 bit value + p-bit closest to an 8 bit endpoint, over all four channels
+inline void quantizeEndpointBC7(const int endpoint[4], int quantized[4], int& pBit) {
+    int bestError = -1;
+
+    for(int p = 0; p < 2; ++p) {
+        int candidate[4];
+        int error = 0;
+
+        for(int c = 0; c < 4; ++c) {
+            int value = (endpoint[c] - p + 1) >> 1;
+            value = value < 0 ? 0 : value > 127 ? 127 : value;
+            candidate[c] = value;
+
+            int difference = ((value << 1) | p) - endpoint[c];
+            error += difference * difference;
+        }
+
+        if(bestError < 0 || error < bestError) {
+            bestError = error;
+            pBit = p;
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+inline void encodeBlockBC7(const uint8_t* block, const BlockKernels& kernels, uint8_t* out) {
+    BlockBounds bounds;
+    kernels.bounds(block, bounds);
+
+    int low[4], high[4];
+    insetBounds(bounds, 4, low, high);
+
+    int endpoints[2][4], pBits[2] = {0, 0};
+    quantizeEndpointBC7(low, endpoints[0], pBits[0]);
+    quantizeEndpointBC7(high, endpoints[1], pBits[1]);
+
+    int from[4], to[4];
+
+    for(int c = 0; c < 4; ++c) {
+        from[c] = (endpoints[0][c] << 1) | pBits[0];
+        to[c] = (endpoints[1][c] << 1) | pBits[1];
+    }
+
+    uint8_t q[16];
+    kernels.project(block, from, to, 15, q);
+
+    // the first texel's index is stored with its top bit implied zero
+    if(q[0] >= 8) {
+        for(int c = 0; c < 4; ++c) {
+            std::swap(endpoints[0][c], endpoints[1][c]);
+        }
+
+        std::swap(pBits[0], pBits[1]);
+
+        for(int i = 0; i < 16; ++i) {
+            q[i] = (uint8_t)(15 - q[i]);
+        }
+    }
+
+    memset(out, 0, 16);
+    BlockBitWriter writer{out};
+
+    // mode 6
+    writer.write(1 << 6, 7);
+
+    for(int c = 0; c < 4; ++c) {
+        writer.write(endpoints[0][c], 7);
+        writer.write(endpoints[1][c], 7);
+    }
+
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    writer.write(q[0], 3);
+
+    for(int i = 1; i < 16; ++i) {
+        writer.write(q[i], 4);
+    }
+}
+
+// ---- images ----
+
+// 4x4 texels at (x, y), repeating the last row / column past the edge
+inline void extractBlock(const uint8_t* rgba, int width, int height, int x, int y, uint8_t* block) {
+    for(int row = 0; row < 4; ++row) {
+        int sourceY = y + row < height ? y + row : height - 1;
+
+        for(int column = 0; column < 4; ++column) {
+            int sourceX = x + column < width ? x + column : width - 1;
+            memcpy(block + (row * 4 + column) * 4, rgba + ((size_t)sourceY * width + sourceX) * 4, 4);
+        }
+    }
+}
+
+inline std::vector<uint8_t> compressImage(const uint8_t* rgba, int width, int height, TextureCompression compression, const BlockKernels& kernels) {
+    size_t blockBytes = compressedBlockBytes(compression);
+    int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+
+    std::vector<uint8_t> blocks((size_t)blocksWide * blocksHigh * blockBytes);
+    uint8_t block[64];
+
+    for(int by = 0; by < blocksHigh; ++by) {
+        for(int bx = 0; bx < blocksWide; ++bx) {
+            extractBlock(rgba, width, height, bx * 4, by * 4, block);
+            uint8_t* out = blocks.data() + ((size_t)by * blocksWide + bx) * blockBytes;
+
+            switch(compression) {
+                case TEXTURE_BC1: encodeBlockBC1(block, kernels, out); break;
+                case TEXTURE_BC3: encodeBlockBC3(block, kernels, out); break;
+                default: encodeBlockBC7(block, kernels, out); break;
+            }
+        }
+    }
+
+    return blocks;
+}
+
+struct CompressedLevel {
+    int width, height;
+    size_t offset, size;
+};
+
+struct CompressedTexture {
+    TextureCompression compression = TEXTURE_UNCOMPRESSED;
+    int width = 0, height = 0;
+    // level 0 first; offsets index into data
+    std::vector<CompressedLevel> levels;
+    std::vector<uint8_t> data;
+};
+
+// forceScalar only affects the block encoders; mips come from mipmapGenerator.h
+inline CompressedTexture compressTexture(const uint8_t* rgba, int width, int height, TextureCompression compression, bool mipmaps = true,
+                                         bool forceScalar = false, const MipSettings& mipSettings = MipSettings()) {
+    BlockKernels kernels = blockKernels(forceScalar);
+
+    CompressedTexture texture;
+    texture.compression = compression;
+    texture.width = width;
+    texture.height = height;
+
+    std::vector<uint8_t> blocks = compressImage(rgba, width, height, compression, kernels);
+    texture.levels.push_back({width, height, 0, blocks.size()});
+    texture.data = std::move(blocks);
+
+    if(!mipmaps) {
+        return texture;
+    }
+
+    MipChain chain = generateMipChain(rgba, width, height, 4, mipSettings);
+
+    for(const MipLevel& level : chain.levels) {
+        blocks = compressImage(chain.data.data() + level.offset, level.width, level.height, compression, kernels);
+
+        CompressedLevel info = {level.width, level.height, texture.data.size(), blocks.size()};
+        texture.levels.push_back(info);
+        texture.data.insert(texture.data.end(), blocks.begin(), blocks.end());
+    }
+
+    return texture;
+}
+
+// ---- KTX2 ----
+
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth, pixelHeight, pixelDepth;
+    uint32_t layerCount, faceCount, levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset, dfdByteLength;
+    uint32_t kvdByteOffset, kvdByteLength;
+    uint64_t sgdByteOffset, sgdByteLength;
+};
+
+struct Ktx2Level {
+    uint64_t byteOffset, byteLength, uncompressedByteLength;
+};
+
+static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// basic data format descriptor for a BCn format; required by the spec, ignored on load
+inline std::vector<uint32_t> ktx2Descriptor(TextureCompression compression) {
+    // KHR_DF_MODEL_BC1A / BC3 / BC7
+    uint32_t colorModel = compression == TEXTURE_BC1 ? 128 : compression == TEXTURE_BC3 ? 130 : 134;
+    uint32_t blockBytes = (uint32_t)compressedBlockBytes(compression);
+
+    // BC3 describes its alpha half and colour half as separate samples
+    std::vector<uint32_t> samples;
+
+    if(compression == TEXTURE_BC3) {
+        samples = {(15u << 24) | (63u << 16) | 0u, 0, 0, 0xFFFFFFFF,
+                   (0u << 24) | (63u << 16) | 64u, 0, 0, 0xFFFFFFFF};
+    }
+    else {
+        samples = {(0u << 24) | ((blockBytes * 8 - 1) << 16) | 0u, 0, 0, 0xFFFFFFFF};
+    }
+
+    uint32_t blockSize = 24 + (uint32_t)samples.size() * 4;
+
+    std::vector<uint32_t> words = {
+        4 + blockSize,
+        0,
+        2 | (blockSize << 16),
+        // model, BT.709 primaries, linear transfer, straight alpha
+        colorModel | (1u << 8) | (1u << 16),
+        3 | (3u << 8),
+        blockBytes,
+        0
+    };
+
+    words.insert(words.end(), samples.begin(), samples.end());
+
+    return words;
+}
+
+inline bool writeKtx2(const char* path, const CompressedTexture& texture) {
+    uint32_t levelCount = (uint32_t)texture.levels.size();
+    std::vector<uint32_t> descriptor = ktx2Descriptor(texture.compression);
+
+    Ktx2Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = compressedVkFormat(texture.compression);
+    header.typeSize = 1;
+    header.pixelWidth = texture.width;
+    header.pixelHeight = texture.height;
+    header.faceCount = 1;
+    header.levelCount = levelCount;
+    header.dfdByteOffset = (uint32_t)(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level));
+    header.dfdByteLength = (uint32_t)(descriptor.size() * 4);
+
+    // mip data goes smallest level first, each level aligned to the block size
+    size_t blockBytes = compressedBlockBytes(texture.compression);
+    size_t cursor = header.dfdByteOffset + header.dfdByteLength;
+    std::vector<Ktx2Level> levels(levelCount);
+
+    for(int level = (int)levelCount - 1; level >= 0; --level) {
+        cursor = (cursor + blockBytes - 1) / blockBytes * blockBytes;
+        levels[level].byteOffset = cursor;
+        levels[level].byteLength = texture.levels[level].size;
+        levels[level].uncompressedByteLength = texture.levels[level].size;
+        cursor += texture.levels[level].size;
+    }
+
+    FILE* file = fopen(path, "wb");
+
+    if(!file) {
+        std::cout << "ERROR::KTX2::WRITE_FAILED: " << path << std::endl;
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(levels.data(), sizeof(Ktx2Level), levelCount, file) == levelCount;
+    ok = ok && fwrite(descriptor.data(), 4, descriptor.size(), file) == descriptor.size();
+
+    size_t written = header.dfdByteOffset + header.dfdByteLength;
+    static const uint8_t padding[16] = {};
+
+    for(int level = (int)levelCount - 1; level >= 0 && ok; --level) {
+        size_t gap = levels[level].byteOffset - written;
+        ok = fwrite(padding, 1, gap, file) == gap;
+        ok = ok && fwrite(texture.data.data() + texture.levels[level].offset, 1, texture.levels[level].size, file) == texture.levels[level].size;
+        written = levels[level].byteOffset + levels[level].byteLength;
+    }
+
+    fclose(file);
+
+    if(!ok) {
+        std::cout << "ERROR::KTX2::WRITE_FAILED: " << path << std::endl;
+    }
+
+    return ok;
+}
+
+inline bool readKtx2(const char* path, CompressedTexture& texture) {
+    FILE* file = fopen(path, "rb");
+
+    if(!file) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    std::vector<uint8_t> bytes((size_t)ftell(file));
+    fseek(file, 0, SEEK_SET);
+    bool ok = fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+
+    Ktx2Header header;
+
+    if(!ok || bytes.size() < sizeof(header)) {
+        std::cout << "ERROR::KTX2::TRUNCATED: " << path << std::endl;
+        return false;
+    }
+
+    memcpy(&header, bytes.data(), sizeof(header));
+
+    texture.compression = TEXTURE_UNCOMPRESSED;
+
+    for(TextureCompression compression : {TEXTURE_BC1, TEXTURE_BC3, TEXTURE_BC7}) {
+        if(header.vkFormat == compressedVkFormat(compression)) {
+            texture.compression = compression;
+        }
+    }
+
+    // 2D textures that fit an int, and no more levels than a full mip chain has
+    bool sized = header.pixelWidth > 0 && header.pixelHeight > 0 && header.pixelWidth <= 65536 && header.pixelHeight <= 65536;
+    uint32_t largest = header.pixelWidth > header.pixelHeight ? header.pixelWidth : header.pixelHeight;
+    size_t fullChain = 1;
+
+    while(largest >> fullChain) {
+        fullChain++;
+    }
+
+    size_t levelCount = header.levelCount > 0 ? header.levelCount : 1;
+
+    if(memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 || texture.compression == TEXTURE_UNCOMPRESSED
+        || header.supercompressionScheme != 0 || !sized || levelCount > fullChain || sizeof(header) + levelCount * sizeof(Ktx2Level) > bytes.size()) {
+        std::cout << "ERROR::KTX2::UNSUPPORTED: " << path << " (vkFormat " << header.vkFormat << ")" << std::endl;
+        return false;
+    }
+
+    size_t blockBytes = compressedBlockBytes(texture.compression);
+
+    texture.width = header.pixelWidth;
+    texture.height = header.pixelHeight;
+    texture.levels.clear();
+    texture.data.clear();
+
+    for(size_t level = 0; level < levelCount; ++level) {
+        Ktx2Level index;
+        memcpy(&index, bytes.data() + sizeof(header) + level * sizeof(Ktx2Level), sizeof(index));
+
+        if(index.byteOffset > bytes.size() || index.byteLength > bytes.size() - index.byteOffset) {
+            std::cout << "ERROR::KTX2::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+
+        int width = texture.width >> level, height = texture.height >> level;
+        width = width > 0 ? width : 1;
+        height = height > 0 ? height : 1;
+
+        // glCompressedTexImage2D takes exactly the blocks covering the level
+        size_t levelBytes = (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+
+        if(index.byteLength != levelBytes) {
+            std::cout << "ERROR::KTX2::BAD_LEVEL_SIZE: " << path << " level " << level << " has " << index.byteLength << " bytes, expected " << levelBytes << std::endl;
+            return false;
+        }
+
+        CompressedLevel info = {width, height, texture.data.size(), (size_t)index.byteLength};
+
+        texture.levels.push_back(info);
+        texture.data.insert(texture.data.end(), bytes.begin() + index.byteOffset, bytes.begin() + index.byteOffset + index.byteLength);
+    }
+
+    return true;
+}
+
+// textureCache/<name>-<hash of the full path>.<format>.ktx2
+inline std::string compressedTexturePath(const std::string& sourcePath, TextureCompression compression, bool mipmaps) {
+    uint64_t hash = 14695981039346656037ull;
+
+    for(char c : std::filesystem::absolute(sourcePath).lexically_normal().string()) {
+        hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+    }
+
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), "-%016llx.%s%s.ktx2", (unsigned long long)hash, compressionName(compression), mipmaps ? "" : ".base");
+
+    return std::string(COMPRESSED_TEXTURE_DIR) + "/" + std::filesystem::path(sourcePath).stem().string() + suffix;
+}
+
+// the cached container for sourcePath, if there is one at least as new as the source
+inline bool readCompressedTextureCache(const std::string& sourcePath, TextureCompression compression, bool mipmaps, CompressedTexture& texture) {
+    std::string cachePath = compressedTexturePath(sourcePath, compression, mipmaps);
+    std::error_code error;
+
+    auto cacheTime = std::filesystem::last_write_time(cachePath, error);
+
+    if(error) {
+        return false;
+    }
+
+    auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+
+    if(!error && sourceTime > cacheTime) {
+        return false;
+    }
+
+    return readKtx2(cachePath.c_str(), texture);
+}
+
+inline bool writeCompressedTextureCache(const std::string& sourcePath, bool mipmaps, const CompressedTexture& texture) {
+    std::error_code error;
+    std::filesystem::create_directories(COMPRESSED_TEXTURE_DIR, error);
+
+    // written aside and renamed into place, so a reader never sees half a file
+    std::string cachePath = compressedTexturePath(sourcePath, texture.compression, mipmaps);
+    std::string partialPath = cachePath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".part";
+
+    if(!writeKtx2(partialPath.c_str(), texture)) {
+        std::filesystem::remove(partialPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(partialPath, cachePath, error);
+
+    return !error;
+}
+
+// into an existing texture name; leaves the texture bound
+inline void uploadCompressedTexture(unsigned int name, const CompressedTexture& texture) {
+    GLenum format = compressedGLFormat(texture.compression);
+
+    glBindTexture(GL_TEXTURE_2D, name);
+
+    for(size_t level = 0; level < texture.levels.size(); ++level) {
+        const CompressedLevel& info = texture.levels[level];
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, format, info.width, info.height, 0, (GLsizei)info.size, texture.data.data() + info.offset);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+#endif
@@ -0,0 +1,612 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include "lockFreeQueue.h"
+#include "ringBuffer.h"
+#include "mipmapGenerator.h"
+#include "textureCompression.h"
+
+// Loads textures without blocking the render thread:
+//
+//  1. request() creates the texture object right away with a 2x2 placeholder, so
+//     it can be bound and drawn with immediately, and queues the file for decoding.
+//  2. Worker threads read and decode the file with stb_image and hand the pixels to
+//     the GL thread through a LockFreeQueue.
+//  3. update(), called once per frame on the GL thread, copies at most frameBudget
+//     bytes of rows into a pixel unpack buffer (a StreamRingBuffer on
+//     GL_PIXEL_UNPACK_BUFFER) and issues glTexSubImage2D from it into a staging
+//     texture, so large images are spread over several frames. Mip levels are built
+//     on the worker too (mipmapGenerator.h) and follow level 0 through the same
+//     buffer. The placeholder stays untouched meanwhile; when the last rows are in,
+//     the staging levels are copied over it on the GPU (glCopyImageSubData, or a read
+//     framebuffer without it) and the texture changes under the same name at once.
+//
+// With compression set, workers instead read the texture's BCn KTX2 from
+// textureCache/ (or decode, compress and write it when missing or older than the
+// source) and update() hands the whole precompressed mip chain to
+// glCompressedTexImage2D, still within frameBudget.
+//
+// stb_image.h has to be included before this header, and its implementation compiled
+// into one translation unit as usual; including it here again would compile the
+// implementation twice in the file that defines STB_IMAGE_IMPLEMENTATION.
+
+struct DecodedImage {
+    unsigned int texture = 0;
+    std::string path;
+    unsigned char* pixels = nullptr;
+    int width = 0, height = 0, channels = 0;
+    bool mipmaps = true;
+    double decodeMs = 0.0;
+    bool cpuMipmaps = true;
+    MipSettings mipSettings;
+    // levels 1 and up when cpuMipmaps is on
+    std::shared_ptr<MipChain> mips;
+    TextureCompression compression = TEXTURE_UNCOMPRESSED;
+    // set instead of pixels when compression is on
+    std::shared_ptr<CompressedTexture> compressed;
+    // why decoding failed; stb_image only reports it on the thread that decoded
+    std::string error;
+};
+
+struct TextureStreamStats {
+    unsigned int requested = 0;
+    unsigned int completed = 0;
+    unsigned int failed = 0;
+    size_t bytesUploaded = 0;
+    // frames update() uploaded anything in, and decode time summed over workers
+    unsigned int uploadFrames = 0;
+    double decodeMs = 0.0;
+};
+
+inline GLenum textureFormatForChannels(int channels) {
+    switch(channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 4: return GL_RGBA;
+        default: return GL_RGB;
+    }
+}
+
+class TextureStreamer {
+    public:
+    size_t frameBudget = 4 * 1024 * 1024;
+    TextureStreamStats stats;
+
+    // these apply to later requests; check compressionSupported() on the GL thread first
+    TextureCompression compression = TEXTURE_UNCOMPRESSED;
+    // mips built by the workers rather than glGenerateMipmap, and how they are filtered
+    bool cpuMipmaps = true;
+    MipSettings mipSettings;
+
+    // called on the GL thread when a texture's real contents are in place, with the
+    // bytes it occupies on the GPU (mip chain included)
+    std::function<void(unsigned int texture, size_t bytes)> onUploaded;
+    // called on the GL thread when a texture couldn't be loaded; it keeps the placeholder
+    std::function<void(unsigned int texture)> onFailed;
+
+    TextureStreamer() : decoded(256) {}
+
+    ~TextureStreamer() {
+        stopWorkers();
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // workerCount 0 uses one thread per core, leaving one for the render thread
+    void start(unsigned int workerCount = 0, size_t bytesPerFrame = 4 * 1024 * 1024) {
+        frameBudget = bytesPerFrame;
+        pixelRing.create(GL_PIXEL_UNPACK_BUFFER, frameBudget);
+        copyImage = GLEW_VERSION_4_3 || GLEW_ARB_copy_image;
+
+        if(workerCount == 0) {
+            unsigned int cores = std::thread::hardware_concurrency();
+            workerCount = cores > 1 ? cores - 1 : 1;
+        }
+
+        stopping = false;
+
+        for(unsigned int i = 0; i < workerCount; ++i) {
+            workers.emplace_back(&TextureStreamer::work, this);
+        }
+    }
+
+    // a texture name usable right away; its contents arrive over the next frames
+    unsigned int request(const std::string& path, bool mipmaps = true) {
+        static const unsigned char placeholder[] = {
+            255, 0, 255, 255,   40, 40, 40, 255,
+            40, 40, 40, 255,    255, 0, 255, 255
+        };
+
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+
+        DecodedImage job;
+        job.path = path;
+        job.mipmaps = mipmaps;
+        job.compression = compression;
+        job.cpuMipmaps = cpuMipmaps;
+        job.mipSettings = mipSettings;
+
+        glGenTextures(1, &job.texture);
+        glBindTexture(GL_TEXTURE_2D, job.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+
+        unsigned int texture = job.texture;
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            jobs.push_back(std::move(job));
+        }
+
+        jobReady.notify_one();
+        stats.requested++;
+
+        return texture;
+    }
+
+    // GL thread, once per frame
+    void update() {
+        DecodedImage image;
+
+        while(decoded.pop(image)) {
+            stats.decodeMs += image.decodeMs;
+
+            if(!image.pixels && !image.compressed) {
+                std::cout << "ERROR::TEXTURE_STREAMER::DECODE_FAILED: " << image.path << " (" << image.error << ")" << std::endl;
+                fail(image.texture);
+                continue;
+            }
+
+            if(image.compressed) {
+                compressedUploads.push_back(image);
+                continue;
+            }
+
+            if((size_t)image.width * image.channels > pixelRing.regionSize) {
+                std::cout << "ERROR::TEXTURE_STREAMER::ROW_EXCEEDS_BUDGET: " << image.path << std::endl;
+                stbi_image_free(image.pixels);
+                fail(image.texture);
+                continue;
+            }
+
+            Upload upload;
+            upload.image = image;
+            uploads.push_back(upload);
+        }
+
+        size_t budgetLeft = uploadCompressed(pixelRing.regionSize);
+        bool uploadedCompressed = budgetLeft < pixelRing.regionSize;
+
+        if(uploads.empty()) {
+            stats.uploadFrames += uploadedCompressed ? 1 : 0;
+            return;
+        }
+
+        GLint previousTexture = 0, previousAlignment = 4;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+
+        // rows are tightly packed, whatever the width and channel count
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        pixelRing.beginFrame();
+
+        std::vector<Band> bands;
+        std::vector<Upload> finished;
+
+        while(!uploads.empty()) {
+            Upload& upload = uploads.front();
+            const DecodedImage& source = upload.image;
+
+            int levelWidth, levelHeight;
+            const unsigned char* levelPixels = imageLevel(source, upload.level, levelWidth, levelHeight);
+            size_t rowBytes = (size_t)levelWidth * source.channels;
+
+            // up to 3 bytes of alignment padding per allocation
+            size_t rows = budgetLeft > 3 ? (budgetLeft - 3) / rowBytes : 0;
+            rows = rows < (size_t)(levelHeight - upload.nextRow) ? rows : (size_t)(levelHeight - upload.nextRow);
+
+            if(rows == 0) {
+                break;
+            }
+
+            RingAllocation allocation = pixelRing.allocate(rows * rowBytes, 4);
+
+            if(!allocation.pointer) {
+                break;
+            }
+
+            // size the staging level before its first rows; no unpack buffer is bound yet
+            if(upload.nextRow == 0) {
+                GLenum format = textureFormatForChannels(source.channels);
+
+                if(upload.staging == 0) {
+                    glGenTextures(1, &upload.staging);
+                }
+
+                glBindTexture(GL_TEXTURE_2D, upload.staging);
+                glTexImage2D(GL_TEXTURE_2D, upload.level, format, levelWidth, levelHeight, 0, format, GL_UNSIGNED_BYTE, NULL);
+            }
+
+            memcpy(allocation.pointer, levelPixels + upload.nextRow * rowBytes, allocation.size);
+
+            Band band;
+            band.texture = upload.staging;
+            band.channels = source.channels;
+            band.level = upload.level;
+            band.width = levelWidth;
+            band.firstRow = upload.nextRow;
+            band.rows = (int)rows;
+            band.offset = allocation.offset;
+            bands.push_back(band);
+
+            upload.nextRow += (int)rows;
+            budgetLeft -= allocation.size + 3;
+            stats.bytesUploaded += allocation.size;
+
+            if(upload.nextRow < levelHeight) {
+                break;
+            }
+
+            if(upload.level + 1 < levelCount(source)) {
+                upload.level++;
+                upload.nextRow = 0;
+                continue;
+            }
+
+            finished.push_back(upload);
+            uploads.pop_front();
+        }
+
+        pixelRing.flush();
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelRing.buffer);
+
+        for(const Band& band : bands) {
+            glBindTexture(GL_TEXTURE_2D, band.texture);
+            glTexSubImage2D(GL_TEXTURE_2D, band.level, 0, band.firstRow, band.width, band.rows, textureFormatForChannels(band.channels), GL_UNSIGNED_BYTE, (void*)band.offset);
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        pixelRing.endFrame();
+
+        for(Upload& upload : finished) {
+            DecodedImage& source = upload.image;
+
+            replacePlaceholder(upload);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            if(source.mips) {
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount(source) - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            }
+            else if(source.mipmaps) {
+                glGenerateMipmap(GL_TEXTURE_2D);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            }
+            else {
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            }
+
+            stbi_image_free(source.pixels);
+            stats.completed++;
+
+            if(onUploaded) {
+                size_t bytes = (size_t)source.width * source.height * source.channels;
+                onUploaded(source.texture, source.mips ? bytes + source.mips->data.size() : source.mipmaps ? bytes * 4 / 3 : bytes);
+            }
+        }
+
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+
+        if(!bands.empty() || uploadedCompressed) {
+            stats.uploadFrames++;
+        }
+    }
+
+    // requests not yet uploaded (or failed)
+    bool busy() const {
+        return stats.completed + stats.failed < stats.requested;
+    }
+
+    // block until everything requested is resident, e.g. behind a loading screen
+    void finish() {
+        while(busy()) {
+            update();
+            std::this_thread::yield();
+        }
+    }
+
+    // needs the GL context; the destructor only joins the workers
+    void stop() {
+        stopWorkers();
+
+        DecodedImage image;
+
+        while(decoded.pop(image)) {
+            stbi_image_free(image.pixels);
+        }
+
+        for(Upload& upload : uploads) {
+            stbi_image_free(upload.image.pixels);
+
+            if(upload.staging) {
+                glDeleteTextures(1, &upload.staging);
+            }
+        }
+
+        if(copyFramebuffer) {
+            glDeleteFramebuffers(1, &copyFramebuffer);
+            copyFramebuffer = 0;
+        }
+
+        uploads.clear();
+        compressedUploads.clear();
+        pixelRing.destroy();
+    }
+
+    private:
+    struct Upload {
+        DecodedImage image;
+        // where the rows go until the whole image is in
+        unsigned int staging = 0;
+        int level = 0;
+        int nextRow = 0;
+    };
+
+    // rows of one image level copied into the unpack buffer this frame; by value, since
+    // the upload they came from may finish and leave the deque in the same frame
+    struct Band {
+        unsigned int texture = 0;
+        int channels = 0;
+        int level = 0;
+        int width = 0;
+        int firstRow = 0;
+        int rows = 0;
+        size_t offset = 0;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::condition_variable jobReady;
+    std::deque<DecodedImage> jobs;
+    std::atomic<bool> stopping{false};
+
+    LockFreeQueue<DecodedImage> decoded;
+
+    // GL thread only
+    std::deque<Upload> uploads;
+    std::deque<DecodedImage> compressedUploads;
+    StreamRingBuffer pixelRing;
+    bool copyImage = false;
+    // read side of the copy when glCopyImageSubData is missing
+    unsigned int copyFramebuffer = 0;
+
+    void work() {
+        for(;;) {
+            DecodedImage job;
+
+            {
+                std::unique_lock<std::mutex> lock(jobMutex);
+                jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+                if(stopping) {
+                    return;
+                }
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            auto start = std::chrono::steady_clock::now();
+
+            if(job.compression != TEXTURE_UNCOMPRESSED) {
+                loadCompressed(job);
+            }
+            else {
+                job.pixels = stbi_load(job.path.c_str(), &job.width, &job.height, &job.channels, 0);
+
+                if(!job.pixels) {
+                    job.error = decodeFailureReason();
+                }
+                else if(job.mipmaps && job.cpuMipmaps) {
+                    job.mips = std::make_shared<MipChain>(generateMipChain(job.pixels, job.width, job.height, job.channels, job.mipSettings));
+                }
+            }
+
+            job.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            // the queue only fills up if the GL thread stops calling update()
+            while(!decoded.push(job)) {
+                std::this_thread::yield();
+
+                if(stopping) {
+                    stbi_image_free(job.pixels);
+                    return;
+                }
+            }
+        }
+    }
+
+    // worker thread, right after the failed stbi_load
+    static std::string decodeFailureReason() {
+        const char* reason = stbi_failure_reason();
+        return reason ? reason : "unknown";
+    }
+
+    // GL thread, no unpack buffer bound: size the real levels and copy the staging ones
+    // over them, then drop the staging texture; leaves the real texture bound
+    void replacePlaceholder(Upload& upload) {
+        const DecodedImage& source = upload.image;
+        GLenum format = textureFormatForChannels(source.channels);
+        int levels = levelCount(source);
+
+        glBindTexture(GL_TEXTURE_2D, source.texture);
+
+        for(int level = 0; level < levels; ++level) {
+            int width, height;
+            imageLevel(source, level, width, height);
+            glTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+        }
+
+        GLint previousFramebuffer = 0;
+
+        if(!copyImage) {
+            if(copyFramebuffer == 0) {
+                glGenFramebuffers(1, &copyFramebuffer);
+            }
+
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, copyFramebuffer);
+        }
+
+        for(int level = 0; level < levels; ++level) {
+            int width, height;
+            imageLevel(source, level, width, height);
+
+            if(copyImage) {
+                glCopyImageSubData(upload.staging, GL_TEXTURE_2D, level, 0, 0, 0, source.texture, GL_TEXTURE_2D, level, 0, 0, 0, width, height, 1);
+            }
+            else {
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, upload.staging, level);
+                glCopyTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, 0, 0, width, height);
+            }
+        }
+
+        if(!copyImage) {
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)previousFramebuffer);
+        }
+
+        glDeleteTextures(1, &upload.staging);
+        upload.staging = 0;
+    }
+
+    static int levelCount(const DecodedImage& image) {
+        return image.mips ? 1 + (int)image.mips->levels.size() : 1;
+    }
+
+    static const unsigned char* imageLevel(const DecodedImage& image, int level, int& width, int& height) {
+        if(level == 0) {
+            width = image.width;
+            height = image.height;
+            return image.pixels;
+        }
+
+        const MipLevel& info = image.mips->levels[level - 1];
+        width = info.width;
+        height = info.height;
+
+        return image.mips->data.data() + info.offset;
+    }
+
+    // worker thread: the cached container, or decode + compress + cache
+    static void loadCompressed(DecodedImage& job) {
+        auto texture = std::make_shared<CompressedTexture>();
+
+        if(!readCompressedTextureCache(job.path, job.compression, job.mipmaps, *texture)) {
+            unsigned char* pixels = stbi_load(job.path.c_str(), &job.width, &job.height, &job.channels, 4);
+
+            if(!pixels) {
+                job.error = decodeFailureReason();
+                return;
+            }
+
+            *texture = compressTexture(pixels, job.width, job.height, job.compression, job.mipmaps, false, job.mipSettings);
+            stbi_image_free(pixels);
+
+            writeCompressedTextureCache(job.path, job.mipmaps, *texture);
+        }
+
+        job.width = texture->width;
+        job.height = texture->height;
+        job.compressed = texture;
+    }
+
+    // GL thread: whole compressed mip chains, from client memory since they are a
+    // quarter to an eighth of the raw size; at least one per frame. Returns the budget left.
+    size_t uploadCompressed(size_t budgetLeft) {
+        if(compressedUploads.empty()) {
+            return budgetLeft;
+        }
+
+        GLint previousTexture = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+
+        bool first = true;
+
+        while(!compressedUploads.empty()) {
+            DecodedImage& image = compressedUploads.front();
+            size_t bytes = image.compressed->data.size();
+
+            if(!first && bytes > budgetLeft) {
+                break;
+            }
+
+            uploadCompressedTexture(image.texture, *image.compressed);
+
+            budgetLeft = bytes < budgetLeft ? budgetLeft - bytes : 0;
+            stats.bytesUploaded += bytes;
+            stats.completed++;
+            first = false;
+
+            if(onUploaded) {
+                onUploaded(image.texture, bytes);
+            }
+
+            compressedUploads.pop_front();
+        }
+
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+
+        return budgetLeft;
+    }
+
+    void fail(unsigned int texture) {
+        stats.failed++;
+
+        if(onFailed) {
+            onFailed(texture);
+        }
+    }
+
+    void stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            stopping = true;
+        }
+
+        jobReady.notify_all();
+
+        for(std::thread& worker : workers) {
+            worker.join();
+        }
+
+        workers.clear();
+    }
+};
+
+inline void printTextureStreamStats(const TextureStreamStats& stats) {
+    std::cout << "TEXTURE::STREAM: " << stats.completed << "/" << stats.requested << " texture(s), " << stats.failed << " failed, "
+              << stats.bytesUploaded << " bytes over " << stats.uploadFrames << " frame(s), " << stats.decodeMs << " ms decoding on workers" << std::endl;
+}
+
+#endif
@@ -6,7 +6,17 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include "shader.h"
+#include "shaderLibrary.h"
+#include "shaderWatcher.h"
+#include "cameraBuffer.h"
+#include "instancing.h"
+#include "drawIndirect.h"
+#include "cubeMesh.h"
+#include "meshOptimizer.h"
+#include "vertexLayout.h"
+#include "textureCache.h"
+#include "frustumCulling.h"
+#include "glState.h"
 
 // make sure the viewport matches the new window dimensions; note that width and 
 // height will be significantly larger than specified on retina displays.
@@ -59,23 +69,6 @@ void initGL(GLFWwindow* window) {
     }
 }
 
-void genVertexandBuffers(unsigned int* VAO, unsigned int* VBO) {
-    glGenVertexArrays(1, VAO);
-    glGenBuffers(1, VBO);
-    // glGenBuffers(1, EBO);
-}
-
-void handleBufferObject(unsigned int VBO, float* vertices, float size) {
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_DYNAMIC_DRAW);
-}
-
-void handleVertexObject(unsigned int VAO) {
-    glBindVertexArray(VAO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), nullptr);
-    glEnableVertexAttribArray(0);
-}
-
 void cleanupBuffers() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
@@ -95,90 +88,49 @@ int main() {
 
     initGL(window);
 
-    Shader myShader("vertexShader.glsl", "fragmentShader.glsl");
-
-    // float vertices[] = {
-    //     -0.5f, -0.5f, 0.0f, 0.0f, 0.0f,
-    //     0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
-    //     -0.5f, 0.5f, 0.0f, 0.0f, 1.0f,
-    //     0.5f, 0.5f, 0.0f, 1.0f, 1.0f,
-    // };
-
-    float vertices[] = {
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-        0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-    };
-
-    // unsigned int indices[] = {
-    //     0, 1, 2,
-    //     1, 2, 3
-    // };
-
-    float verticesSize = sizeof(vertices);
+    // programs are submitted here and finish compiling while the buffers and texture load below
+    ShaderLibrary shaders;
+    std::vector<ShaderFile> shaderFiles = loadShaderFiles({"vertexShader.glsl", "fragmentShader.glsl"});
+    shaders.add("cube", std::move(shaderFiles[0]), std::move(shaderFiles[1]), {{"INSTANCED", ""}});
 
-    unsigned int VAO, VBO, TBO;
+    // weld the 36 cube corners into shared vertices, ordered for the vertex cache
+    std::vector<float> cubeMeshVertices;
+    std::vector<uint32_t> cubeIndices;
+    buildOptimizedMesh("cube", cubeVertices, CUBE_VERTEX_COUNT, CUBE_VERTEX_STRIDE / sizeof(float), cubeMeshVertices, cubeIndices);
 
-    genVertexandBuffers(&VAO, &VBO);
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    // glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW); 
+    // 12 bytes per vertex instead of 20: int16 positions inside the cube's bounds and 16-bit uvs
+    VertexFormat cubeFormat;
+    cubeFormat.position = POSITION_SNORM16;
+    cubeFormat.uv = UV_UNORM16;
 
-    handleBufferObject(VBO, vertices, verticesSize);
+    PackedVertices packedCube = packVertices(cubeMeshVertices.data(), cubeMeshVertices.size() / 5, 5, cubeFormat);
 
-    handleVertexObject(VAO);
+    unsigned int TBO;
 
-    int textureWidth, textureHeight, numberOfChannels;
+    // meshes of this vertex format share one VAO and one vertex and index buffer, so
+    // drawing several of them is one DrawCommandBuffer submission instead of a VAO each
+    MeshPool meshes;
+    meshes.create(packedCube.layout, 4096, 16384);
+    MeshHandle cube = meshes.add(packedCube.data.data(), packedCube.vertexCount, cubeIndices.data(), cubeIndices.size());
 
-    stbi_uc* imageData = stbi_load("wall.jpg", &textureWidth, &textureHeight, &numberOfChannels, 0);
+    DrawCommandBuffer draws;
+    draws.create();
 
-    glGenTextures(1, &TBO);
-    glBindTexture(GL_TEXTURE_2D, TBO);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, imageData);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(imageData);
+    // wall.jpg decodes on a worker; TBO shows a placeholder until update() has uploaded it
+    // and, where the driver takes S3TC, is stored as BC1 in textureCache/ after the first run
+    TextureStreamer textureStreamer;
+    textureStreamer.compression = compressionSupported(TEXTURE_BC1) ? TEXTURE_BC1 : TEXTURE_UNCOMPRESSED;
+    textureStreamer.start();
+    TextureCache textures(textureStreamer);
+    TBO = textures.acquire("wall.jpg");
 
     cleanupBuffers();
 
+    shaders.finishAll();
+    printShaderLoadStats();
+    printProgramCacheStats();
+
+    Shader& myShader = shaders.get("cube");
     myShader.use();
 
     // glm::mat4 transformationMatrix = glm::mat4(1.0f);
@@ -217,7 +169,49 @@ int main() {
         glm::vec3(-1.3f,  1.0f, -1.5f)  
     };
 
+    // every cube is drawn by one instanced call; model matrices go through the instance buffer
+    const unsigned int cubeCount = sizeof(cubePositions) / sizeof(cubePositions[0]);
+    glm::mat4 cubeModels[cubeCount];
+
+    InstanceBuffer instances;
+    instances.create();
+    instances.attach(meshes.VAO);
+
+    // cubes rotate in place, so a sphere around the unit cube bounds them in any orientation
+    BoundingSphereSoA cubeBounds;
+
+    for(unsigned int i = 0; i < cubeCount; ++i) {
+        cubeBounds.push(cubePositions[i], 0.8660254f);
+    }
+
+    std::vector<uint32_t> visibleCubes;
+    std::vector<glm::mat4> visibleModels;
+
+    // view and projection live in the shared Camera uniform block
+    CameraBuffer camera;
+    camera.create();
+
+    unsigned int setupNameLookups = myShader.uniformNameLookups;
+    unsigned int setupLocationQueries = myShader.uniformLocationQueries;
+
+    // edits to the .glsl files are recompiled in the background and swapped in between frames
+    ShaderWatcher shaderWatcher;
+    shaderWatcher.watch(myShader);
+
+    // per-frame program, texture and VAO binds only reach the driver when they change,
+    // e.g. when the watcher swaps in a rebuilt program
+    GLState glState;
+
     while(!glfwWindowShouldClose(window)) {
+        glState.beginFrame();
+
+        if(shaderWatcher.update()) {
+            setupNameLookups = myShader.uniformNameLookups;
+            setupLocationQueries = myShader.uniformLocationQueries;
+        }
+
+        textures.update();
+
         glClearColor(0.3f, 0.4f, 0.6f, 1.0f);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -226,34 +220,51 @@ int main() {
         // glm::mat4 model = glm::mat4(1.0f);
         // model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));  
         // glUniformMatrix4fv(glGetUniformLocation(myShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(myShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(myShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        camera.update(view, projection);
 
-        // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBindTexture(GL_TEXTURE_2D, TBO);
-        glBindVertexArray(VAO);
+        glState.useProgram(myShader);
+        glState.bindTexture(0, GL_TEXTURE_2D, TBO);
+        glState.bindVertexArray(meshes.VAO);
 
-        for(unsigned int i = 0; i < 10; ++i) {
+        for(unsigned int i = 0; i < cubeCount; ++i) {
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::translate(model, cubePositions[i]);
             
             if(i == 0) {
                 model = glm::rotate(model, (float)glfwGetTime() * -1, glm::vec3(1.0f, 1.0f, 1.0f));
-                glUniformMatrix4fv(glGetUniformLocation(myShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
             }
             else {
                 float angle = 20.0f * i;
                 model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-
-                glUniformMatrix4fv(glGetUniformLocation(myShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
             }
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            // positions are stored relative to the cube's bounds
+            cubeModels[i] = model * packedCube.dequantize;
+        }
+
+        // only cubes inside the view frustum go to the GPU
+        cullSpheres(extractFrustum(projection * view), cubeBounds, visibleCubes);
+
+        visibleModels.clear();
+
+        for(uint32_t index : visibleCubes) {
+            visibleModels.push_back(cubeModels[index]);
         }
 
+        instances.upload(visibleModels);
+        instances.bindAttributes();
+
+        draws.clear();
+        draws.add(meshes.range(cube), (unsigned int)instances.count);
+        draws.submit(glState, meshes);
+
+        instances.endFrame();
+
         // glDrawArrays(GL_TRIANGLES, 0, 36);
         // glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
+        glState.endFrame();
+
         processInput(window);
 
         glfwSwapBuffers(window);
@@ -261,9 +272,21 @@ int main() {
         glfwPollEvents();
     }
 
-    glDeleteBuffers(1, &VBO);
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteTextures(1, &TBO);
+    std::cout << "SHADER::UNIFORM_LOOKUPS_IN_LOOP: " << (myShader.uniformNameLookups - setupNameLookups)
+              << " name, " << (myShader.uniformLocationQueries - setupLocationQueries) << " glGetUniformLocation" << std::endl;
+
+    printGLStateStats(glState);
+
+    draws.destroy();
+    meshes.destroy();
+    printTextureStreamStats(textureStreamer.stats);
+    printTextureCacheStats(textures.stats);
+    textureStreamer.stop();
+
+    textures.release(TBO);
+    textures.destroy();
+    instances.destroy();
+    camera.destroy();
     glDeleteProgram(myShader.shaderProgram);
 
     glfwDestroyWindow(window);
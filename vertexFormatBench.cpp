@@ -0,0 +1,153 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "vertexLayout.h"
+
+// Memory and upload time of a 4M vertex mesh (position, uv, normal) per vertex format,
+// plus the largest position error the format introduces.
+
+const int GRID_SIZE = 2048;
+const int UPLOAD_ITERATIONS = 10;
+
+struct Format {
+    const char* name;
+    VertexFormat format;
+};
+
+// a bumpy height field, so positions, uvs and normals all vary
+std::vector<float> makeTerrain() {
+    std::vector<float> vertices;
+    vertices.reserve((size_t)GRID_SIZE * GRID_SIZE * 8);
+
+    for(int y = 0; y < GRID_SIZE; ++y) {
+        for(int x = 0; x < GRID_SIZE; ++x) {
+            float u = x / (float)(GRID_SIZE - 1);
+            float v = y / (float)(GRID_SIZE - 1);
+            float height = std::sin(u * 40.0f) * std::cos(v * 30.0f) * 8.0f;
+
+            glm::vec3 normal = glm::normalize(glm::vec3(-std::cos(u * 40.0f) * std::cos(v * 30.0f) * 320.0f / 500.0f, 1.0f,
+                                                         std::sin(u * 40.0f) * std::sin(v * 30.0f) * 240.0f / 500.0f));
+
+            vertices.insert(vertices.end(), {u * 500.0f - 250.0f, height, v * 500.0f - 250.0f, u, v, normal.x, normal.y, normal.z});
+        }
+    }
+
+    return vertices;
+}
+
+float unpackComponent(const unsigned char* data, const VertexAttribute& attribute, int component) {
+    if(attribute.type == GL_FLOAT) {
+        float value;
+        memcpy(&value, data + attribute.offset + component * 4, 4);
+        return value;
+    }
+
+    uint16_t bits;
+    memcpy(&bits, data + attribute.offset + component * 2, 2);
+
+    return attribute.type == GL_HALF_FLOAT ? glm::unpackHalf1x16(bits) : glm::unpackSnorm1x16(bits);
+}
+
+float maxPositionError(const std::vector<float>& source, const PackedVertices& packed) {
+    float error = 0.0f;
+
+    for(size_t i = 0; i < packed.vertexCount; ++i) {
+        const unsigned char* vertex = packed.data.data() + i * packed.layout.stride;
+        glm::vec4 stored(unpackComponent(vertex, packed.layout.attributes[0], 0), unpackComponent(vertex, packed.layout.attributes[0], 1),
+                         unpackComponent(vertex, packed.layout.attributes[0], 2), 1.0f);
+        glm::vec3 decoded = glm::vec3(packed.dequantize * stored);
+
+        error = glm::max(error, glm::length(decoded - glm::vec3(source[i * 8], source[i * 8 + 1], source[i * 8 + 2])));
+    }
+
+    return error;
+}
+
+double uploadMs(const PackedVertices& packed) {
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    glBufferData(GL_ARRAY_BUFFER, packed.data.size(), packed.data.data(), GL_STATIC_DRAW);
+    glFinish();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < UPLOAD_ITERATIONS; ++i) {
+        glBufferData(GL_ARRAY_BUFFER, packed.data.size(), packed.data.data(), GL_STATIC_DRAW);
+    }
+
+    glFinish();
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / UPLOAD_ITERATIONS;
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(1, &VBO);
+
+    return ms;
+}
+
+int main() {
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Vertex format benchmark", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    std::vector<float> terrain = makeTerrain();
+    size_t vertexCount = terrain.size() / 8;
+
+    Format formats[3];
+    formats[0].name = "float";
+    formats[0].format.packedNormals = false;
+    formats[1].name = "half";
+    formats[1].format.position = POSITION_HALF;
+    formats[1].format.uv = UV_HALF;
+    formats[2].name = "snorm16";
+    formats[2].format.position = POSITION_SNORM16;
+    formats[2].format.uv = UV_UNORM16;
+
+    double floatUploadMs = 0.0;
+
+    std::cout << vertexCount << " vertices" << std::endl;
+    std::cout << "format     bytes/vertex   MB       pack ms   upload ms   upload speedup   max position error" << std::endl;
+
+    for(const Format& format : formats) {
+        auto start = std::chrono::steady_clock::now();
+        PackedVertices packed = packVertices(terrain.data(), vertexCount, 8, format.format);
+        double packMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        double ms = uploadMs(packed);
+        floatUploadMs = floatUploadMs > 0.0 ? floatUploadMs : ms;
+
+        printf("%-10s %-14d %-8.1f %-9.1f %-11.2f %-16.2f %g\n", format.name, packed.layout.stride, packed.data.size() / (1024.0 * 1024.0),
+               packMs, ms, floatUploadMs / ms, maxPositionError(terrain, packed));
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
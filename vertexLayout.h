@@ -0,0 +1,224 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cfloat>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+// Vertex layout descriptors and compact vertex formats.
+//
+// A VertexLayout lists the attributes of one interleaved vertex with their GL component
+// type and normalisation; apply() issues the matching glVertexAttribPointer calls.
+//
+// packVertices() converts the renderer's float vertices (position 3, uv 2, optionally
+// normal 3) into smaller formats:
+//
+//   positions  half float or normalised int16, both relative to the mesh bounding box:
+//              the mesh is stored in [-1, 1]^3 and PackedVertices::dequantize maps it
+//              back, so it has to be folded into the model matrix
+//   uvs        half float or normalised uint16 (only for uvs inside [0, 1])
+//   normals    GL_INT_2_10_10_10_REV, normalised
+//
+// Every attribute starts on a 4 byte boundary, as GL implementations prefer.
+
+struct VertexAttribute {
+    unsigned int location;
+    int size;
+    size_t offset;
+    GLenum type = GL_FLOAT;
+    bool normalized = false;
+};
+
+// normals come after the four instance matrix columns (locations 2-5)
+const unsigned int VERTEX_NORMAL_LOCATION = 6;
+
+inline size_t vertexAttributeBytes(int size, GLenum type) {
+    switch(type) {
+        case GL_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+            return 4;
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return size;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return size * 2;
+        default:
+            return size * 4;
+    }
+}
+
+class VertexLayout {
+    public:
+    int stride = 0;
+    std::vector<VertexAttribute> attributes;
+
+    // append an attribute after the previous one
+    VertexLayout& add(unsigned int location, int size, GLenum type = GL_FLOAT, bool normalized = false) {
+        VertexAttribute attribute;
+        attribute.location = location;
+        attribute.size = size;
+        attribute.offset = stride;
+        attribute.type = type;
+        attribute.normalized = normalized;
+
+        attributes.push_back(attribute);
+
+        stride += (int)((vertexAttributeBytes(size, type) + 3) / 4 * 4);
+
+        return *this;
+    }
+
+    // describe the vertex buffer bound to GL_ARRAY_BUFFER in the currently bound VAO
+    void apply() const {
+        for(const VertexAttribute& attribute : attributes) {
+            glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE, stride, (void*)attribute.offset);
+            glEnableVertexAttribArray(attribute.location);
+        }
+    }
+};
+
+// position (3 floats) + uv (2 floats), the layout of cubeMesh.h and the OBJ importer
+inline VertexLayout positionUvLayout() {
+    return VertexLayout().add(0, 3).add(1, 2);
+}
+
+enum PositionFormat { POSITION_FLOAT, POSITION_HALF, POSITION_SNORM16 };
+enum UvFormat { UV_FLOAT, UV_HALF, UV_UNORM16 };
+
+struct VertexFormat {
+    PositionFormat position = POSITION_FLOAT;
+    UvFormat uv = UV_FLOAT;
+    // only used when the source vertices have normals
+    bool packedNormals = true;
+};
+
+struct PackedVertices {
+    std::vector<unsigned char> data;
+    VertexLayout layout;
+    size_t vertexCount = 0;
+    // stored position -> original position
+    glm::mat4 dequantize = glm::mat4(1.0f);
+};
+
+// source vertices are position, uv and, when floatsPerVertex is 8, normal
+inline PackedVertices packVertices(const float* vertices, size_t vertexCount, int floatsPerVertex, VertexFormat format) {
+    PackedVertices packed;
+    packed.vertexCount = vertexCount;
+
+    bool hasNormals = floatsPerVertex >= 8;
+
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    float uvMin = FLT_MAX, uvMax = -FLT_MAX;
+
+    for(size_t i = 0; i < vertexCount; ++i) {
+        const float* vertex = vertices + i * floatsPerVertex;
+
+        boundsMin = glm::min(boundsMin, glm::vec3(vertex[0], vertex[1], vertex[2]));
+        boundsMax = glm::max(boundsMax, glm::vec3(vertex[0], vertex[1], vertex[2]));
+
+        uvMin = glm::min(uvMin, glm::min(vertex[3], vertex[4]));
+        uvMax = glm::max(uvMax, glm::max(vertex[3], vertex[4]));
+    }
+
+    if(format.uv == UV_UNORM16 && vertexCount > 0 && (uvMin < 0.0f || uvMax > 1.0f)) {
+        std::cout << "ERROR::VERTEX_LAYOUT::UV_OUT_OF_RANGE: uvs span [" << uvMin << ", " << uvMax << "], storing half floats instead" << std::endl;
+        format.uv = UV_HALF;
+    }
+
+    glm::vec3 center(0.0f), halfExtent(1.0f);
+
+    if(format.position != POSITION_FLOAT && vertexCount > 0) {
+        center = (boundsMin + boundsMax) * 0.5f;
+        halfExtent = (boundsMax - boundsMin) * 0.5f;
+
+        // flat meshes: any scale works on an axis that is all zeros
+        for(int axis = 0; axis < 3; ++axis) {
+            halfExtent[axis] = halfExtent[axis] > 0.0f ? halfExtent[axis] : 1.0f;
+        }
+
+        packed.dequantize = glm::scale(glm::translate(glm::mat4(1.0f), center), halfExtent);
+    }
+
+    switch(format.position) {
+        case POSITION_FLOAT: packed.layout.add(0, 3, GL_FLOAT); break;
+        case POSITION_HALF: packed.layout.add(0, 3, GL_HALF_FLOAT); break;
+        case POSITION_SNORM16: packed.layout.add(0, 3, GL_SHORT, true); break;
+    }
+
+    switch(format.uv) {
+        case UV_FLOAT: packed.layout.add(1, 2, GL_FLOAT); break;
+        case UV_HALF: packed.layout.add(1, 2, GL_HALF_FLOAT); break;
+        case UV_UNORM16: packed.layout.add(1, 2, GL_UNSIGNED_SHORT, true); break;
+    }
+
+    if(hasNormals) {
+        if(format.packedNormals) {
+            packed.layout.add(VERTEX_NORMAL_LOCATION, 4, GL_INT_2_10_10_10_REV, true);
+        }
+        else {
+            packed.layout.add(VERTEX_NORMAL_LOCATION, 3, GL_FLOAT);
+        }
+    }
+
+    const VertexAttribute& position = packed.layout.attributes[0];
+    const VertexAttribute& uv = packed.layout.attributes[1];
+
+    packed.data.assign(vertexCount * packed.layout.stride, 0);
+
+    for(size_t i = 0; i < vertexCount; ++i) {
+        const float* vertex = vertices + i * floatsPerVertex;
+        unsigned char* out = packed.data.data() + i * packed.layout.stride;
+
+        glm::vec3 p = (glm::vec3(vertex[0], vertex[1], vertex[2]) - center) / halfExtent;
+
+        if(format.position == POSITION_FLOAT) {
+            memcpy(out + position.offset, vertex, 3 * sizeof(float));
+        }
+        else {
+            uint16_t components[3];
+
+            for(int axis = 0; axis < 3; ++axis) {
+                components[axis] = format.position == POSITION_HALF ? glm::packHalf1x16(p[axis]) : glm::packSnorm1x16(p[axis]);
+            }
+
+            memcpy(out + position.offset, components, sizeof(components));
+        }
+
+        if(format.uv == UV_FLOAT) {
+            memcpy(out + uv.offset, vertex + 3, 2 * sizeof(float));
+        }
+        else {
+            uint16_t components[2];
+
+            for(int c = 0; c < 2; ++c) {
+                components[c] = format.uv == UV_HALF ? glm::packHalf1x16(vertex[3 + c]) : glm::packUnorm1x16(vertex[3 + c]);
+            }
+
+            memcpy(out + uv.offset, components, sizeof(components));
+        }
+
+        if(hasNormals) {
+            const VertexAttribute& normal = packed.layout.attributes[2];
+
+            if(format.packedNormals) {
+                uint32_t bits = glm::packSnorm3x10_1x2(glm::vec4(vertex[5], vertex[6], vertex[7], 0.0f));
+                memcpy(out + normal.offset, &bits, sizeof(bits));
+            }
+            else {
+                memcpy(out + normal.offset, vertex + 5, 3 * sizeof(float));
+            }
+        }
+    }
+
+    return packed;
+}
+
+#endif
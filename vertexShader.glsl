@@ -2,14 +2,56 @@
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec2 textureCoord;
 
+#ifdef INSTANCED
+// per-instance model matrix from InstanceBuffer (instancing.h), locations 2-5
+layout (location = 2) in mat4 instanceModel;
+#endif
+
+#ifdef TEXTURE_ATLAS
+// per-instance index into the Materials block (textureAtlas.h); needs INSTANCED
+layout (location = 7) in uint instanceMaterial;
+
+struct AtlasMaterial {
+    // atlas uv = uv * xy + zw
+    vec4 uvTransform;
+    vec4 layer;
+};
+
+layout (std140) uniform Materials {
+    AtlasMaterial materials[512];
+};
+
+flat out float atlasLayer;
+#endif
+
+#ifdef BINDLESS_TEXTURES
+// per-instance material index, looked up in MaterialHandles (bindlessTextures.h)
+layout (location = 7) in uint instanceMaterial;
+
+flat out uint materialIndex;
+#endif
+
+#include "camera.glsl"
+
 // uniform mat4 transform;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 out vec2 myTextureCoord;
 
 void main() {
-    gl_Position = projection * view * model * vec4(pos, 1.0);
+#ifdef INSTANCED
+    gl_Position = viewProjection * instanceModel * vec4(pos, 1.0);
+#else
+    gl_Position = viewProjection * model * vec4(pos, 1.0);
+#endif
+#ifdef TEXTURE_ATLAS
+    AtlasMaterial material = materials[instanceMaterial];
+    myTextureCoord = textureCoord * material.uvTransform.xy + material.uvTransform.zw;
+    atlasLayer = material.layer.x;
+#elif defined(BINDLESS_TEXTURES)
+    myTextureCoord = textureCoord;
+    materialIndex = instanceMaterial;
+#else
     myTextureCoord = textureCoord;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,1008 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+#include "shader.h"
+#include "mappedFile.h"
+#include "lockFreeQueue.h"
+#include "mipmapGenerator.h"
+
+// Tiled virtual texturing for images too large to load, or keep on the GPU, whole.
+//
+// Offline, writeVirtualTexture() cuts every mip level into tileSize x tileSize tiles,
+// each with a border of neighbouring texels from the same level (clamped at the
+// edges) so bilinear filtering never reads across tiles, and writes them to a .vtex
+// page file: header, level table, then fixed size tile slots on 4 KB boundaries,
+// level 0 first and row by row, so any tile is found from its index alone. Levels go
+// down to the first that fits in one tile (the mip tail).
+//
+// At run time VirtualTexture maps the page file and keeps only a cache of tiles on
+// the GPU:
+//
+//  - the physical texture is a grid of tile slots, reused least recently used first.
+//    The mip tail tile is loaded in open() and never evicted, so every texel always
+//    has something to show.
+//  - the indirection texture has one texel per tile and a mip level per virtual
+//    level, holding the slot and level of the finest resident tile covering it. The
+//    VIRTUAL_TEXTURE permutation of the fragment shader reads it and samples the slot.
+//  - the feedback pass draws the scene again into a small framebuffer (the viewport
+//    divided by feedbackDivisor) with the VIRTUAL_TEXTURE_FEEDBACK permutation, which
+//    writes the tile each pixel wants. It is read back through two pixel pack buffers
+//    a frame late, so the read doesn't wait on the GPU.
+//  - update() turns the requests, and their coarser ancestors, into jobs for the
+//    worker threads, coarse levels first, replacing the jobs still queued from older
+//    frames. Workers copy tiles out of the mapping, which is where the page file is
+//    actually read, and hand them back through a LockFreeQueue; the GL thread uploads
+//    up to uploadsPerFrame of them into slots whose tiles this frame didn't want.
+//
+// Per frame: beginFeedback(), draw with the feedback shader, endFeedback(), update(),
+// then bind() and draw with the virtual texture shader after setUniforms().
+
+const uint32_t VIRTUAL_TEXTURE_MAGIC = 0x58455456; // "VTEX"
+const uint32_t VIRTUAL_TEXTURE_VERSION = 1;
+const int VIRTUAL_TEXTURE_TILE_SIZE = 128;
+const int VIRTUAL_TEXTURE_BORDER = 4;
+
+// ---- .vtex page files ----
+
+struct VirtualTextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tileSize;
+    uint32_t border;
+    uint32_t levelCount;
+    uint32_t reserved;
+
+    // bytes from one tile to the next, and where the first one starts
+    uint64_t tileStride;
+    uint64_t tilesOffset;
+};
+
+struct VirtualTextureLevel {
+    uint32_t width;
+    uint32_t height;
+    uint32_t tilesX;
+    uint32_t tilesY;
+    // index of the level's first tile
+    uint64_t firstTile;
+};
+
+// tile (tileX, tileY) of an RGBA8 level with its border, as (tileSize + 2 * border)^2
+// texels; level holds the level's rows from firstRow on, as many as the tile reaches
+inline void extractVirtualTile(const unsigned char* level, int width, int height, int tileX, int tileY, int tileSize, int border, unsigned char* out, int firstRow = 0) {
+    int slotSize = tileSize + 2 * border;
+
+    for(int y = 0; y < slotSize; ++y) {
+        int sourceY = std::min(std::max(tileY * tileSize - border + y, 0), height - 1);
+        const unsigned char* row = level + (size_t)(sourceY - firstRow) * width * 4;
+
+        for(int x = 0; x < slotSize; ++x) {
+            int sourceX = std::min(std::max(tileX * tileSize - border + x, 0), width - 1);
+            memcpy(out + ((size_t)y * slotSize + x) * 4, row + (size_t)sourceX * 4, 4);
+        }
+    }
+}
+
+// page files of large textures pass 2 GB, beyond what fseek's long reaches on Windows
+inline bool seekVirtualTextureFile(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// One level below the first: filtered from the level above, which is read back out of
+// the page file a tile row at a time, and written a tile row at a time. Holds a tile
+// row of the level above plus the rows of this level one tile row and its borders
+// span, never a whole level.
+inline bool writeVirtualTextureLevel(FILE* file, const VirtualTextureHeader& header, const VirtualTextureLevel& above, const VirtualTextureLevel& info,
+                                     const MipSettings& mipSettings) {
+    int tileSize = (int)header.tileSize, border = (int)header.border;
+    int slotSize = tileSize + 2 * border;
+
+    MipRowFilter filter((int)above.width, (int)above.height, 4, mipSettings);
+
+    std::vector<unsigned char> tileRow((size_t)above.tilesX * header.tileStride), sourceRow((size_t)above.width * 4);
+    int loadedTileRow = -1;
+    bool ok = true;
+
+    // row y of the level above, gathered from the interiors of its tiles
+    auto readRow = [&](int y) -> const unsigned char* {
+        int tileY = y / tileSize;
+
+        if(tileY != loadedTileRow) {
+            uint64_t offset = header.tilesOffset + (above.firstTile + (uint64_t)tileY * above.tilesX) * header.tileStride;
+            ok = ok && seekVirtualTextureFile(file, offset) && fread(tileRow.data(), 1, tileRow.size(), file) == tileRow.size();
+            loadedTileRow = tileY;
+        }
+
+        int slotY = y - tileY * tileSize + border;
+
+        for(uint32_t tileX = 0; tileX < above.tilesX; ++tileX) {
+            int columns = std::min(tileSize, (int)above.width - (int)tileX * tileSize);
+            const unsigned char* slotRow = tileRow.data() + tileX * header.tileStride + ((size_t)slotY * slotSize + border) * 4;
+            memcpy(&sourceRow[(size_t)tileX * tileSize * 4], slotRow, (size_t)columns * 4);
+        }
+
+        return sourceRow.data();
+    };
+
+    // this level's rows windowFirst up to produced
+    size_t rowBytes = (size_t)info.width * 4;
+    std::vector<unsigned char> window, tile(header.tileStride, 0);
+    int windowFirst = 0, produced = 0;
+    uint64_t writeOffset = header.tilesOffset + info.firstTile * header.tileStride;
+
+    for(uint32_t tileY = 0; tileY < info.tilesY && ok; ++tileY) {
+        int first = std::max((int)tileY * tileSize - border, 0);
+        int last = std::min((int)(tileY + 1) * tileSize + border, (int)info.height) - 1;
+
+        // the previous tile row's rows above this one's border aren't needed again
+        window.erase(window.begin(), window.begin() + (size_t)(first - windowFirst) * rowBytes);
+        windowFirst = first;
+        window.resize((size_t)(last + 1 - windowFirst) * rowBytes);
+
+        for(; produced <= last; ++produced) {
+            filter.filterRow(produced, readRow, &window[(size_t)(produced - windowFirst) * rowBytes]);
+        }
+
+        ok = ok && seekVirtualTextureFile(file, writeOffset);
+
+        for(uint32_t tileX = 0; tileX < info.tilesX && ok; ++tileX) {
+            extractVirtualTile(window.data(), (int)info.width, (int)info.height, tileX, tileY, tileSize, border, tile.data(), windowFirst);
+            ok = fwrite(tile.data(), 1, tile.size(), file) == tile.size();
+        }
+
+        writeOffset += (uint64_t)info.tilesX * header.tileStride;
+    }
+
+    return ok;
+}
+
+// Only the source has to be in memory (it can be a mapping of raw RGBA8 pixels); the
+// levels below it are filtered out of the page file as it is written, a tile row at a
+// time, so the working set stays a few tile rows wide whatever the texture's size.
+inline bool writeVirtualTexture(const char* path, const unsigned char* rgba, int width, int height, int tileSize = VIRTUAL_TEXTURE_TILE_SIZE,
+                                int border = VIRTUAL_TEXTURE_BORDER, const MipSettings& mipSettings = MipSettings()) {
+    if(width <= 0 || height <= 0 || tileSize <= 0 || border < 0 || border > tileSize) {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_SIZE: " << width << "x" << height << ", tile " << tileSize << ", border " << border << std::endl;
+        return false;
+    }
+
+    // halving like a mip chain, down to the first level that fits in one tile
+    std::vector<VirtualTextureLevel> levels;
+    uint64_t tileCount = 0;
+
+    for(uint32_t levelWidth = width, levelHeight = height; ; levelWidth = levelWidth > 1 ? levelWidth / 2 : 1, levelHeight = levelHeight > 1 ? levelHeight / 2 : 1) {
+        VirtualTextureLevel info;
+        info.width = levelWidth;
+        info.height = levelHeight;
+        info.tilesX = (levelWidth + tileSize - 1) / tileSize;
+        info.tilesY = (levelHeight + tileSize - 1) / tileSize;
+        info.firstTile = tileCount;
+
+        levels.push_back(info);
+        tileCount += (uint64_t)info.tilesX * info.tilesY;
+
+        if(info.tilesX == 1 && info.tilesY == 1) {
+            break;
+        }
+    }
+
+    int slotSize = tileSize + 2 * border;
+
+    VirtualTextureHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = VIRTUAL_TEXTURE_MAGIC;
+    header.version = VIRTUAL_TEXTURE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.tileSize = tileSize;
+    header.border = border;
+    header.levelCount = (uint32_t)levels.size();
+    // whole pages per tile, so reading one never faults in a neighbour
+    header.tileStride = ((uint64_t)slotSize * slotSize * 4 + 4095) / 4096 * 4096;
+    header.tilesOffset = (sizeof(header) + levels.size() * sizeof(VirtualTextureLevel) + 4095) / 4096 * 4096;
+
+    // read as well as written: each level is filtered from the one before it
+    FILE* file = fopen(path, "w+b");
+
+    if(!file) {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::WRITE_FAILED: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> tile(header.tileStride, 0);
+    size_t gap = header.tilesOffset - sizeof(header) - levels.size() * sizeof(VirtualTextureLevel);
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(levels.data(), sizeof(VirtualTextureLevel), levels.size(), file) == levels.size();
+    ok = ok && fwrite(tile.data(), 1, gap, file) == gap;
+
+    for(uint32_t y = 0; y < levels[0].tilesY && ok; ++y) {
+        for(uint32_t x = 0; x < levels[0].tilesX && ok; ++x) {
+            extractVirtualTile(rgba, width, height, x, y, tileSize, border, tile.data());
+            ok = fwrite(tile.data(), 1, tile.size(), file) == tile.size();
+        }
+    }
+
+    for(size_t level = 1; level < levels.size() && ok; ++level) {
+        ok = writeVirtualTextureLevel(file, header, levels[level - 1], levels[level], mipSettings);
+    }
+
+    ok = fclose(file) == 0 && ok;
+
+    if(!ok) {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::WRITE_FAILED: " << path << std::endl;
+    }
+
+    return ok;
+}
+
+class VirtualTextureFile {
+    public:
+    MappedFile file;
+    const VirtualTextureHeader* header = nullptr;
+    const VirtualTextureLevel* levels = nullptr;
+
+    bool open(const char* path) {
+        header = nullptr;
+
+        // tiles are read wherever the camera looks, not front to back
+        if(!file.open(path, false)) {
+            return false;
+        }
+
+        if(file.size < sizeof(VirtualTextureHeader)) {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+
+        const VirtualTextureHeader* candidate = (const VirtualTextureHeader*)file.data;
+
+        if(candidate->magic != VIRTUAL_TEXTURE_MAGIC || candidate->version != VIRTUAL_TEXTURE_VERSION || candidate->levelCount == 0
+            || candidate->levelCount > 64 || candidate->tileSize == 0) {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_HEADER: " << path << " (version " << candidate->version << ", expected " << VIRTUAL_TEXTURE_VERSION << ")" << std::endl;
+            return false;
+        }
+
+        if(sizeof(VirtualTextureHeader) + candidate->levelCount * sizeof(VirtualTextureLevel) > file.size) {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+
+        const VirtualTextureLevel* candidateLevels = (const VirtualTextureLevel*)(file.data + sizeof(VirtualTextureHeader));
+
+        // tile() and the feedback pass index by these, so every level has to check out
+        if(!levelsFit(*candidate, candidateLevels)) {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_LEVELS: " << path << std::endl;
+            return false;
+        }
+
+        header = candidate;
+        levels = candidateLevels;
+
+        return true;
+    }
+
+    const unsigned char* tile(int level, int x, int y) const {
+        const VirtualTextureLevel& info = levels[level];
+
+        return file.data + header->tilesOffset + (info.firstTile + (uint64_t)y * info.tilesX + x) * header->tileStride;
+    }
+
+    void close() {
+        file.close();
+        header = nullptr;
+        levels = nullptr;
+    }
+
+    private:
+    // the chain writeVirtualTexture() produces: halving dimensions, tiles numbered
+    // level after level with no gaps, down to a single tile, all inside the file
+    bool levelsFit(const VirtualTextureHeader& header, const VirtualTextureLevel* levels) const {
+        if(header.width == 0 || header.height == 0 || header.tileSize > 16384 || header.border > header.tileSize) {
+            return false;
+        }
+
+        uint64_t slotSize = header.tileSize + 2 * (uint64_t)header.border;
+
+        if(header.tileStride < slotSize * slotSize * 4 || header.tilesOffset > file.size) {
+            return false;
+        }
+
+        uint64_t tilesInFile = (file.size - header.tilesOffset) / header.tileStride;
+        uint64_t tileCount = 0;
+        uint32_t width = header.width, height = header.height;
+
+        for(uint32_t level = 0; level < header.levelCount; ++level) {
+            const VirtualTextureLevel& info = levels[level];
+
+            if(info.width != width || info.height != height || info.firstTile != tileCount
+                || info.tilesX != (width + (uint64_t)header.tileSize - 1) / header.tileSize
+                || info.tilesY != (height + (uint64_t)header.tileSize - 1) / header.tileSize) {
+                return false;
+            }
+
+            uint64_t tiles = (uint64_t)info.tilesX * info.tilesY;
+
+            if(tiles > tilesInFile - tileCount) {
+                return false;
+            }
+
+            tileCount += tiles;
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+
+        const VirtualTextureLevel& last = levels[header.levelCount - 1];
+
+        return last.tilesX == 1 && last.tilesY == 1;
+    }
+};
+
+// ---- GPU side ----
+
+struct VirtualTextureStats {
+    unsigned int slots = 0;
+    unsigned int residentTiles = 0;
+    unsigned int requestedTiles = 0;
+    unsigned int uploadedTiles = 0;
+    unsigned int evictedTiles = 0;
+    // loaded while every slot held a tile the current frame wanted
+    unsigned int droppedTiles = 0;
+    unsigned int feedbackFrames = 0;
+    size_t bytesUploaded = 0;
+    // page file reads summed over workers
+    double loadMs = 0.0;
+};
+
+class VirtualTexture {
+    public:
+    unsigned int uploadsPerFrame = 8;
+    // feedback resolution is the viewport's divided by this
+    int feedbackDivisor = 8;
+    VirtualTextureStats stats;
+    VirtualTextureFile file;
+    unsigned int physicalTexture = 0;
+    unsigned int indirectionTexture = 0;
+
+    VirtualTexture() : loaded(256) {}
+
+    ~VirtualTexture() {
+        stopWorkers();
+    }
+
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    // cacheTilesPerSide^2 physical slots (fewer if the texture would exceed
+    // GL_MAX_TEXTURE_SIZE); workerCount 0 uses one thread per core, leaving one for
+    // the render thread
+    bool open(const char* path, int cacheTilesPerSide = 16, unsigned int workerCount = 0) {
+        close();
+
+        if(!file.open(path)) {
+            return false;
+        }
+
+        const VirtualTextureHeader& header = *file.header;
+        tileSize = (int)header.tileSize;
+        border = (int)header.border;
+        slotSize = tileSize + 2 * border;
+        levelCount = (int)header.levelCount;
+
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        slotsPerSide = std::max(1, std::min({cacheTilesPerSide, (int)maxSize / slotSize, 255}));
+        slots.assign((size_t)slotsPerSide * slotsPerSide, Slot());
+        stats = VirtualTextureStats();
+        stats.slots = (unsigned int)slots.size();
+
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+
+        glGenTextures(1, &physicalTexture);
+        glBindTexture(GL_TEXTURE_2D, physicalTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, slotsPerSide * slotSize, slotsPerSide * slotSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        createIndirection();
+
+        // the mip tail stays resident for good, and starts out covering every tile
+        glBindTexture(GL_TEXTURE_2D, physicalTexture);
+        makeResident(tileKey(levelCount - 1, 0, 0), file.tile(levelCount - 1, 0, 0), PINNED);
+        flushIndirection();
+
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+
+        if(workerCount == 0) {
+            unsigned int cores = std::thread::hardware_concurrency();
+            workerCount = cores > 1 ? cores - 1 : 1;
+        }
+
+        stopping = false;
+
+        for(unsigned int i = 0; i < workerCount; ++i) {
+            workers.emplace_back(&VirtualTexture::work, this);
+        }
+
+        return true;
+    }
+
+    // before drawing the scene with the VIRTUAL_TEXTURE_FEEDBACK shader
+    void beginFeedback(int viewportWidth, int viewportHeight) {
+        int width = std::max(1, viewportWidth / feedbackDivisor);
+        int height = std::max(1, viewportHeight / feedbackDivisor);
+
+        if(width != feedbackWidth || height != feedbackHeight) {
+            createFeedback(width, height);
+        }
+
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedDrawFramebuffer);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &savedReadFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, savedViewport);
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, savedClearColor);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+        glViewport(0, 0, width, height);
+
+        // alpha 1 (level 255) marks pixels that want nothing
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // starts this frame's readback and parses the previous one's
+    void endFeedback() {
+        int current = feedbackFrame % 2;
+        int previous = 1 - current;
+        size_t bytes = (size_t)feedbackWidth * feedbackHeight * 4;
+
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[current]);
+        glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        feedbackFilled[current] = true;
+
+        if(feedbackFilled[previous]) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[previous]);
+            const unsigned char* texels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+
+            if(texels) {
+                parseFeedback(texels, (size_t)feedbackWidth * feedbackHeight);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+
+            feedbackFilled[previous] = false;
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)savedDrawFramebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)savedReadFramebuffer);
+        glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+        glClearColor(savedClearColor[0], savedClearColor[1], savedClearColor[2], savedClearColor[3]);
+
+        feedbackFrame++;
+        stats.feedbackFrames++;
+    }
+
+    // once per frame on the GL thread, after endFeedback()
+    void update() {
+        // what the last feedback asked for, plus the ancestors, which are the fallback
+        // while it streams in and must not be evicted before it is
+        wanted.clear();
+
+        for(uint64_t key : requests) {
+            while(wanted.insert(key).second && tileLevel(key) < levelCount - 1) {
+                key = parentKey(key);
+            }
+        }
+
+        for(uint64_t key : wanted) {
+            auto found = residentSlots.find(key);
+
+            if(found != residentSlots.end() && slots[found->second].lastUsed != PINNED) {
+                slots[found->second].lastUsed = frame;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+
+            // jobs no worker picked up yet were for an older view
+            for(uint64_t key : jobs) {
+                pending.erase(key);
+            }
+
+            jobs.clear();
+
+            for(uint64_t key : wanted) {
+                if(residentSlots.count(key) == 0 && pending.count(key) == 0) {
+                    jobs.push_back(key);
+                }
+            }
+
+            // coarse levels first: they cover the most screen and are the next one's fallback
+            std::sort(jobs.begin(), jobs.end(), [](uint64_t a, uint64_t b) { return a > b; });
+
+            for(uint64_t key : jobs) {
+                pending.insert(key);
+            }
+
+            stats.requestedTiles += (unsigned int)jobs.size();
+        }
+
+        jobReady.notify_all();
+
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+        glBindTexture(GL_TEXTURE_2D, physicalTexture);
+
+        LoadedTile tile;
+
+        for(unsigned int uploaded = 0; uploaded < uploadsPerFrame && loaded.pop(tile); ) {
+            pending.erase(tile.key);
+            stats.loadMs += tile.loadMs;
+
+            if(residentSlots.count(tile.key)) {
+                continue;
+            }
+
+            if(!makeResident(tile.key, tile.pixels->data(), frame)) {
+                stats.droppedTiles++;
+                continue;
+            }
+
+            uploaded++;
+        }
+
+        flushIndirection();
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+
+        frame++;
+    }
+
+    void bind(int physicalUnit = 0, int indirectionUnit = 1) const {
+        glActiveTexture(GL_TEXTURE0 + physicalUnit);
+        glBindTexture(GL_TEXTURE_2D, physicalTexture);
+        glActiveTexture(GL_TEXTURE0 + indirectionUnit);
+        glBindTexture(GL_TEXTURE_2D, indirectionTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // with the shader in use; works for both permutations
+    void setUniforms(Shader& shader, int physicalUnit = 0, int indirectionUnit = 1) {
+        const VirtualTextureHeader& header = *file.header;
+        float physicalSize = (float)(slotsPerSide * slotSize);
+
+        shader.setInt("myTexture", physicalUnit);
+        shader.setInt("vtIndirection", indirectionUnit);
+        glUniform4f(shader.uniform("vtSize"), (float)header.width, (float)header.height, (float)tileSize, (float)(levelCount - 1));
+        glUniform4f(shader.uniform("vtPhysical"), physicalSize, physicalSize, (float)slotSize, (float)border);
+        // the feedback framebuffer is smaller, so its uv derivatives ask for too coarse a level
+        shader.setFloat("vtFeedbackBias", -std::log2((float)feedbackDivisor));
+    }
+
+    // needs the GL context; the destructor only joins the workers
+    void close() {
+        stopWorkers();
+
+        LoadedTile tile;
+
+        while(loaded.pop(tile)) {
+        }
+
+        if(physicalTexture) {
+            glDeleteTextures(1, &physicalTexture);
+            glDeleteTextures(1, &indirectionTexture);
+        }
+
+        destroyFeedback();
+        file.close();
+
+        physicalTexture = indirectionTexture = 0;
+        slots.clear();
+        residentSlots.clear();
+        indirection.clear();
+        jobs.clear();
+        pending.clear();
+        requests.clear();
+        frame = 1;
+    }
+
+    private:
+    static const uint64_t EMPTY_SLOT = ~(uint64_t)0;
+    // lastUsed of the mip tail
+    static const uint64_t PINNED = ~(uint64_t)0;
+
+    struct Slot {
+        uint64_t key = EMPTY_SLOT;
+        uint64_t lastUsed = 0;
+    };
+
+    struct LoadedTile {
+        uint64_t key = 0;
+        std::shared_ptr<std::vector<unsigned char>> pixels;
+        double loadMs = 0.0;
+    };
+
+    // CPU copy of one indirection level and the part of it update() has to upload
+    struct IndirectionLevel {
+        int width = 0, height = 0;
+        std::vector<unsigned char> texels;
+        int minX = 0, minY = 0, maxX = -1, maxY = -1;
+    };
+
+    int tileSize = 0, border = 0, slotSize = 0, levelCount = 0, slotsPerSide = 0;
+    uint64_t frame = 1;
+
+    std::vector<Slot> slots;
+    // tile key -> slot
+    std::unordered_map<uint64_t, int> residentSlots;
+    std::vector<IndirectionLevel> indirection;
+
+    unsigned int feedbackFramebuffer = 0, feedbackColor = 0, feedbackDepth = 0;
+    unsigned int feedbackBuffers[2] = {0, 0};
+    bool feedbackFilled[2] = {false, false};
+    int feedbackWidth = 0, feedbackHeight = 0;
+    unsigned int feedbackFrame = 0;
+    GLint savedDrawFramebuffer = 0, savedReadFramebuffer = 0;
+    GLint savedViewport[4] = {0, 0, 0, 0};
+    GLfloat savedClearColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    // GL thread: latest feedback, the tiles it implies, and those queued or loading
+    std::unordered_set<uint64_t> requests, wanted, pending;
+
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::condition_variable jobReady;
+    std::deque<uint64_t> jobs;
+    std::atomic<bool> stopping{false};
+
+    LockFreeQueue<LoadedTile> loaded;
+
+    // level above everything else, so keys sort coarse first
+    static uint64_t tileKey(int level, int x, int y) {
+        return ((uint64_t)level << 48) | ((uint64_t)y << 24) | (uint64_t)x;
+    }
+
+    static int tileLevel(uint64_t key) {
+        return (int)(key >> 48);
+    }
+
+    static int tileX(uint64_t key) {
+        return (int)(key & 0xffffff);
+    }
+
+    static int tileY(uint64_t key) {
+        return (int)((key >> 24) & 0xffffff);
+    }
+
+    // odd level sizes leave a last column or row of tiles past twice the coarser
+    // level's count, so the parent coordinates are clamped
+    uint64_t parentKey(uint64_t key) const {
+        const VirtualTextureLevel& coarser = file.levels[tileLevel(key) + 1];
+
+        return tileKey(tileLevel(key) + 1, std::min(tileX(key) / 2, (int)coarser.tilesX - 1), std::min(tileY(key) / 2, (int)coarser.tilesY - 1));
+    }
+
+    void createIndirection() {
+        // power of two sizes, so that GL's mip sizes hold every level's tiles
+        int width = 1, height = 1;
+
+        while(width < (int)file.levels[0].tilesX) {
+            width *= 2;
+        }
+
+        while(height < (int)file.levels[0].tilesY) {
+            height *= 2;
+        }
+
+        glGenTextures(1, &indirectionTexture);
+        glBindTexture(GL_TEXTURE_2D, indirectionTexture);
+        indirection.assign(levelCount, IndirectionLevel());
+
+        for(int level = 0; level < levelCount; ++level) {
+            IndirectionLevel& target = indirection[level];
+            target.width = std::max(1, width >> level);
+            target.height = std::max(1, height >> level);
+            target.texels.assign((size_t)target.width * target.height * 4, 0);
+
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, target.width, target.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+
+        // only ever read with texelFetch
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    // a tile's entry and, below it, that of every finer tile it is the fallback for
+    void fillIndirection(int level, int x, int y, const unsigned char entry[4]) {
+        IndirectionLevel& target = indirection[level];
+        memcpy(&target.texels[((size_t)y * target.width + x) * 4], entry, 4);
+
+        if(target.maxX < target.minX) {
+            target.minX = target.maxX = x;
+            target.minY = target.maxY = y;
+        }
+        else {
+            target.minX = std::min(target.minX, x);
+            target.minY = std::min(target.minY, y);
+            target.maxX = std::max(target.maxX, x);
+            target.maxY = std::max(target.maxY, y);
+        }
+
+        if(level == 0) {
+            return;
+        }
+
+        const VirtualTextureLevel& coarse = file.levels[level];
+        const VirtualTextureLevel& fine = file.levels[level - 1];
+        int lastX = x == (int)coarse.tilesX - 1 ? (int)fine.tilesX - 1 : std::min(2 * x + 1, (int)fine.tilesX - 1);
+        int lastY = y == (int)coarse.tilesY - 1 ? (int)fine.tilesY - 1 : std::min(2 * y + 1, (int)fine.tilesY - 1);
+
+        for(int childY = 2 * y; childY <= lastY; ++childY) {
+            for(int childX = 2 * x; childX <= lastX; ++childX) {
+                // resident children are their own entry, and so is everything below them
+                if(residentSlots.count(tileKey(level - 1, childX, childY)) == 0) {
+                    fillIndirection(level - 1, childX, childY, entry);
+                }
+            }
+        }
+    }
+
+    void flushIndirection() {
+        glBindTexture(GL_TEXTURE_2D, indirectionTexture);
+
+        for(int level = 0; level < levelCount; ++level) {
+            IndirectionLevel& target = indirection[level];
+
+            if(target.maxX < target.minX) {
+                continue;
+            }
+
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, target.width);
+            glTexSubImage2D(GL_TEXTURE_2D, level, target.minX, target.minY, target.maxX - target.minX + 1, target.maxY - target.minY + 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, &target.texels[((size_t)target.minY * target.width + target.minX) * 4]);
+
+            target.minX = target.minY = 0;
+            target.maxX = target.maxY = -1;
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+    // a free slot, else the least recently used one this frame didn't want; -1 if none
+    int claimSlot() {
+        int best = -1;
+
+        for(int i = 0; i < (int)slots.size(); ++i) {
+            if(slots[i].key == EMPTY_SLOT) {
+                return i;
+            }
+
+            if(slots[i].lastUsed < frame && (best < 0 || slots[i].lastUsed < slots[best].lastUsed)) {
+                best = i;
+            }
+        }
+
+        if(best >= 0) {
+            evict(best);
+        }
+
+        return best;
+    }
+
+    void evict(int slot) {
+        uint64_t key = slots[slot].key;
+        int level = tileLevel(key);
+
+        residentSlots.erase(key);
+        slots[slot].key = EMPTY_SLOT;
+        stats.residentTiles--;
+        stats.evictedTiles++;
+
+        // the tile's area falls back to whatever covers its parent
+        uint64_t parent = parentKey(key);
+        const IndirectionLevel& coarser = indirection[level + 1];
+        unsigned char entry[4];
+        memcpy(entry, &coarser.texels[((size_t)tileY(parent) * coarser.width + tileX(parent)) * 4], 4);
+
+        fillIndirection(level, tileX(key), tileY(key), entry);
+    }
+
+    // with the physical texture bound
+    bool makeResident(uint64_t key, const unsigned char* pixels, uint64_t lastUsed) {
+        int slot = claimSlot();
+
+        if(slot < 0) {
+            return false;
+        }
+
+        slots[slot].key = key;
+        slots[slot].lastUsed = lastUsed;
+        residentSlots[key] = slot;
+
+        int slotX = slot % slotsPerSide;
+        int slotY = slot / slotsPerSide;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, slotX * slotSize, slotY * slotSize, slotSize, slotSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+        unsigned char entry[4] = {(unsigned char)slotX, (unsigned char)slotY, (unsigned char)tileLevel(key), 255};
+        fillIndirection(tileLevel(key), tileX(key), tileY(key), entry);
+
+        stats.residentTiles++;
+        stats.uploadedTiles++;
+        stats.bytesUploaded += (size_t)slotSize * slotSize * 4;
+
+        return true;
+    }
+
+    void createFeedback(int width, int height) {
+        destroyFeedback();
+
+        feedbackWidth = width;
+        feedbackHeight = height;
+
+        GLint previousTexture = 0, previousFramebuffer = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+        glGenTextures(1, &feedbackColor);
+        glBindTexture(GL_TEXTURE_2D, feedbackColor);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenRenderbuffers(1, &feedbackDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &feedbackFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::FEEDBACK_FRAMEBUFFER_INCOMPLETE" << std::endl;
+        }
+
+        glGenBuffers(2, feedbackBuffers);
+
+        for(unsigned int buffer : feedbackBuffers) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4, nullptr, GL_STREAM_READ);
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+    }
+
+    void destroyFeedback() {
+        if(feedbackFramebuffer) {
+            glDeleteFramebuffers(1, &feedbackFramebuffer);
+            glDeleteTextures(1, &feedbackColor);
+            glDeleteRenderbuffers(1, &feedbackDepth);
+            glDeleteBuffers(2, feedbackBuffers);
+        }
+
+        feedbackFramebuffer = feedbackColor = feedbackDepth = 0;
+        feedbackBuffers[0] = feedbackBuffers[1] = 0;
+        feedbackFilled[0] = feedbackFilled[1] = false;
+        feedbackWidth = feedbackHeight = 0;
+    }
+
+    // r, g: tile x and y low bytes, b: their high nibbles, a: level (255 for none)
+    void parseFeedback(const unsigned char* texels, size_t count) {
+        requests.clear();
+
+        // neighbouring pixels mostly want the same tile
+        uint32_t previous = 0xffffffff;
+
+        for(size_t i = 0; i < count; ++i) {
+            const unsigned char* texel = texels + i * 4;
+            uint32_t packed;
+            memcpy(&packed, texel, 4);
+
+            if(packed == previous || texel[3] == 255) {
+                continue;
+            }
+
+            previous = packed;
+
+            int level = std::min((int)texel[3], levelCount - 1);
+            const VirtualTextureLevel& info = file.levels[level];
+            int x = std::min(texel[0] | (texel[2] & 15) << 8, (int)info.tilesX - 1);
+            int y = std::min(texel[1] | (texel[2] >> 4) << 8, (int)info.tilesY - 1);
+
+            requests.insert(tileKey(level, x, y));
+        }
+    }
+
+    void work() {
+        size_t tileBytes = (size_t)slotSize * slotSize * 4;
+
+        for(;;) {
+            uint64_t key;
+
+            {
+                std::unique_lock<std::mutex> lock(jobMutex);
+                jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+                if(stopping) {
+                    return;
+                }
+
+                key = jobs.front();
+                jobs.pop_front();
+            }
+
+            auto start = std::chrono::steady_clock::now();
+
+            // the copy is what faults the tile's pages in from the page file
+            const unsigned char* source = file.tile(tileLevel(key), tileX(key), tileY(key));
+
+            LoadedTile tile;
+            tile.key = key;
+            tile.pixels = std::make_shared<std::vector<unsigned char>>(source, source + tileBytes);
+            tile.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            // the queue only fills up if the GL thread stops calling update()
+            while(!loaded.push(tile)) {
+                std::this_thread::yield();
+
+                if(stopping) {
+                    return;
+                }
+            }
+        }
+    }
+
+    void stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            stopping = true;
+        }
+
+        jobReady.notify_all();
+
+        for(std::thread& worker : workers) {
+            worker.join();
+        }
+
+        workers.clear();
+    }
+};
+
+inline void printVirtualTextureStats(const VirtualTexture& texture) {
+    const VirtualTextureStats& stats = texture.stats;
+
+    std::cout << "TEXTURE::VIRTUAL: " << stats.residentTiles << "/" << stats.slots << " slot(s) in use, " << stats.requestedTiles << " tile(s) requested, "
+              << stats.uploadedTiles << " uploaded (" << stats.bytesUploaded / 1024 << " KB), " << stats.evictedTiles << " evicted, "
+              << stats.droppedTiles << " dropped, " << stats.loadMs << " ms reading on workers over " << stats.feedbackFrames << " feedback frame(s)" << std::endl;
+}
+
+#endif
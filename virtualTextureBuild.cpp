@@ -0,0 +1,81 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <GL/glew.h>
+#include "virtualTexture.h"
+
+// Offline tiler to the .vtex page format (see virtualTexture.h). No GL context is needed.
+//
+//   virtualTextureBuild image out.vtex [--tile N] [--border N] [--kaiser]
+//
+// The decoded image is held in memory while tiling; the levels below it are built a
+// tile row at a time from the page file being written, and the renderer only ever
+// keeps its tile cache.
+
+void printUsage() {
+    std::cout << "usage: virtualTextureBuild image out.vtex [--tile N] [--border N] [--kaiser]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        printUsage();
+        return 1;
+    }
+
+    int tileSize = VIRTUAL_TEXTURE_TILE_SIZE, border = VIRTUAL_TEXTURE_BORDER;
+    MipSettings mipSettings;
+
+    for(int i = 3; i < argc; ++i) {
+        if(strcmp(argv[i], "--tile") == 0 && i + 1 < argc) {
+            tileSize = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--border") == 0 && i + 1 < argc) {
+            border = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--kaiser") == 0) {
+            mipSettings.filter = MIP_FILTER_KAISER;
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(argv[1], &width, &height, &channels, 4);
+
+    if(!pixels) {
+        std::cout << "ERROR::VIRTUAL_TEXTURE_BUILD::DECODE_FAILED: " << argv[1] << " (" << stbi_failure_reason() << ")" << std::endl;
+        return 1;
+    }
+
+    bool ok = writeVirtualTexture(argv[2], pixels, width, height, tileSize, border, mipSettings);
+    stbi_image_free(pixels);
+
+    if(!ok) {
+        return 1;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    VirtualTextureFile file;
+
+    if(!file.open(argv[2])) {
+        return 1;
+    }
+
+    for(uint32_t level = 0; level < file.header->levelCount; ++level) {
+        const VirtualTextureLevel& info = file.levels[level];
+        printf("level %-3u %6ux%-6u %4ux%-4u tiles\n", level, info.width, info.height, info.tilesX, info.tilesY);
+    }
+
+    std::cout << argv[2] << ": " << width << "x" << height << " in " << file.header->levelCount << " level(s) of " << tileSize << "px tiles (border "
+              << border << "), " << file.file.size / (1024 * 1024) << " MB, " << ms << " ms" << std::endl;
+
+    return 0;
+}
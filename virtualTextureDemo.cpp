@@ -0,0 +1,195 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shaderLibrary.h"
+#include "cameraBuffer.h"
+#include "virtualTexture.h"
+
+// Flies low over a ground plane covered by one virtual texture, so the view spans
+// every mip level from level 0 under the camera to the mip tail at the horizon, and
+// reports what the tile cache streamed.
+//
+//   virtualTextureDemo [page.vtex] [--cache TILES_PER_SIDE] [--frames N]
+//
+// Without a page file a generated 4096x4096 image is tiled into
+// virtualTextureDemo.vtex first.
+
+const int GENERATED_SIZE = 4096;
+const char* GENERATED_PATH = "virtualTextureDemo.vtex";
+
+// a grid with the cell coordinates in red and green, so wrong tiles stand out
+std::vector<unsigned char> makeImage() {
+    std::vector<unsigned char> pixels((size_t)GENERATED_SIZE * GENERATED_SIZE * 4);
+
+    for(int y = 0; y < GENERATED_SIZE; ++y) {
+        for(int x = 0; x < GENERATED_SIZE; ++x) {
+            unsigned char* texel = &pixels[((size_t)y * GENERATED_SIZE + x) * 4];
+            bool line = x % 64 < 2 || y % 64 < 2;
+            texel[0] = (unsigned char)(line ? 255 : (x / 64) * 4);
+            texel[1] = (unsigned char)(line ? 255 : (y / 64) * 4);
+            texel[2] = (unsigned char)(line ? 255 : 96 + 64 * (((x / 8) ^ (y / 8)) & 1));
+            texel[3] = 255;
+        }
+    }
+
+    return pixels;
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    int cacheTilesPerSide = 16, frames = 600;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cacheTilesPerSide = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        }
+        else {
+            path = argv[i];
+        }
+    }
+
+    if(!path) {
+        std::vector<unsigned char> image = makeImage();
+
+        if(!writeVirtualTexture(GENERATED_PATH, image.data(), GENERATED_SIZE, GENERATED_SIZE)) {
+            return -1;
+        }
+
+        path = GENERATED_PATH;
+    }
+
+    if(glfwInit() == GLFW_FALSE) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(800, 600, "Virtual texture", NULL, NULL);
+
+    if(!window) {
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if(glewInit() != GLEW_OK) {
+        std::cerr << "Error loading Glew" << std::endl;
+        return -1;
+    }
+
+    ShaderLibrary shaders;
+    Shader& shader = shaders.variant("vertexShader.glsl", "fragmentShader.glsl", {{"VIRTUAL_TEXTURE", ""}});
+    Shader& feedbackShader = shaders.variant("vertexShader.glsl", "fragmentShader.glsl", {{"VIRTUAL_TEXTURE_FEEDBACK", ""}});
+    shaders.finishAll();
+
+    VirtualTexture texture;
+
+    if(!texture.open(path, cacheTilesPerSide)) {
+        return -1;
+    }
+
+    const VirtualTextureHeader& header = *texture.file.header;
+    std::cout << path << ": " << header.width << "x" << header.height << ", " << header.levelCount << " level(s)" << std::endl;
+
+    // one quad 200 units across, uv 0..1 over all of it
+    const float planeVertices[] = {
+        -100.0f, 0.0f, -100.0f,  0.0f, 0.0f,
+        100.0f, 0.0f, -100.0f,  1.0f, 0.0f,
+        100.0f, 0.0f,  100.0f,  1.0f, 1.0f,
+        100.0f, 0.0f,  100.0f,  1.0f, 1.0f,
+        -100.0f, 0.0f,  100.0f,  0.0f, 1.0f,
+        -100.0f, 0.0f, -100.0f,  0.0f, 0.0f,
+    };
+
+    unsigned int VAO, VBO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), nullptr);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    for(Shader* program : {&shader, &feedbackShader}) {
+        program->use();
+        program->setMat4("model", glm::mat4(1.0f));
+        texture.setUniforms(*program);
+    }
+
+    CameraBuffer camera;
+    camera.create();
+
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.5f, 0.6f, 0.8f, 1.0f);
+
+    auto start = std::chrono::steady_clock::now();
+    int frame = 0;
+
+    for(; frame < frames && !glfwWindowShouldClose(window); ++frame) {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+
+        // a slow circle a few units above the ground, looking ahead and down
+        float angle = frame * 0.004f;
+        glm::vec3 eye(60.0f * std::cos(angle), 3.0f, 60.0f * std::sin(angle));
+        glm::vec3 ahead(-std::sin(angle), -0.15f, std::cos(angle));
+        camera.update(glm::lookAt(eye, eye + ahead, glm::vec3(0.0f, 1.0f, 0.0f)),
+                      glm::perspective(glm::radians(60.0f), (float)width / (float)std::max(height, 1), 0.1f, 500.0f));
+
+        glBindVertexArray(VAO);
+
+        texture.beginFeedback(width, height);
+        feedbackShader.use();
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        texture.endFeedback();
+
+        texture.update();
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        shader.use();
+        texture.bind();
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    glFinish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << frame << " frame(s), " << ms / std::max(frame, 1) << " ms per frame" << std::endl;
+    printVirtualTextureStats(texture);
+
+    texture.close();
+    camera.destroy();
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteProgram(shader.shaderProgram);
+    glDeleteProgram(feedbackShader.shaderProgram);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}